@@ -0,0 +1,257 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <algorithm>
+#include <cmath>
+#include <fnmatch.h>
+
+#include "BandwidthModel.h"
+
+/**
+ * Returns whether the algorithm is recorded by addResult() (see
+ * selectAlgorithms()).
+ *
+ * \param algorithm
+ *      Name of the algorithm
+ */
+bool
+BandwidthModel::isSelected(const std::string &algorithm) const
+{
+    bool selectingPatterns = false;
+    bool selected = false;
+    for (const std::string &pattern : algorithmPatterns) {
+        if (pattern[0] == '!') {
+            if (fnmatch(pattern.c_str() + 1, algorithm.c_str(), 0) == 0)
+                return false;
+        } else {
+            selectingPatterns = true;
+            if (fnmatch(pattern.c_str(), algorithm.c_str(), 0) == 0)
+                selected = true;
+        }
+    }
+
+    return selected || !selectingPatterns;
+}
+
+// See Header
+void
+BandwidthModel::addResult(const std::string &algorithm,
+                          const std::string &dataset, double computeTime,
+                          uint64_t outputBytes)
+{
+    if (!isSelected(algorithm))
+        return;
+
+    costs[dataset][algorithm] = {computeTime, outputBytes/(1024.0*1024)};
+}
+
+// See Header
+std::vector<std::string>
+BandwidthModel::getAlgorithms() const
+{
+    std::vector<std::string> algorithms;
+    for (const auto &dataset : costs) {
+        for (const auto &algorithm : dataset.second)
+            algorithms.push_back(algorithm.first);
+    }
+
+    std::sort(algorithms.begin(), algorithms.end());
+    algorithms.erase(std::unique(algorithms.begin(), algorithms.end()),
+                     algorithms.end());
+    return algorithms;
+}
+
+// See Header
+std::vector<std::string>
+BandwidthModel::getDatasets(const char *pattern) const
+{
+    std::vector<std::string> datasets;
+    for (const auto &dataset : costs) {
+        if (fnmatch(pattern, dataset.first.c_str(), 0) == 0)
+            datasets.push_back(dataset.first);
+    }
+
+    return datasets;
+}
+
+/**
+ * Returns the algorithm logging a dataset the fastest at a bandwidth, the
+ * first in name order on ties.
+ *
+ * \param datasetCosts
+ *      Costs of the algorithms on the dataset; can't be empty
+ * \param bandwidth
+ *      Bandwidth of the output device in MB/s
+ */
+BandwidthModel::DatasetCosts::const_iterator
+BandwidthModel::getWinner(const DatasetCosts &datasetCosts, double bandwidth)
+{
+    auto winner = datasetCosts.begin();
+    for (auto it = datasetCosts.begin(); it != datasetCosts.end(); ++it) {
+        if (it->second.getTime(bandwidth) < winner->second.getTime(bandwidth))
+            winner = it;
+    }
+
+    return winner;
+}
+
+/**
+ * Returns the algorithms logging a dataset the fastest over all bandwidths,
+ * as the bandwidths from which each wins, in increasing order. The first
+ * starts at 0.
+ *
+ * The cost of every algorithm changes slope only at its own o/c, and two
+ * algorithms' costs can only cross where one's o/B equals the other's
+ * constant c, or the bandwidth o_a/c_b. Between consecutive such bandwidths
+ * the order of the costs can't change, so evaluating the winner at one
+ * bandwidth inside each interval finds all of them.
+ *
+ * \param datasetCosts
+ *      Costs of the algorithms on the dataset; can't be empty
+ */
+std::vector<std::pair<double, std::string>>
+BandwidthModel::getWinners(const DatasetCosts &datasetCosts)
+{
+    std::vector<double> breakpoints;
+    for (const auto &a : datasetCosts) {
+        for (const auto &b : datasetCosts) {
+            if (b.second.computeTime > 0 && a.second.outputMB > 0)
+                breakpoints.push_back(a.second.outputMB/b.second.computeTime);
+        }
+    }
+
+    std::sort(breakpoints.begin(), breakpoints.end());
+    breakpoints.erase(std::unique(breakpoints.begin(), breakpoints.end()),
+                      breakpoints.end());
+
+    std::vector<std::pair<double, std::string>> winners;
+    for (size_t i = 0; i <= breakpoints.size(); ++i) {
+        double start = (i == 0) ? 0.0 : breakpoints[i - 1];
+        double inside;
+        if (breakpoints.empty())
+            inside = 1.0;
+        else if (i == 0)
+            inside = breakpoints[0]/2;
+        else if (i == breakpoints.size())
+            inside = 2*start;
+        else
+            inside = std::sqrt(start*breakpoints[i]);
+
+        const std::string &winner = getWinner(datasetCosts, inside)->first;
+        if (winners.empty() || winners.back().second != winner)
+            winners.emplace_back(start, winner);
+    }
+
+    return winners;
+}
+
+// See Header
+int
+BandwidthModel::getWinner(const std::string &dataset, double bandwidth) const
+{
+    auto datasetCosts = costs.find(dataset);
+    if (datasetCosts == costs.end() || datasetCosts->second.empty())
+        return -1;
+
+    std::vector<std::string> algorithms = getAlgorithms();
+    const std::string &winner = getWinner(datasetCosts->second,
+                                          bandwidth)->first;
+    return std::lower_bound(algorithms.begin(), algorithms.end(), winner) -
+           algorithms.begin();
+}
+
+// See Header
+double
+BandwidthModel::getTotalTime(const std::string &algorithm,
+                             const std::vector<std::string> &datasets,
+                             double bandwidth) const
+{
+    double totalTime = 0;
+    for (const std::string &dataset : datasets) {
+        auto datasetCosts = costs.find(dataset);
+        if (datasetCosts == costs.end())
+            continue;
+
+        auto cost = datasetCosts->second.find(algorithm);
+        if (cost != datasetCosts->second.end())
+            totalTime += cost->second.getTime(bandwidth);
+    }
+
+    return totalTime;
+}
+
+// See Header
+std::vector<BandwidthModel::Step>
+BandwidthModel::getSteps(const std::vector<std::string> &datasets) const
+{
+    std::vector<std::string> algorithms = getAlgorithms();
+    auto indexOf = [&algorithms](const std::string &algorithm) {
+        return static_cast<int>(std::lower_bound(algorithms.begin(),
+                                                 algorithms.end(), algorithm)
+                                - algorithms.begin());
+    };
+
+    // Changes of the datasets' winners as (bandwidth, dataset, algorithm)
+    struct Change {
+        double bandwidth;
+        int dataset;
+        int winner;
+    };
+    std::vector<Change> changes;
+    std::vector<int> winners(datasets.size(), -1);
+    Step step = {0.0, std::vector<int>(algorithms.size(), 0), 0};
+
+    for (size_t i = 0; i < datasets.size(); ++i) {
+        auto datasetCosts = costs.find(datasets[i]);
+        if (datasetCosts == costs.end() || datasetCosts->second.empty())
+            continue;
+
+        for (const auto &winner : getWinners(datasetCosts->second)) {
+            if (winners[i] == -1) {
+                winners[i] = indexOf(winner.second);
+                ++step.wins[winners[i]];
+            } else {
+                changes.push_back({winner.first, static_cast<int>(i),
+                                   indexOf(winner.second)});
+            }
+        }
+    }
+
+    std::stable_sort(changes.begin(), changes.end(),
+                     [](const Change &a, const Change &b) {
+                         return a.bandwidth < b.bandwidth;
+                     });
+
+    std::vector<Step> steps;
+    for (size_t i = 0; i <= changes.size(); ++i) {
+        if (i == 0 || i == changes.size() ||
+                changes[i].bandwidth != changes[i - 1].bandwidth) {
+            step.leader = std::max_element(step.wins.begin(),
+                                           step.wins.end()) -
+                          step.wins.begin();
+            if (steps.empty() || steps.back().wins != step.wins)
+                steps.push_back(step);
+        }
+
+        if (i == changes.size())
+            break;
+
+        --step.wins[winners[changes[i].dataset]];
+        winners[changes[i].dataset] = changes[i].winner;
+        ++step.wins[changes[i].winner];
+        step.bandwidth = changes[i].bandwidth;
+    }
+
+    return steps;
+}
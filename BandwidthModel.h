@@ -0,0 +1,173 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef COMPRESSION_BANDWIDTH_MODEL_H
+#define COMPRESSION_BANDWIDTH_MODEL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * BandwidthModel predicts which compression algorithm logs a dataset the
+ * fastest when its output is written to a device of a given bandwidth.
+ * Compression overlaps the writes, so an algorithm that compresses a dataset
+ * in c seconds into o MB takes max(c, o/B) seconds at B MB/s: a constant up
+ * to the bandwidth o/c and o/B beyond it. Instead of sampling bandwidths,
+ * the model computes the bandwidths where these costs cross, so the winner
+ * of every dataset is known exactly at every bandwidth, from the results of
+ * a single benchmark run.
+ *
+ * Ties go to the algorithm first in name order, and MB are 2^20 bytes like
+ * the rest of the benchmark's rates.
+ */
+class BandwidthModel {
+public:
+    /**
+     * The datasets each algorithm wins from a bandwidth up to the next
+     * Step's.
+     */
+    struct Step {
+        // Bandwidth in MB/s the step starts at; the first step starts at 0
+        double bandwidth;
+
+        // Number of datasets won by each algorithm, in the order of
+        // getAlgorithms()
+        std::vector<int> wins;
+
+        // Index of the algorithm winning the most datasets
+        int leader;
+    };
+
+    BandwidthModel()
+        : algorithmPatterns()
+        , costs()
+    {}
+
+    /**
+     * Selects the algorithms addResult() records by fnmatch() patterns
+     * matching their names; a pattern starting with '!' leaves out the
+     * algorithms it matches instead. With no selecting patterns, every
+     * algorithm not left out is recorded.
+     *
+     * \param patterns
+     *      Patterns, e.g. {"NanoLog*", "gzip,?"} or {"!*+s"}
+     */
+    void selectAlgorithms(const std::vector<std::string> &patterns) {
+        algorithmPatterns = patterns;
+    }
+
+    /**
+     * Records the result of compressing a dataset with an algorithm,
+     * replacing any previous one of the pair.
+     *
+     * \param algorithm
+     *      Name of the compression algorithm
+     * \param dataset
+     *      Name of the dataset
+     * \param computeTime
+     *      Seconds the algorithm took to compress the dataset
+     * \param outputBytes
+     *      Size of the compressed dataset
+     */
+    void addResult(const std::string &algorithm, const std::string &dataset,
+                   double computeTime, uint64_t outputBytes);
+
+    /**
+     * Returns the names of the algorithms with results, sorted; Steps and
+     * getWinner() refer to algorithms by their index in it.
+     */
+    std::vector<std::string> getAlgorithms() const;
+
+    /**
+     * Returns the sorted names of the datasets with results that match a
+     * fnmatch() pattern.
+     *
+     * \param pattern
+     *      Pattern of the dataset names, e.g. "*Chars"
+     */
+    std::vector<std::string> getDatasets(const char *pattern) const;
+
+    /**
+     * Returns the index of the algorithm logging a dataset the fastest at a
+     * bandwidth, or -1 if the dataset has no results.
+     *
+     * \param dataset
+     *      Name of the dataset
+     * \param bandwidth
+     *      Bandwidth of the output device in MB/s
+     */
+    int getWinner(const std::string &dataset, double bandwidth) const;
+
+    /**
+     * Returns the seconds an algorithm takes to log all of a set of datasets
+     * at a bandwidth, leaving out the datasets it has no result for.
+     *
+     * \param algorithm
+     *      Name of the algorithm
+     * \param datasets
+     *      Names of the datasets
+     * \param bandwidth
+     *      Bandwidth of the output device in MB/s
+     */
+    double getTotalTime(const std::string &algorithm,
+                        const std::vector<std::string> &datasets,
+                        double bandwidth) const;
+
+    /**
+     * Returns the bandwidths at which the number of datasets each algorithm
+     * wins changes, with the wins from there on, in increasing order of
+     * bandwidth. The leader of each step is the algorithm winning the most
+     * datasets, the first in name order on ties.
+     *
+     * \param datasets
+     *      Names of the datasets to count the wins of
+     */
+    std::vector<Step> getSteps(const std::vector<std::string> &datasets) const;
+
+private:
+    /**
+     * Cost of logging a dataset with an algorithm
+     */
+    struct Cost {
+        // Seconds to compress the dataset
+        double computeTime;
+
+        // Size of the compressed dataset in MB
+        double outputMB;
+
+        double getTime(double bandwidth) const {
+            return std::max(computeTime, outputMB/bandwidth);
+        }
+    };
+
+    // Costs of the algorithms on a dataset, keyed by algorithm name
+    typedef std::map<std::string, Cost> DatasetCosts;
+
+    bool isSelected(const std::string &algorithm) const;
+    static DatasetCosts::const_iterator getWinner(
+            const DatasetCosts &datasetCosts, double bandwidth);
+    static std::vector<std::pair<double, std::string>>
+    getWinners(const DatasetCosts &datasetCosts);
+
+    // Patterns of the algorithms recorded (see selectAlgorithms())
+    std::vector<std::string> algorithmPatterns;
+
+    // Costs of the algorithms on every dataset, keyed by dataset name
+    std::map<std::string, DatasetCosts> costs;
+};
+
+#endif //COMPRESSION_BANDWIDTH_MODEL_H
@@ -0,0 +1,32 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef COMPRESSION_BUILD_INFO_H
+#define COMPRESSION_BUILD_INFO_H
+
+/**
+ * Identifies the build of the benchmark in the metadata of its runs. The
+ * GNUmakefile generates BuildInfo.cc, which defines these, and rewrites it
+ * only when the source revision or the compiler flags change, so that the
+ * small object built from it is recompiled exactly when they do.
+ */
+namespace BuildInfo {
+// Output of `git describe --always --dirty` ("unknown" outside of git)
+extern const char *const GIT_HASH;
+
+// Flags the benchmark was compiled with
+extern const char *const CXXFLAGS;
+};
+
+#endif //COMPRESSION_BUILD_INFO_H
@@ -0,0 +1,513 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+
+#include "ColumnarCompressor.h"
+#include "FormatRegistry.h"
+
+/**
+ * This file implements the ColumnarCompressor declared in
+ * ColumnarCompressor.h
+ */
+
+using namespace LoggerInternals;
+
+// Indexes of the header streams within a block
+static const int HEADER_NIBBLE_STREAM = 0;
+static const int FMT_ID_STREAM = 1;
+static const int TIMESTAMP_STREAM = 2;
+
+// Returns the index of the nibble/data stream for an argument position
+static inline int nibbleStream(int position) {
+    return 3 + 2*position;
+}
+
+static inline int dataStream(int position) {
+    return 3 + 2*position + 1;
+}
+
+/**
+ * Appends 4-bit values to a stream, two per byte (low nibble first).
+ */
+struct NibbleWriter {
+    unsigned char *writePos;
+    bool highNibble;
+
+    void reset(unsigned char *buffer) {
+        writePos = buffer;
+        highNibble = false;
+    }
+
+    inline void put(uint8_t nibble) {
+        if (highNibble) {
+            *writePos |= static_cast<unsigned char>(nibble << 4);
+            ++writePos;
+        } else {
+            *writePos = nibble;
+        }
+
+        highNibble = !highNibble;
+    }
+
+    // Returns the end of the stream, including any half filled byte
+    unsigned char *end() const {
+        return writePos + (highNibble ? 1 : 0);
+    }
+};
+
+/**
+ * Reads back the 4-bit values written by a NibbleWriter.
+ */
+struct NibbleReader {
+    const unsigned char *readPos;
+    bool highNibble;
+
+    void reset(const unsigned char *buffer) {
+        readPos = buffer;
+        highNibble = false;
+    }
+
+    inline uint8_t get() {
+        uint8_t nibble;
+        if (highNibble) {
+            nibble = (*readPos) >> 4;
+            ++readPos;
+        } else {
+            nibble = (*readPos) & 0x0f;
+        }
+
+        highNibble = !highNibble;
+        return nibble;
+    }
+};
+
+/**
+ * Returns the number of arguments encoded in a fmtId (or registered for it
+ * with the FormatRegistry), or -1 if the fmtId is unknown.
+ */
+static inline int
+getNumArgs(uint32_t fmtId) {
+    if (fmtId >= LOG_ID_FORMAT_START) {
+        const FormatSignature *signature = FormatRegistry::getSignature(fmtId);
+        return (signature == nullptr) ? -1 : signature->numArgs;
+    }
+
+    return fmtId % LOG_ID_MAX_ARGS;
+}
+
+/**
+ * Scatters the arguments of a log entry whose fmtId was registered with the
+ * FormatRegistry into the streams of their positions, packing the int/long
+ * ones like the homogeneous entries'.
+ *
+ * \param entry
+ *      Log entry to scatter
+ * \param writePtrs
+ *      Next position to write to in every stream
+ * \param nibbles
+ *      Nibble streams of the argument positions
+ */
+static inline void
+scatterFormatArgs(const NanoLogInternal::Log::UncompressedEntry *entry,
+                  unsigned char **writePtrs, NibbleWriter *nibbles)
+{
+    const FormatSignature *signature =
+                                FormatRegistry::getSignature(entry->fmtId);
+    const char *arg = entry->argData;
+
+    for (int p = 0; p < signature->numArgs; ++p) {
+        unsigned char *&writePtr = writePtrs[dataStream(p)];
+
+        switch (signature->argTypes[p]) {
+            case LOG_ARG_INT: {
+                int value;
+                memcpy(&value, arg, sizeof(int));
+                arg += sizeof(int);
+                nibbles[p].put(BufferUtils::pack((char**)&writePtr, value));
+                break;
+            }
+            case LOG_ARG_LONG: {
+                long value;
+                memcpy(&value, arg, sizeof(long));
+                arg += sizeof(long);
+                nibbles[p].put(BufferUtils::pack((char**)&writePtr, value));
+                break;
+            }
+            case LOG_ARG_DOUBLE:
+                memcpy(writePtr, arg, sizeof(double));
+                arg += sizeof(double);
+                writePtr += sizeof(double);
+                break;
+            default: {
+                size_t length = strlen(arg) + 1;
+                memcpy(writePtr, arg, length);
+                arg += length;
+                writePtr += length;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Reverses scatterFormatArgs(); i.e. gathers the arguments of a log entry
+ * whose fmtId was registered with the FormatRegistry back from the streams
+ * of their positions.
+ *
+ * \param signature
+ *      Signature registered for the entry's fmtId
+ * \param readPtrs
+ *      Next position to read from in every stream
+ * \param endOfStreams
+ *      End of the block's streams
+ * \param nibbles
+ *      Nibble streams of the argument positions
+ * \param[in/out] writePos
+ *      Buffer to output the arguments to (pointer will be incremented)
+ * \param endOfOutput
+ *      End of the output buffer
+ *
+ * \return
+ *      Z_OK if successful, Z_BUF_ERROR if the output buffer is too small
+ */
+static inline int
+gatherFormatArgs(const FormatSignature *signature, const char **readPtrs,
+                 const char *endOfStreams, NibbleReader *nibbles,
+                 unsigned char **writePos, unsigned char *endOfOutput)
+{
+    for (int p = 0; p < signature->numArgs; ++p) {
+        const char *&readPtr = readPtrs[dataStream(p)];
+
+        // Strings are the only arguments that can exceed a long
+        size_t length = sizeof(long);
+        if (signature->argTypes[p] == LOG_ARG_STRING)
+            length = strnlen(readPtr, endOfStreams - readPtr) + 1;
+
+        if (*writePos + length > endOfOutput)
+            return Z_BUF_ERROR;
+
+        switch (signature->argTypes[p]) {
+            case LOG_ARG_INT: {
+                int value = BufferUtils::unpack<int>(&readPtr,
+                                                     nibbles[p].get());
+                memcpy(*writePos, &value, sizeof(int));
+                *writePos += sizeof(int);
+                break;
+            }
+            case LOG_ARG_LONG: {
+                long value = BufferUtils::unpack<long>(&readPtr,
+                                                       nibbles[p].get());
+                memcpy(*writePos, &value, sizeof(long));
+                *writePos += sizeof(long);
+                break;
+            }
+            case LOG_ARG_DOUBLE:
+                memcpy(*writePos, readPtr, sizeof(double));
+                readPtr += sizeof(double);
+                *writePos += sizeof(double);
+                break;
+            default:
+                memcpy(*writePos, readPtr, length);
+                readPtr += length;
+                *writePos += length;
+                break;
+        }
+    }
+
+    return Z_OK;
+}
+
+ColumnarCompressor::ColumnarCompressor()
+    : streams()
+{
+}
+
+// See Header
+int
+ColumnarCompressor::compress(unsigned char *outputBuffer,
+                             long unsigned int *outputSize,
+                             const unsigned char *inputBuffer,
+                             long unsigned int inputSize)
+{
+    using namespace NanoLogInternal;
+
+    const unsigned char *readPos = inputBuffer;
+    const unsigned char *endOfInput = inputBuffer + inputSize;
+    unsigned char *writePos = outputBuffer;
+    unsigned char *endOfOutput = outputBuffer + *outputSize;
+
+    unsigned char *writePtrs[MAX_STREAMS];
+    NibbleWriter nibbles[LOG_ID_MAX_ARGS];
+    NibbleWriter headerNibbles;
+
+    while (readPos < endOfInput) {
+        // Find the extent of the block and the number of argument positions
+        const unsigned char *blockStart = readPos;
+        const unsigned char *blockEnd = readPos;
+        uint32_t numEntries = 0;
+        int numPositions = 0;
+
+        while (blockEnd < endOfInput) {
+            auto entry =
+                    reinterpret_cast<const Log::UncompressedEntry*>(blockEnd);
+            if (numEntries > 0 &&
+                    blockEnd + entry->entrySize > blockStart + BLOCK_BYTES)
+                break;
+
+            numPositions = std::max(numPositions, getNumArgs(entry->fmtId));
+            blockEnd += entry->entrySize;
+            ++numEntries;
+        }
+
+        // Every stream is at worst as large as the whole block compacted
+        long unsigned int streamBound = NanoLogCompressBound(
+                                                        blockEnd - blockStart);
+        int numStreams = NUM_HEADER_STREAMS + 2*numPositions;
+        for (int i = 0; i < numStreams; ++i) {
+            if (streams[i].size() < streamBound)
+                streams[i].resize(streamBound);
+            writePtrs[i] = streams[i].data();
+        }
+
+        headerNibbles.reset(streams[HEADER_NIBBLE_STREAM].data());
+        for (int p = 0; p < numPositions; ++p)
+            nibbles[p].reset(streams[nibbleStream(p)].data());
+
+        // Scatter the entries into the streams
+        uint64_t lastTime = 0;
+        while (readPos < blockEnd) {
+            auto entry =
+                    reinterpret_cast<const Log::UncompressedEntry*>(readPos);
+            uint32_t fmtId = entry->fmtId;
+            int numArgs = getNumArgs(fmtId);
+
+            headerNibbles.put(BufferUtils::pack(
+                        (char**)&writePtrs[FMT_ID_STREAM], fmtId));
+            headerNibbles.put(BufferUtils::pack(
+                        (char**)&writePtrs[TIMESTAMP_STREAM],
+                        entry->timestamp - lastTime));
+            lastTime = entry->timestamp;
+
+            if (fmtId < LOG_ID_INT_ARGS_START) {
+                const char *arg = entry->argData;
+                for (int p = 0; p < numArgs; ++p) {
+                    size_t length = strlen(arg) + 1;
+                    memcpy(writePtrs[dataStream(p)], arg, length);
+                    writePtrs[dataStream(p)] += length;
+                    arg += length;
+                }
+            } else if (fmtId < LOG_ID_LONG_ARGS_START) {
+                auto *args = reinterpret_cast<const int*>(entry->argData);
+                for (int p = 0; p < numArgs; ++p) {
+                    nibbles[p].put(BufferUtils::pack(
+                                (char**)&writePtrs[dataStream(p)], args[p]));
+                }
+            } else if (fmtId < LOG_ID_DBL_ARGS_START) {
+                auto *args = reinterpret_cast<const long*>(entry->argData);
+                for (int p = 0; p < numArgs; ++p) {
+                    nibbles[p].put(BufferUtils::pack(
+                                (char**)&writePtrs[dataStream(p)], args[p]));
+                }
+            } else if (fmtId >= LOG_ID_FORMAT_START) {
+                scatterFormatArgs(entry, writePtrs, nibbles);
+            } else {
+                // Doubles are incompressible, so just copy them
+                for (int p = 0; p < numArgs; ++p) {
+                    memcpy(writePtrs[dataStream(p)],
+                           entry->argData + p*sizeof(double), sizeof(double));
+                    writePtrs[dataStream(p)] += sizeof(double);
+                }
+            }
+
+            readPos += entry->entrySize;
+        }
+
+        writePtrs[HEADER_NIBBLE_STREAM] = headerNibbles.end();
+        for (int p = 0; p < numPositions; ++p)
+            writePtrs[nibbleStream(p)] = nibbles[p].end();
+
+        // Output the block header followed by the streams
+        long unsigned int blockBytes = (2 + numStreams)*sizeof(uint32_t);
+        for (int i = 0; i < numStreams; ++i)
+            blockBytes += writePtrs[i] - streams[i].data();
+
+        if (writePos + blockBytes > endOfOutput) {
+            fprintf(stderr, "Ran out of space in the output buffer\r\n");
+            return Z_BUF_ERROR;
+        }
+
+        uint32_t blockHeader[2] = {numEntries, uint32_t(numPositions)};
+        memcpy(writePos, blockHeader, sizeof(blockHeader));
+        writePos += sizeof(blockHeader);
+
+        for (int i = 0; i < numStreams; ++i) {
+            uint32_t streamBytes = writePtrs[i] - streams[i].data();
+            memcpy(writePos, &streamBytes, sizeof(uint32_t));
+            writePos += sizeof(uint32_t);
+        }
+
+        for (int i = 0; i < numStreams; ++i) {
+            long unsigned int streamBytes = writePtrs[i] - streams[i].data();
+            memcpy(writePos, streams[i].data(), streamBytes);
+            writePos += streamBytes;
+        }
+    }
+
+    *outputSize = writePos - outputBuffer;
+    return Z_OK;
+}
+
+// See Header
+int
+ColumnarCompressor::uncompress(unsigned char *outputBuffer,
+                               long unsigned int *outputSize,
+                               const unsigned char *inputBuffer,
+                               long unsigned int inputSize)
+{
+    using namespace NanoLogInternal;
+
+    const unsigned char *readPos = inputBuffer;
+    const unsigned char *endOfInput = inputBuffer + inputSize;
+    unsigned char *writePos = outputBuffer;
+    unsigned char *endOfOutput = outputBuffer + *outputSize;
+
+    const char *readPtrs[MAX_STREAMS];
+    NibbleReader nibbles[LOG_ID_MAX_ARGS];
+    NibbleReader headerNibbles;
+
+    while (readPos < endOfInput) {
+        uint32_t blockHeader[2];
+        if (readPos + sizeof(blockHeader) > endOfInput)
+            return Z_DATA_ERROR;
+
+        memcpy(blockHeader, readPos, sizeof(blockHeader));
+        readPos += sizeof(blockHeader);
+
+        uint32_t numEntries = blockHeader[0];
+        if (blockHeader[1] > LOG_ID_MAX_ARGS)
+            return Z_DATA_ERROR;
+        int numPositions = blockHeader[1];
+
+        int numStreams = NUM_HEADER_STREAMS + 2*numPositions;
+        const unsigned char *streamStart = readPos +
+                                                numStreams*sizeof(uint32_t);
+        if (streamStart > endOfInput)
+            return Z_DATA_ERROR;
+
+        for (int i = 0; i < numStreams; ++i) {
+            uint32_t streamBytes;
+            memcpy(&streamBytes, readPos + i*sizeof(uint32_t),
+                   sizeof(uint32_t));
+            readPtrs[i] = reinterpret_cast<const char*>(streamStart);
+            streamStart += streamBytes;
+        }
+
+        if (streamStart > endOfInput)
+            return Z_DATA_ERROR;
+
+        headerNibbles.reset(
+                reinterpret_cast<const unsigned char*>(readPtrs[0]));
+        for (int p = 0; p < numPositions; ++p) {
+            nibbles[p].reset(reinterpret_cast<const unsigned char*>(
+                                                readPtrs[nibbleStream(p)]));
+        }
+
+        // Gather the streams back into entries
+        uint64_t lastTime = 0;
+        for (uint32_t e = 0; e < numEntries; ++e) {
+            uint8_t fmtIdNibble = headerNibbles.get();
+            uint8_t timestampNibble = headerNibbles.get();
+            uint32_t fmtId = BufferUtils::unpack<uint32_t>(
+                                    &readPtrs[FMT_ID_STREAM], fmtIdNibble);
+            uint64_t timestamp = lastTime + BufferUtils::unpack<uint64_t>(
+                            &readPtrs[TIMESTAMP_STREAM], timestampNibble);
+            lastTime = timestamp;
+
+            int numArgs = getNumArgs(fmtId);
+            if (numArgs < 0 || numArgs > numPositions)
+                return Z_DATA_ERROR;
+
+            if (writePos + sizeof(Log::UncompressedEntry) > endOfOutput)
+                return Z_BUF_ERROR;
+
+            auto entry = reinterpret_cast<Log::UncompressedEntry*>(writePos);
+            entry->fmtId = fmtId;
+            entry->timestamp = timestamp;
+            writePos += sizeof(Log::UncompressedEntry);
+
+            if (fmtId < LOG_ID_INT_ARGS_START) {
+                for (int p = 0; p < numArgs; ++p) {
+                    const char *&arg = readPtrs[dataStream(p)];
+                    size_t length = strnlen(arg,
+                                    (const char*)streamStart - arg) + 1;
+                    if (writePos + length > endOfOutput)
+                        return Z_BUF_ERROR;
+
+                    memcpy(writePos, arg, length);
+                    writePos += length;
+                    arg += length;
+                }
+            } else if (fmtId < LOG_ID_LONG_ARGS_START) {
+                if (writePos + numArgs*sizeof(int) > endOfOutput)
+                    return Z_BUF_ERROR;
+
+                for (int p = 0; p < numArgs; ++p) {
+                    int arg = BufferUtils::unpack<int>(
+                            &readPtrs[dataStream(p)], nibbles[p].get());
+                    memcpy(writePos, &arg, sizeof(int));
+                    writePos += sizeof(int);
+                }
+            } else if (fmtId < LOG_ID_DBL_ARGS_START) {
+                if (writePos + numArgs*sizeof(long) > endOfOutput)
+                    return Z_BUF_ERROR;
+
+                for (int p = 0; p < numArgs; ++p) {
+                    long arg = BufferUtils::unpack<long>(
+                            &readPtrs[dataStream(p)], nibbles[p].get());
+                    memcpy(writePos, &arg, sizeof(long));
+                    writePos += sizeof(long);
+                }
+            } else if (fmtId >= LOG_ID_FORMAT_START) {
+                int retVal = gatherFormatArgs(
+                                FormatRegistry::getSignature(fmtId), readPtrs,
+                                (const char*)streamStart, nibbles, &writePos,
+                                endOfOutput);
+                if (retVal != Z_OK)
+                    return retVal;
+            } else {
+                if (writePos + numArgs*sizeof(double) > endOfOutput)
+                    return Z_BUF_ERROR;
+
+                for (int p = 0; p < numArgs; ++p) {
+                    memcpy(writePos, readPtrs[dataStream(p)], sizeof(double));
+                    readPtrs[dataStream(p)] += sizeof(double);
+                    writePos += sizeof(double);
+                }
+            }
+
+            entry->entrySize =
+                    writePos - reinterpret_cast<unsigned char*>(entry);
+        }
+
+        readPos = streamStart;
+    }
+
+    *outputSize = writePos - outputBuffer;
+    return Z_OK;
+}
@@ -0,0 +1,112 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef COMPRESSION_COLUMNAR_COMPRESSOR_H
+#define COMPRESSION_COLUMNAR_COMPRESSOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Logger.h"
+
+/**
+ * ColumnarCompressor applies the NanoLog compaction scheme to
+ * binaryLogWithArgs() data, but lays the output out column-wise instead of
+ * entry after entry like NanoLogCompress2(). The input is split into blocks
+ * of up to BLOCK_BYTES of uncompressed data and, within a block, every
+ * "column" is stored in its own contiguous stream:
+ *
+ *      uint32_t numEntries
+ *      uint32_t numPositions                (max arguments of any entry)
+ *      uint32_t streamBytes[3 + 2*numPositions]
+ *      <header nibbles>    one byte per entry; fmtId and timestamp lengths
+ *      <fmtIds>            packed fmtIds
+ *      <timestamps>        packed timestamp deltas
+ *      for each argument position p in [0, numPositions):
+ *          <nibbles p>     nibbles of the int/long arguments at position p
+ *          <data p>        packed int/long, raw double and string arguments
+ *                          at position p
+ *
+ * Grouping similar values together makes the output far more amenable to a
+ * secondary compression pass and to decoding a whole column at a time. The
+ * timestamp delta base restarts at every block so blocks can be decoded
+ * independently.
+ */
+class ColumnarCompressor {
+public:
+    ColumnarCompressor();
+
+    /**
+     * Compacts inputBuffer into the columnar block format. It has the same
+     * API as zlib's compress function except the compressionLevel parameter
+     * is omitted.
+     *
+     * \param outputBuffer
+     *      Output buffer to store the compacted blocks
+     * \param outputSize
+     *      Initially set by the caller to indicate the size of outputBuffer.
+     *      On return, it is set to the number of bytes actually used.
+     * \param inputBuffer
+     *      Buffer that contains data generated by binaryLogWithArgs()
+     * \param inputSize
+     *      Number of bytes to consume in the inputBuffer
+     *
+     * \return
+     *      Same as libz's return status's
+     */
+    int compress(unsigned char *outputBuffer, long unsigned int *outputSize,
+                 const unsigned char *inputBuffer, long unsigned int inputSize);
+
+    /**
+     * Reverses compress(); i.e. decodes the columnar blocks and reconstructs
+     * the original binaryLogWithArgs() log entries in outputBuffer. It has
+     * the same API as zlib's uncompress function.
+     *
+     * \param outputBuffer
+     *      Output buffer to store the reconstructed log entries
+     * \param outputSize
+     *      Initially set by the caller to indicate the size of outputBuffer.
+     *      On return, it is set to the number of bytes actually used.
+     * \param inputBuffer
+     *      Buffer containing the output of compress()
+     * \param inputSize
+     *      Number of valid bytes in the buffer
+     *
+     * \return
+     *      Same as libz's return status's
+     */
+    static int uncompress(unsigned char *outputBuffer,
+                          long unsigned int *outputSize,
+                          const unsigned char *inputBuffer,
+                          long unsigned int inputSize);
+
+    // Maximum number of bytes of uncompressed data to put in one block
+    // (a single entry larger than this will get a block of its own).
+    static const long unsigned int BLOCK_BYTES = 64*1024;
+
+private:
+    // Streams for the entry headers (header nibbles, fmtIds, timestamps)
+    // that precede the per argument position streams in a block.
+    static const int NUM_HEADER_STREAMS = 3;
+
+    // Maximum number of streams a block can have
+    static const int MAX_STREAMS = NUM_HEADER_STREAMS +
+                                        2*LoggerInternals::LOG_ID_MAX_ARGS;
+
+    // Scratch buffers that the streams of the current block are built in
+    // before being copied out to the output buffer.
+    std::vector<unsigned char> streams[MAX_STREAMS];
+};
+
+#endif //COMPRESSION_COLUMNAR_COMPRESSOR_H
@@ -16,6 +16,7 @@
 #include <cstdint>
 
 #include <random>
+#include <vector>
 
 /**
  * This class generates random words at the frequency in which they appear on
@@ -35,13 +36,23 @@ class RandomWordGenerator {
     // Limits the words the class generates to the top N most common words.
     unsigned long int wordLimit;
 
+    // Alias table over the top wordLimit words (see buildAliasTable()). Word
+    // i is returned when a uniformly drawn occurrence index falls below
+    // aliasThreshold[i], and word aliasIndex[i] otherwise.
+    std::vector<uint64_t> aliasThreshold;
+    std::vector<uint32_t> aliasIndex;
+
+    void buildAliasTable();
+
 public:
     /**
      * Create a RandomWordGenerator with a seed
      */
     explicit RandomWordGenerator(unsigned int seed=0)
             : generator(seed)
-            , wordLimit(numUniqueWords) {}
+            , wordLimit(numUniqueWords)
+            , aliasThreshold()
+            , aliasIndex() {}
 
     /**
      * Resets the state of the word generator
@@ -75,12 +86,18 @@ public:
         if (wordLimit <= 0 || wordLimit > numUniqueWords)
             wordLimit = numUniqueWords;
 
+        // Rebuilt lazily by the next getRandomWord()
+        aliasThreshold.clear();
+        aliasIndex.clear();
+
         return wordLimit;
     }
 
     /**
      * Returns a random word. The frequency at which words appear is directly
-     * proportional their occurence on the Internet.
+     * proportional their occurence on the Internet. Takes constant time,
+     * apart from the first call after the word limit changes, which builds
+     * the alias table.
      *
      * \return
      *      A pointer to a statically allocated word (valid for the lifetime of
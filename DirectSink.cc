@@ -0,0 +1,362 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "DirectSink.h"
+
+DirectSink::DirectSink()
+    : fd(-1)
+    , direct(false)
+    , buffer(nullptr)
+    , capacity(0)
+    , submitted(0)
+    , inFlight(0)
+    , failed(false)
+    , ringFd(-1)
+    , sqRing(MAP_FAILED)
+    , sqRingSize(0)
+    , cqRing(MAP_FAILED)
+    , cqRingSize(0)
+    , sqes(nullptr)
+    , sqesSize(0)
+    , sqTail(nullptr)
+    , sqMask(nullptr)
+    , sqArray(nullptr)
+    , cqHead(nullptr)
+    , cqTail(nullptr)
+    , cqMask(nullptr)
+    , cqes(nullptr)
+{
+}
+
+DirectSink::~DirectSink()
+{
+    if (inFlight > 0)
+        reap(inFlight);
+
+    closeRing();
+
+    if (fd >= 0)
+        close(fd);
+
+    free(buffer);
+}
+
+// See Header
+bool
+DirectSink::open(const char *path, size_t capacity)
+{
+    fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    direct = fd >= 0;
+    if (fd < 0 && errno == EINVAL)
+        fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0) {
+        fprintf(stderr, "Could not open %s for writing: %s\r\n", path,
+                strerror(errno));
+        return false;
+    }
+
+    if (!direct) {
+        fprintf(stderr, "The file system of %s doesn't support O_DIRECT; "
+                "writes will go through the page cache\r\n", path);
+    }
+
+    this->capacity = (capacity + ALIGNMENT - 1)/ALIGNMENT*ALIGNMENT;
+    void *memory;
+    if (posix_memalign(&memory, ALIGNMENT, this->capacity) != 0) {
+        fprintf(stderr, "Could not allocate the %lu byte buffer of the "
+                "sink\r\n", this->capacity);
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    buffer = static_cast<unsigned char*>(memory);
+
+    // Fault the buffer in now so that the first data written to it doesn't
+    // pay for it, like a logger's long-lived buffer
+    memset(buffer, 0, this->capacity);
+
+    if (!setupRing()) {
+        fprintf(stderr, "Could not set up an io_uring: %s; writes will be "
+                "synchronous\r\n", strerror(errno));
+        closeRing();
+    }
+
+    return true;
+}
+
+/**
+ * Creates the io_uring the writes are queued on and maps its rings. There's
+ * no liburing dependency; this is the setup io_uring_setup(2) documents.
+ *
+ * \return
+ *      False if the kernel refused, with errno set
+ */
+bool
+DirectSink::setupRing()
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd = static_cast<int>(syscall(__NR_io_uring_setup, QUEUE_DEPTH,
+                                      &params));
+    if (ringFd < 0)
+        return false;
+
+    sqRingSize = params.sq_off.array + params.sq_entries*sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries*sizeof(io_uring_cqe);
+    sqesSize = params.sq_entries*sizeof(io_uring_sqe);
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    void *sqesMemory = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ringFd,
+                            IORING_OFF_SQES);
+    if (sqRing == MAP_FAILED || cqRing == MAP_FAILED ||
+            sqesMemory == MAP_FAILED) {
+        if (sqesMemory != MAP_FAILED)
+            munmap(sqesMemory, sqesSize);
+        return false;
+    }
+
+    char *sq = static_cast<char*>(sqRing);
+    char *cq = static_cast<char*>(cqRing);
+    sqes = static_cast<io_uring_sqe*>(sqesMemory);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+/**
+ * Unmaps the rings and closes the io_uring, if any, which makes the writes
+ * synchronous.
+ */
+void
+DirectSink::closeRing()
+{
+    if (sqes != nullptr)
+        munmap(sqes, sqesSize);
+    if (sqRing != MAP_FAILED)
+        munmap(sqRing, sqRingSize);
+    if (cqRing != MAP_FAILED)
+        munmap(cqRing, cqRingSize);
+    if (ringFd >= 0)
+        close(ringFd);
+
+    sqes = nullptr;
+    sqRing = MAP_FAILED;
+    cqRing = MAP_FAILED;
+    ringFd = -1;
+}
+
+// See Header
+const char *
+DirectSink::getMode() const
+{
+    if (ringFd >= 0)
+        return direct ? "io_uring/O_DIRECT" : "io_uring/buffered";
+    return direct ? "pwrite/O_DIRECT" : "pwrite/buffered";
+}
+
+// See Header
+bool
+DirectSink::reset()
+{
+    if (inFlight > 0)
+        reap(inFlight);
+
+    submitted = 0;
+    failed = false;
+    if (ftruncate(fd, 0) != 0) {
+        fprintf(stderr, "Could not truncate the sink's file: %s\r\n",
+                strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Writes a part of the buffer to the same offset of the file: queued on the
+ * io_uring, after waiting for a write to complete if QUEUE_DEPTH are in
+ * flight, or synchronously without one.
+ *
+ * \param offset
+ *      Offset of the part; a multiple of ALIGNMENT
+ * \param length
+ *      Length of the part; a multiple of ALIGNMENT
+ *
+ * \return
+ *      False if the write (or an earlier one) failed
+ */
+bool
+DirectSink::submitWrite(size_t offset, size_t length)
+{
+    if (ringFd < 0) {
+        while (length > 0 && !failed) {
+            ssize_t written = pwrite(fd, buffer + offset, length, offset);
+            if (written < 0 && errno == EINTR)
+                continue;
+
+            if (written <= 0) {
+                fprintf(stderr, "Writing to the sink failed: %s\r\n",
+                        (written < 0) ? strerror(errno) : "no progress");
+                failed = true;
+            } else {
+                offset += written;
+                length -= written;
+            }
+        }
+        return !failed;
+    }
+
+    if (inFlight == QUEUE_DEPTH && !reap(1))
+        return false;
+
+    // The kernel only reads the submission queue tail, so the sink, its
+    // only producer, can read it plainly; the release store publishes the
+    // entry to the kernel
+    unsigned tail = *sqTail;
+    unsigned index = tail & *sqMask;
+    io_uring_sqe *sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer + offset);
+    sqe->len = static_cast<uint32_t>(length);
+    sqe->off = offset;
+    sqe->user_data = length;
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    int submittedEntries;
+    do {
+        submittedEntries = static_cast<int>(syscall(__NR_io_uring_enter,
+                ringFd, 1, 0, 0, nullptr, 0));
+    } while (submittedEntries < 0 && errno == EINTR);
+
+    if (submittedEntries != 1) {
+        fprintf(stderr, "Submitting a write to the sink failed: %s\r\n",
+                (submittedEntries < 0) ? strerror(errno) : "not consumed");
+        failed = true;
+        return false;
+    }
+
+    ++inFlight;
+    return !failed;
+}
+
+/**
+ * Consumes the completions of the writes in flight, waiting until at least
+ * a number of them are in.
+ *
+ * \param minCompletions
+ *      Completions to wait for; 0 only consumes the ones already in
+ *
+ * \return
+ *      False if a write failed
+ */
+bool
+DirectSink::reap(unsigned minCompletions)
+{
+    while (true) {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe *cqe = &cqes[head & *cqMask];
+            if (cqe->res < 0 || static_cast<uint64_t>(cqe->res) !=
+                                                            cqe->user_data) {
+                if (!failed) {
+                    fprintf(stderr, "Writing to the sink failed: %s\r\n",
+                            (cqe->res < 0) ? strerror(-cqe->res)
+                                           : "short write");
+                }
+                failed = true;
+            }
+
+            --inFlight;
+            if (minCompletions > 0)
+                --minCompletions;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+
+        if (minCompletions == 0 || inFlight == 0)
+            break;
+
+        int ret = static_cast<int>(syscall(__NR_io_uring_enter, ringFd, 0,
+                minCompletions, IORING_ENTER_GETEVENTS, nullptr, 0));
+        if (ret < 0 && errno != EINTR) {
+            fprintf(stderr, "Waiting for the sink's writes failed: %s\r\n",
+                    strerror(errno));
+            failed = true;
+            return false;
+        }
+    }
+
+    return !failed;
+}
+
+// See Header
+bool
+DirectSink::submit(size_t length)
+{
+    while (submitted + CHUNK_SIZE <= length && !failed) {
+        submitWrite(submitted, CHUNK_SIZE);
+        submitted += CHUNK_SIZE;
+    }
+
+    if (inFlight > 0)
+        reap(0);
+
+    return !failed;
+}
+
+// See Header
+bool
+DirectSink::finish(size_t length)
+{
+    submit(length);
+    if (submitted < length && !failed) {
+        size_t rest = (length - submitted + ALIGNMENT - 1)/ALIGNMENT*ALIGNMENT;
+        submitWrite(submitted, rest);
+        submitted = length;
+    }
+
+    if (inFlight > 0)
+        reap(inFlight);
+
+    if (ftruncate(fd, length) != 0) {
+        fprintf(stderr, "Could not truncate the sink's file: %s\r\n",
+                strerror(errno));
+        failed = true;
+    }
+
+    return !failed;
+}
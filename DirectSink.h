@@ -0,0 +1,174 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef COMPRESSION_DIRECT_SINK_H
+#define COMPRESSION_DIRECT_SINK_H
+
+#include <cstddef>
+#include <cstdint>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * DirectSink writes compressed logs to a file the way a logger bypassing the
+ * page cache would: from a buffer aligned for O_DIRECT, in CHUNK_SIZE writes
+ * queued on an io_uring so that compression can continue while up to
+ * QUEUE_DEPTH of them are in flight. This measures the real cost of the
+ * writes and how much of it compression actually hides, which the
+ * benchmark's "Output (s)" and "Max (s)" metrics only model.
+ *
+ * The data is compressed straight into getBuffer(); submit() hands the
+ * sink every full chunk as the data grows and finish() the remainder.
+ * Without io_uring (e.g. an older kernel or a seccomp policy forbidding it)
+ * the writes are made synchronously with pwrite(), and without O_DIRECT
+ * support (e.g. an older tmpfs) they go through the page cache; getMode()
+ * tells which.
+ *
+ * The sink isn't thread safe.
+ */
+class DirectSink {
+public:
+    // Alignment of the buffer, file offsets and lengths O_DIRECT requires
+    // (the largest logical block size in common use)
+    static const size_t ALIGNMENT = 4096;
+
+    // Size of the writes submitted
+    static const size_t CHUNK_SIZE = 1024*1024;
+
+    // Most writes in flight at once; submit() waits for the oldest to
+    // complete before queuing more
+    static const unsigned QUEUE_DEPTH = 8;
+
+    DirectSink();
+    ~DirectSink();
+
+    /**
+     * Creates (or truncates) the file the sink writes to and sets up its
+     * buffer and io_uring. Prints the reason to stderr if it fails.
+     *
+     * \param path
+     *      File to write to, e.g. on the device or tmpfs to measure
+     * \param capacity
+     *      Most bytes written to the file at once
+     *
+     * \return
+     *      False if the file couldn't be opened or the buffer allocated
+     */
+    bool open(const char *path, size_t capacity);
+
+    bool isOpen() const {
+        return fd >= 0;
+    }
+
+    /**
+     * Returns how the sink writes: "io_uring/O_DIRECT", "io_uring/buffered",
+     * "pwrite/O_DIRECT" or "pwrite/buffered"
+     */
+    const char *getMode() const;
+
+    /**
+     * Returns the buffer to place the data to write in; it's aligned and
+     * holds the capacity open() was given.
+     */
+    unsigned char *getBuffer() const {
+        return buffer;
+    }
+
+    size_t getCapacity() const {
+        return capacity;
+    }
+
+    /**
+     * Empties the file so that the next data written starts at its
+     * beginning, like a new log file.
+     *
+     * \return
+     *      False if the file couldn't be truncated
+     */
+    bool reset();
+
+    /**
+     * Queues the writes of the full chunks of the buffer up to a length
+     * that haven't been submitted yet. Returns once they're queued, unless
+     * QUEUE_DEPTH writes are already in flight.
+     *
+     * \param length
+     *      Bytes at the start of the buffer that are ready to be written
+     *
+     * \return
+     *      False if a write failed
+     */
+    bool submit(size_t length);
+
+    /**
+     * Writes the rest of the buffer up to a length, padded to ALIGNMENT,
+     * waits for every write to complete and truncates the file to the
+     * length.
+     *
+     * \param length
+     *      Bytes at the start of the buffer to write; at most the capacity
+     *
+     * \return
+     *      False if a write failed
+     */
+    bool finish(size_t length);
+
+private:
+    bool setupRing();
+    void closeRing();
+    bool submitWrite(size_t offset, size_t length);
+    bool reap(unsigned minCompletions);
+
+    // File written to, or -1 before open()
+    int fd;
+
+    // True if the file was opened with O_DIRECT
+    bool direct;
+
+    // Aligned buffer of the data written and the bytes it holds
+    unsigned char *buffer;
+    size_t capacity;
+
+    // Bytes of the buffer whose writes have been submitted
+    size_t submitted;
+
+    // Writes submitted but not yet completed
+    unsigned inFlight;
+
+    // Set once a write fails, until the next reset()
+    bool failed;
+
+    // File descriptor of the io_uring, or -1 if writes are synchronous
+    int ringFd;
+
+    // Memory mapped rings shared with the kernel (see io_uring_setup(2))
+    void *sqRing;
+    size_t sqRingSize;
+    void *cqRing;
+    size_t cqRingSize;
+    io_uring_sqe *sqes;
+    size_t sqesSize;
+
+    // Positions of the ring indices and arrays in the mapped rings
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    io_uring_cqe *cqes;
+};
+
+#endif //COMPRESSION_DIRECT_SINK_H
@@ -0,0 +1,123 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "FormatRegistry.h"
+
+std::deque<FormatSignature> FormatRegistry::signatures;
+
+/**
+ * Parses the conversion specifications of a printf-style format string into
+ * the types of the arguments they consume.
+ *
+ * \param format
+ *      Format string to parse
+ * \param[out] argTypes
+ *      Types of the arguments consumed, in order
+ */
+static void
+parseFormat(const char *format, std::vector<LogArgType> *argTypes)
+{
+    const char *pos = format;
+    while ((pos = strchr(pos, '%')) != nullptr) {
+        ++pos;
+        if (*pos == '%') {
+            ++pos;
+            continue;
+        }
+
+        // Flags
+        pos += strspn(pos, "-+ #0'");
+
+        // Width and precision; a '*' takes its value from an int argument
+        if (*pos == '*') {
+            argTypes->push_back(LOG_ARG_INT);
+            ++pos;
+        }
+        pos += strspn(pos, "0123456789");
+
+        if (*pos == '.') {
+            ++pos;
+            if (*pos == '*') {
+                argTypes->push_back(LOG_ARG_INT);
+                ++pos;
+            }
+            pos += strspn(pos, "0123456789");
+        }
+
+        // Length modifiers; anything at least as wide as a long is a long
+        bool isLong = false;
+        while (*pos != '\0' && strchr("hlLqjzt", *pos) != nullptr) {
+            isLong |= (*pos != 'h');
+            ++pos;
+        }
+
+        switch (*pos) {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+            case 'c':
+                argTypes->push_back(isLong ? LOG_ARG_LONG : LOG_ARG_INT);
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+            case 'a': case 'A':
+                argTypes->push_back(LOG_ARG_DOUBLE);
+                break;
+            case 's':
+                argTypes->push_back(LOG_ARG_STRING);
+                break;
+            case 'p':
+                argTypes->push_back(LOG_ARG_LONG);
+                break;
+            case '\0':
+                return;
+            default:
+                // %n and invalid conversions don't consume an argument
+                break;
+        }
+
+        ++pos;
+    }
+}
+
+// See Header
+uint32_t
+FormatRegistry::registerFormat(const char *format)
+{
+    std::vector<LogArgType> argTypes;
+    parseFormat(format, &argTypes);
+    return registerSignature(format, argTypes);
+}
+
+// See Header
+uint32_t
+FormatRegistry::registerSignature(const char *format,
+                                  const std::vector<LogArgType> &argTypes)
+{
+    if (argTypes.size() >= LoggerInternals::LOG_ID_MAX_ARGS) {
+        fprintf(stderr, "Format \"%s\" has too many arguments (%lu)\r\n",
+                format, argTypes.size());
+        exit(1);
+    }
+
+    signatures.emplace_back();
+    FormatSignature &signature = signatures.back();
+    signature.format = format;
+    signature.numArgs = argTypes.size();
+    std::copy(argTypes.begin(), argTypes.end(), signature.argTypes);
+
+    return LoggerInternals::LOG_ID_FORMAT_START + signatures.size() - 1;
+}
@@ -0,0 +1,110 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef COMPRESSION_FORMAT_REGISTRY_H
+#define COMPRESSION_FORMAT_REGISTRY_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Logger.h"
+
+/**
+ * Argument types of a log statement registered with the FormatRegistry, in
+ * the order they appear in the log entry.
+ */
+struct FormatSignature {
+    // printf-style format string of the log statement
+    std::string format;
+
+    // Number of arguments the log statement has
+    int numArgs;
+
+    // Type of every argument (never LOG_ARG_MIXED)
+    LogArgType argTypes[LoggerInternals::LOG_ID_MAX_ARGS];
+};
+
+/**
+ * FormatRegistry plays the role of the dictionary NanoLog's preprocessor
+ * generates: it assigns a fmtId to every log statement registered and
+ * records the type of each of its arguments, so that log statements that mix
+ * argument types can be logged, compacted and decoded like the homogeneous
+ * ones whose types are implied by their fmtId.
+ *
+ * The registry is global since the compressors follow zlib's API. Formats
+ * must be registered before any log entries using them are compressed or
+ * decoded, and registration must not run concurrently with either.
+ */
+class FormatRegistry {
+public:
+    /**
+     * Registers a log statement, deriving the types of its arguments from
+     * the conversion specifications in its printf-style format string (e.g.
+     * "%d" is an int, "%lu" a long, "%.2f" a double, "%s" a string, and a
+     * '*' width or precision an additional int argument).
+     *
+     * \param format
+     *      printf-style format string of the log statement
+     *
+     * \return
+     *      fmtId to log the statement's entries with
+     */
+    static uint32_t registerFormat(const char *format);
+
+    /**
+     * Registers a log statement with explicitly specified argument types.
+     *
+     * \param format
+     *      printf-style format string of the log statement (only recorded)
+     * \param argTypes
+     *      Types of the statement's arguments; none can be LOG_ARG_MIXED
+     *
+     * \return
+     *      fmtId to log the statement's entries with
+     */
+    static uint32_t registerSignature(const char *format,
+                                      const std::vector<LogArgType> &argTypes);
+
+    /**
+     * Returns the signature registered for a fmtId, or nullptr if the fmtId
+     * wasn't handed out by the registry.
+     *
+     * \param fmtId
+     *      fmtId of the log entry
+     */
+    static const FormatSignature *getSignature(uint32_t fmtId) {
+        uint32_t index = fmtId - LoggerInternals::LOG_ID_FORMAT_START;
+        if (fmtId < LoggerInternals::LOG_ID_FORMAT_START ||
+                index >= signatures.size())
+            return nullptr;
+
+        return &signatures[index];
+    }
+
+    /**
+     * Returns the number of log statements registered so far
+     */
+    static uint32_t getNumFormats() {
+        return signatures.size();
+    }
+
+private:
+    // Signatures of the registered log statements, indexed by their fmtId
+    // relative to LOG_ID_FORMAT_START. A deque so that registering more
+    // statements doesn't move the ones handed out by getSignature().
+    static std::deque<FormatSignature> signatures;
+};
+
+#endif //COMPRESSION_FORMAT_REGISTRY_H
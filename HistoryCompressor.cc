@@ -0,0 +1,794 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <type_traits>
+
+#include "FormatRegistry.h"
+#include "HistoryCompressor.h"
+
+/**
+ * Packs one int/long argument, optionally as the zigzag encoded difference
+ * from the previous value in its slot.
+ *
+ * \param[in/out] writePos
+ *      Buffer to pack the argument into (pointer will be incremented)
+ * \param value
+ *      Argument to pack
+ * \param[in/out] slot
+ *      Previous value of the argument slot; updated to value
+ * \param deltaEncode
+ *      True means pack the difference from the slot instead of the value
+ *
+ * \return
+ *      Nibble describing the packed value (see BufferUtils::pack())
+ */
+template<typename T>
+static inline uint8_t
+packArg(unsigned char **writePos, T value, uint64_t *slot, bool deltaEncode)
+{
+    typedef typename std::make_unsigned<T>::type Unsigned;
+
+    if (!deltaEncode)
+        return BufferUtils::pack((char**)writePos, value);
+
+    // Wrapping unsigned arithmetic makes the difference exact at any width
+    Unsigned delta = static_cast<Unsigned>(value) -
+                     static_cast<Unsigned>(*slot);
+    *slot = static_cast<Unsigned>(value);
+
+    // Zigzag so that small negative differences are small as well
+    Unsigned zigzag = (delta << 1) ^ static_cast<Unsigned>(
+                        static_cast<T>(delta) >> (8*sizeof(T) - 1));
+    return BufferUtils::pack((char**)writePos, zigzag);
+}
+
+/**
+ * Reverses packArg().
+ *
+ * \param[in/out] readPos
+ *      Buffer to unpack the argument from (pointer will be incremented)
+ * \param nibble
+ *      Nibble returned by packArg()
+ * \param[in/out] slot
+ *      Previous value of the argument slot; updated to the value unpacked
+ * \param deltaEncode
+ *      Must match the deltaEncode packArg() was invoked with
+ */
+template<typename T>
+static inline T
+unpackArg(const char **readPos, uint8_t nibble, uint64_t *slot,
+          bool deltaEncode)
+{
+    typedef typename std::make_unsigned<T>::type Unsigned;
+
+    if (!deltaEncode)
+        return BufferUtils::unpack<T>(readPos, nibble);
+
+    Unsigned zigzag = BufferUtils::unpack<Unsigned>(readPos, nibble);
+    Unsigned delta = (zigzag >> 1) ^ (Unsigned(0) - (zigzag & 1));
+    Unsigned value = static_cast<Unsigned>(*slot) + delta;
+    *slot = value;
+
+    return static_cast<T>(value);
+}
+
+/**
+ * Packs a run of int/long arguments two nibbles at a time, just like
+ * NanoLogCompress2() does.
+ *
+ * \param[in/out] writePos
+ *      Buffer to pack the arguments into (pointer will be incremented)
+ * \param args
+ *      Arguments to pack
+ * \param numArgs
+ *      Number of arguments to pack
+ * \param slots
+ *      History slots of the arguments
+ * \param deltaEncode
+ *      True means delta encode the arguments against their slots
+ */
+template<typename T>
+static inline void
+packArgs(unsigned char **writePos, const T *args, int numArgs,
+         uint64_t *slots, bool deltaEncode)
+{
+    int i = 0;
+    while (i < numArgs) {
+        auto twoNibbles = reinterpret_cast<BufferUtils::TwoNibbles*>(
+                                                                *writePos);
+        **writePos = 0;  // Don't leave junk in an unused nibble
+        *writePos += sizeof(BufferUtils::TwoNibbles);
+
+        twoNibbles->first = packArg(writePos, args[i], &slots[i],
+                                    deltaEncode);
+        if (++i >= numArgs) break;
+
+        twoNibbles->second = packArg(writePos, args[i], &slots[i],
+                                     deltaEncode);
+        ++i;
+    }
+}
+
+/**
+ * Reverses packArgs().
+ *
+ * \param[in/out] readPos
+ *      Buffer to unpack the arguments from (pointer will be incremented)
+ * \param endOfInput
+ *      End of the buffer readPos points into
+ * \param[out] args
+ *      Array to store the unpacked arguments in
+ * \param numArgs
+ *      Number of arguments to unpack
+ * \param slots
+ *      History slots of the arguments
+ * \param deltaEncode
+ *      Must match the deltaEncode packArgs() was invoked with
+ *
+ * \return
+ *      false if the arguments are cut short by endOfInput
+ */
+template<typename T>
+static inline bool
+unpackArgs(const char **readPos, const char *endOfInput, T *args, int numArgs,
+           uint64_t *slots, bool deltaEncode)
+{
+    using namespace LoggerInternals;
+
+    int i = 0;
+    while (i < numArgs) {
+        if (*readPos >= endOfInput)
+            return false;
+
+        auto twoNibbles = reinterpret_cast<
+                                const BufferUtils::TwoNibbles*>(*readPos);
+        int length = getPackedLength(twoNibbles->first);
+        if (i + 1 < numArgs)
+            length += getPackedLength(twoNibbles->second);
+        if (endOfInput - *readPos - 1 < length)
+            return false;
+        *readPos += sizeof(BufferUtils::TwoNibbles);
+
+        args[i] = unpackArg<T>(readPos, twoNibbles->first, &slots[i],
+                               deltaEncode);
+        if (++i >= numArgs) break;
+
+        args[i] = unpackArg<T>(readPos, twoNibbles->second, &slots[i],
+                               deltaEncode);
+        ++i;
+    }
+
+    return true;
+}
+
+/**
+ * Packs a run of double arguments as the XOR with the previous value in
+ * their slots. Each XOR is preceded by a TwoNibbles byte with the number of
+ * its leading (first) and trailing (second) zero bytes, and only the bytes
+ * in between are stored. An XOR of 0 is encoded as 8 leading zero bytes.
+ *
+ * \param[in/out] writePos
+ *      Buffer to pack the arguments into (pointer will be incremented)
+ * \param args
+ *      Arguments to pack
+ * \param numArgs
+ *      Number of arguments to pack
+ * \param slots
+ *      History slots of the arguments
+ */
+static inline void
+packDoubles(unsigned char **writePos, const double *args, int numArgs,
+            uint64_t *slots)
+{
+    for (int i = 0; i < numArgs; ++i) {
+        uint64_t bits;
+        memcpy(&bits, &args[i], sizeof(bits));
+        uint64_t xored = bits ^ slots[i];
+        slots[i] = bits;
+
+        auto zeroBytes = reinterpret_cast<BufferUtils::TwoNibbles*>(
+                                                                *writePos);
+        *writePos += sizeof(BufferUtils::TwoNibbles);
+
+        if (xored == 0) {
+            zeroBytes->first = sizeof(uint64_t);
+            zeroBytes->second = 0;
+            continue;
+        }
+
+        int leading = __builtin_clzll(xored)/8;
+        int trailing = __builtin_ctzll(xored)/8;
+        int meaningful = sizeof(uint64_t) - leading - trailing;
+        zeroBytes->first = leading;
+        zeroBytes->second = trailing;
+
+        xored >>= 8*trailing;
+        memcpy(*writePos, &xored, meaningful);
+        *writePos += meaningful;
+    }
+}
+
+/**
+ * Reverses packDoubles().
+ *
+ * \param[in/out] readPos
+ *      Buffer to unpack the arguments from (pointer will be incremented)
+ * \param endOfInput
+ *      End of the buffer readPos points into
+ * \param[out] args
+ *      Array to store the unpacked arguments in
+ * \param numArgs
+ *      Number of arguments to unpack
+ * \param slots
+ *      History slots of the arguments
+ *
+ * \return
+ *      false if the encoding is malformed or cut short by endOfInput
+ */
+static inline bool
+unpackDoubles(const char **readPos, const char *endOfInput, double *args,
+              int numArgs, uint64_t *slots)
+{
+    for (int i = 0; i < numArgs; ++i) {
+        if (*readPos >= endOfInput)
+            return false;
+
+        auto zeroBytes = reinterpret_cast<
+                                const BufferUtils::TwoNibbles*>(*readPos);
+        int leading = zeroBytes->first;
+        int trailing = zeroBytes->second;
+        int meaningful = sizeof(uint64_t) - leading - trailing;
+        if (meaningful < 0 || endOfInput - *readPos - 1 < meaningful)
+            return false;
+        *readPos += sizeof(BufferUtils::TwoNibbles);
+
+        uint64_t xored = 0;
+        memcpy(&xored, *readPos, meaningful);
+        *readPos += meaningful;
+
+        if (meaningful > 0)
+            slots[i] ^= xored << (8*trailing);
+        memcpy(&args[i], &slots[i], sizeof(double));
+    }
+
+    return true;
+}
+
+/**
+ * Unpacks a run of double arguments that were copied as is.
+ *
+ * \param[in/out] readPos
+ *      Buffer to unpack the arguments from (pointer will be incremented)
+ * \param endOfInput
+ *      End of the buffer readPos points into
+ * \param[out] args
+ *      Array to store the unpacked arguments in
+ * \param numArgs
+ *      Number of arguments to unpack
+ *
+ * \return
+ *      false if the arguments are cut short by endOfInput
+ */
+static inline bool
+unpackRawDoubles(const char **readPos, const char *endOfInput, double *args,
+                 int numArgs)
+{
+    long length = numArgs*sizeof(double);
+    if (endOfInput - *readPos < length)
+        return false;
+
+    memcpy(args, *readPos, length);
+    *readPos += length;
+    return true;
+}
+
+/**
+ * Unpacks a run of NULL terminated string arguments that were copied as is.
+ *
+ * \param[in/out] readPos
+ *      Buffer to unpack the arguments from (pointer will be incremented)
+ * \param endOfInput
+ *      End of the buffer readPos points into
+ * \param[out] args
+ *      Array to store pointers to the unpacked arguments in
+ * \param numArgs
+ *      Number of arguments to unpack
+ *
+ * \return
+ *      false if a string isn't terminated before endOfInput
+ */
+static inline bool
+unpackRawStrings(const char **readPos, const char *endOfInput,
+                 const char **args, int numArgs)
+{
+    for (int i = 0; i < numArgs; ++i) {
+        size_t remaining = endOfInput - *readPos;
+        size_t length = strnlen(*readPos, remaining);
+        if (length == remaining)
+            return false;
+
+        args[i] = *readPos;
+        *readPos += length + 1;
+    }
+
+    return true;
+}
+
+/**
+ * Packs a run of NULL terminated string arguments, replacing the ones found
+ * in the dictionary with a 2 byte big endian reference that has the top bit
+ * set. Other strings are copied verbatim; strings that are empty or start
+ * with a byte that has the top bit set are escaped with a leading 0 byte so
+ * they can't be mistaken for a reference.
+ *
+ * \param[in/out] writePos
+ *      Buffer to pack the arguments into (pointer will be incremented)
+ * \param args
+ *      Arguments to pack, back to back
+ * \param numArgs
+ *      Number of arguments to pack
+ * \param dictionary
+ *      Dictionary of recent strings; strings not found in it are staged and
+ *      the caller must commit() the dictionary once it is done with the
+ *      log entry
+ */
+static inline void
+packStrings(unsigned char **writePos, const char *args, int numArgs,
+            StringDictionary *dictionary)
+{
+    const char *str = args;
+    for (int i = 0; i < numArgs; ++i) {
+        size_t length = strlen(str);
+
+        if (length >= StringDictionary::MIN_LENGTH) {
+            uint32_t index = StringDictionary::getIndex(str, length);
+            if (dictionary->matches(index, str, length)) {
+                (*writePos)[0] = static_cast<unsigned char>(
+                                                        0x80 | (index >> 8));
+                (*writePos)[1] = static_cast<unsigned char>(index);
+                *writePos += 2;
+                str += length + 1;
+                continue;
+            }
+
+            dictionary->stage(str, length);
+        }
+
+        unsigned char firstByte = static_cast<unsigned char>(str[0]);
+        if (firstByte == 0 || (firstByte & 0x80))
+            *(*writePos)++ = 0;
+
+        memcpy(*writePos, str, length + 1);
+        *writePos += length + 1;
+        str += length + 1;
+    }
+}
+
+/**
+ * Reverses packStrings(), except that the strings not found in the
+ * dictionary are only staged; the caller must commit() the dictionary once
+ * it is done with the arguments.
+ *
+ * \param[in/out] readPos
+ *      Buffer to unpack the arguments from (pointer will be incremented)
+ * \param endOfInput
+ *      End of the buffer readPos points into
+ * \param[out] args
+ *      Array to store pointers to the unpacked arguments in
+ * \param numArgs
+ *      Number of arguments to unpack
+ * \param dictionary
+ *      Dictionary of recent strings
+ *
+ * \return
+ *      false if the encoding is malformed
+ */
+static inline bool
+unpackStrings(const char **readPos, const char *endOfInput, const char **args,
+              int numArgs, StringDictionary *dictionary)
+{
+    for (int i = 0; i < numArgs; ++i) {
+        if (*readPos >= endOfInput)
+            return false;
+
+        unsigned char firstByte = static_cast<unsigned char>(**readPos);
+        if (firstByte & 0x80) {
+            if (endOfInput - *readPos < 2)
+                return false;
+
+            uint32_t index = ((firstByte & 0x7f) << 8) |
+                    static_cast<unsigned char>((*readPos)[1]);
+            if (index >= StringDictionary::NUM_ENTRIES)
+                return false;
+
+            args[i] = dictionary->get(index);
+            *readPos += 2;
+            continue;
+        }
+
+        if (firstByte == 0)
+            ++*readPos;
+
+        size_t length = strnlen(*readPos, endOfInput - *readPos);
+        if (*readPos + length >= endOfInput)
+            return false;
+
+        args[i] = *readPos;
+        *readPos += length + 1;
+
+        if (length >= StringDictionary::MIN_LENGTH)
+            dictionary->stage(args[i], length);
+    }
+
+    return true;
+}
+
+/**
+ * Packs the arguments of a log entry whose fmtId was registered with the
+ * FormatRegistry one at a time with the codec for their type. Consecutive
+ * int/long arguments share TwoNibbles bytes like compressFormatArgs() pairs
+ * them up. Strings not found in the dictionary are staged; the caller must
+ * commit() the dictionary once it is done with the log entry.
+ *
+ * \param[in/out] writePos
+ *      Buffer to pack the arguments into (pointer will be incremented)
+ * \param signature
+ *      Signature registered for the entry's fmtId
+ * \param args
+ *      Arguments to pack, back to back
+ * \param slots
+ *      History slots of the arguments
+ * \param options
+ *      Codecs to apply
+ * \param dictionary
+ *      Dictionary of recent strings
+ */
+static inline void
+packFormatArgs(unsigned char **writePos, const FormatSignature *signature,
+               const char *args, uint64_t *slots,
+               const HistoryCompressor::Options &options,
+               StringDictionary *dictionary)
+{
+    const char *arg = args;
+    BufferUtils::TwoNibbles *twoNibbles = nullptr;
+    bool firstNibble = true;
+
+    for (int i = 0; i < signature->numArgs; ++i) {
+        LogArgType argType = signature->argTypes[i];
+
+        if (argType == LOG_ARG_DOUBLE) {
+            double value;
+            memcpy(&value, arg, sizeof(double));
+            arg += sizeof(double);
+
+            if (options.xorDoubles) {
+                packDoubles(writePos, &value, 1, &slots[i]);
+            } else {
+                memcpy(*writePos, &value, sizeof(double));
+                *writePos += sizeof(double);
+            }
+            continue;
+        } else if (argType == LOG_ARG_STRING) {
+            size_t length = strlen(arg) + 1;
+            if (options.stringDictionary) {
+                packStrings(writePos, arg, 1, dictionary);
+            } else {
+                memcpy(*writePos, arg, length);
+                *writePos += length;
+            }
+            arg += length;
+            continue;
+        }
+
+        if (firstNibble) {
+            twoNibbles = reinterpret_cast<BufferUtils::TwoNibbles*>(*writePos);
+            **writePos = 0;  // Don't leave junk in an unused nibble
+            *writePos += sizeof(BufferUtils::TwoNibbles);
+        }
+
+        uint8_t nibble;
+        if (argType == LOG_ARG_INT) {
+            int value;
+            memcpy(&value, arg, sizeof(int));
+            arg += sizeof(int);
+            nibble = packArg(writePos, value, &slots[i],
+                             options.deltaIntegers);
+        } else {
+            long value;
+            memcpy(&value, arg, sizeof(long));
+            arg += sizeof(long);
+            nibble = packArg(writePos, value, &slots[i],
+                             options.deltaIntegers);
+        }
+
+        if (firstNibble)
+            twoNibbles->first = nibble;
+        else
+            twoNibbles->second = nibble;
+        firstNibble = !firstNibble;
+    }
+}
+
+/**
+ * Reverses packFormatArgs(), except that the strings not found in the
+ * dictionary are only staged; the caller must commit() the dictionary once
+ * it is done with the arguments.
+ *
+ * \param[in/out] readPos
+ *      Buffer to unpack the arguments from (pointer will be incremented)
+ * \param endOfInput
+ *      End of the buffer readPos points into
+ * \param signature
+ *      Signature registered for the entry's fmtId
+ * \param[out] args
+ *      Array to store the unpacked arguments in
+ * \param slots
+ *      History slots of the arguments
+ * \param options
+ *      Codecs packFormatArgs() applied
+ * \param dictionary
+ *      Dictionary of recent strings
+ *
+ * \return
+ *      false if the encoding is malformed
+ */
+static inline bool
+unpackFormatArgs(const char **readPos, const char *endOfInput,
+                 const FormatSignature *signature, LogArgument *args,
+                 uint64_t *slots, const HistoryCompressor::Options &options,
+                 StringDictionary *dictionary)
+{
+    using namespace LoggerInternals;
+
+    const BufferUtils::TwoNibbles *twoNibbles = nullptr;
+    bool firstNibble = true;
+
+    for (int i = 0; i < signature->numArgs; ++i) {
+        LogArgType argType = signature->argTypes[i];
+        if (*readPos >= endOfInput)
+            return false;
+
+        if (argType == LOG_ARG_DOUBLE) {
+            if (options.xorDoubles) {
+                if (!unpackDoubles(readPos, endOfInput, &args[i].doubleArg, 1,
+                                   &slots[i]))
+                    return false;
+            } else if (!unpackRawDoubles(readPos, endOfInput,
+                                         &args[i].doubleArg, 1)) {
+                return false;
+            }
+            continue;
+        } else if (argType == LOG_ARG_STRING) {
+            if (options.stringDictionary) {
+                if (!unpackStrings(readPos, endOfInput, &args[i].stringArg, 1,
+                                   dictionary))
+                    return false;
+            } else if (!unpackRawStrings(readPos, endOfInput,
+                                         &args[i].stringArg, 1)) {
+                return false;
+            }
+            continue;
+        }
+
+        if (firstNibble) {
+            twoNibbles = reinterpret_cast<
+                                const BufferUtils::TwoNibbles*>(*readPos);
+            *readPos += sizeof(BufferUtils::TwoNibbles);
+        }
+
+        uint8_t nibble = firstNibble ? twoNibbles->first : twoNibbles->second;
+        if (endOfInput - *readPos < getPackedLength(nibble))
+            return false;
+
+        if (argType == LOG_ARG_INT)
+            args[i].intArg = unpackArg<int>(readPos, nibble, &slots[i],
+                                            options.deltaIntegers);
+        else
+            args[i].longArg = unpackArg<long>(readPos, nibble, &slots[i],
+                                              options.deltaIntegers);
+        firstNibble = !firstNibble;
+    }
+
+    return true;
+}
+
+HistoryCompressor::HistoryCompressor(const Options &options)
+    : options(options)
+    , history()
+    , dictionary()
+{
+}
+
+// See Header
+int
+HistoryCompressor::compress(unsigned char *outputBuffer,
+                            long unsigned int *outputSize,
+                            const unsigned char *inputBuffer,
+                            long unsigned int inputSize)
+{
+    using namespace NanoLogInternal;
+    using namespace LoggerInternals;
+
+    const unsigned char *readPos = inputBuffer;
+    const unsigned char *endOfInput = inputBuffer + inputSize;
+    unsigned char *writePos = outputBuffer;
+    unsigned char *endOfOutput = outputBuffer + *outputSize;
+
+    history.reset();
+    dictionary.reset();
+
+    uint64_t lastTime = 0;
+    while (readPos < endOfInput) {
+        auto entry = reinterpret_cast<const Log::UncompressedEntry*>(readPos);
+        if (entry->entrySize < sizeof(Log::UncompressedEntry) ||
+                entry->entrySize > endOfInput - readPos)
+            return Z_DATA_ERROR;
+
+        if (NanoLogCompressBound(entry->entrySize) >
+                static_cast<uint64_t>(endOfOutput - writePos)) {
+            fprintf(stderr, "Ran out of space in the output buffer\r\n");
+            return Z_BUF_ERROR;
+        }
+
+        Log::compressLogHeader(entry, (char**)&writePos, lastTime);
+        lastTime = entry->timestamp;
+
+        uint32_t fmtId = entry->fmtId;
+        int numArgs = fmtId % LOG_ID_MAX_ARGS;
+        const FormatSignature *signature = nullptr;
+        if (fmtId >= LOG_ID_FORMAT_START) {
+            signature = FormatRegistry::getSignature(fmtId);
+            if (signature == nullptr)
+                return Z_DATA_ERROR;
+            numArgs = signature->numArgs;
+        }
+
+        int argSize = entry->entrySize - sizeof(Log::UncompressedEntry);
+        uint64_t *slots = history.getSlots(fmtId, numArgs);
+
+        if (signature != nullptr) {
+            packFormatArgs(&writePos, signature, entry->argData, slots,
+                           options, &dictionary);
+        } else if (fmtId < LOG_ID_INT_ARGS_START && options.stringDictionary) {
+            packStrings(&writePos, entry->argData, numArgs, &dictionary);
+        } else if (fmtId < LOG_ID_INT_ARGS_START) {
+            // Strings are incompressible, so we just memcpy them
+            memcpy(writePos, entry->argData, argSize);
+            writePos += argSize;
+        } else if (fmtId < LOG_ID_LONG_ARGS_START) {
+            packArgs(&writePos, reinterpret_cast<const int*>(entry->argData),
+                     numArgs, slots, options.deltaIntegers);
+        } else if (fmtId < LOG_ID_DBL_ARGS_START) {
+            packArgs(&writePos, reinterpret_cast<const long*>(entry->argData),
+                     numArgs, slots, options.deltaIntegers);
+        } else if (options.xorDoubles) {
+            packDoubles(&writePos,
+                        reinterpret_cast<const double*>(entry->argData),
+                        numArgs, slots);
+        } else {
+            // Doubles are incompressible, so just copy it.
+            memcpy(writePos, entry->argData, argSize);
+            writePos += argSize;
+        }
+
+        dictionary.commit();
+        readPos += entry->entrySize;
+    }
+
+    *outputSize = writePos - outputBuffer;
+    return Z_OK;
+}
+
+// See Header
+int
+HistoryCompressor::uncompress(unsigned char *outputBuffer,
+                              long unsigned int *outputSize,
+                              const unsigned char *inputBuffer,
+                              long unsigned int inputSize)
+{
+    using namespace LoggerInternals;
+
+    const char *readPos = reinterpret_cast<const char*>(inputBuffer);
+    const char *endOfInput = readPos + inputSize;
+    unsigned char *writePos = outputBuffer;
+    unsigned char *endOfOutput = outputBuffer + *outputSize;
+
+    history.reset();
+    dictionary.reset();
+
+    DecodedEntry entry;
+    uint64_t lastTime = 0;
+    while (readPos < endOfInput) {
+        uint32_t fmtId;
+        if (!decodeLogHeader(&readPos, endOfInput, lastTime, &fmtId,
+                             &entry.timestamp))
+            return Z_DATA_ERROR;
+        lastTime = entry.timestamp;
+
+        entry.numArgs = fmtId % LOG_ID_MAX_ARGS;
+        const FormatSignature *signature = nullptr;
+        if (fmtId >= LOG_ID_FORMAT_START) {
+            signature = FormatRegistry::getSignature(fmtId);
+            if (signature == nullptr)
+                return Z_DATA_ERROR;
+            entry.numArgs = signature->numArgs;
+        }
+
+        uint64_t *slots = history.getSlots(fmtId, entry.numArgs);
+
+        bool success;
+        if (signature != nullptr) {
+            if (!unpackFormatArgs(&readPos, endOfInput, signature,
+                                  entry.mixed, slots, options, &dictionary))
+                return Z_DATA_ERROR;
+
+            success = binaryLogFormatWithTimestamp(&writePos, endOfOutput,
+                                                   entry.timestamp, fmtId,
+                                                   entry.mixed);
+            dictionary.commit();
+        } else if (fmtId < LOG_ID_INT_ARGS_START && options.stringDictionary) {
+            if (!unpackStrings(&readPos, endOfInput, entry.strings,
+                               entry.numArgs, &dictionary))
+                return Z_DATA_ERROR;
+
+            success = binaryLogWithTimestamp(&writePos, endOfOutput,
+                                             entry.timestamp, entry.numArgs,
+                                             entry.strings);
+
+            // Only now are the dictionary strings referenced no longer needed
+            dictionary.commit();
+        } else if (fmtId < LOG_ID_INT_ARGS_START) {
+            if (!unpackRawStrings(&readPos, endOfInput, entry.strings,
+                                  entry.numArgs))
+                return Z_DATA_ERROR;
+
+            success = binaryLogWithTimestamp(&writePos, endOfOutput,
+                                             entry.timestamp, entry.numArgs,
+                                             entry.strings);
+        } else if (fmtId < LOG_ID_LONG_ARGS_START) {
+            if (!unpackArgs(&readPos, endOfInput, entry.ints, entry.numArgs,
+                            slots, options.deltaIntegers))
+                return Z_DATA_ERROR;
+            success = binaryLogWithTimestamp(&writePos, endOfOutput,
+                                             entry.timestamp, entry.numArgs,
+                                             entry.ints);
+        } else if (fmtId < LOG_ID_DBL_ARGS_START) {
+            if (!unpackArgs(&readPos, endOfInput, entry.longs,
+                            entry.numArgs, slots, options.deltaIntegers))
+                return Z_DATA_ERROR;
+            success = binaryLogWithTimestamp(&writePos, endOfOutput,
+                                             entry.timestamp, entry.numArgs,
+                                             entry.longs);
+        } else {
+            if (options.xorDoubles) {
+                if (!unpackDoubles(&readPos, endOfInput, entry.doubles,
+                                   entry.numArgs, slots))
+                    return Z_DATA_ERROR;
+            } else if (!unpackRawDoubles(&readPos, endOfInput,
+                                         entry.doubles, entry.numArgs)) {
+                return Z_DATA_ERROR;
+            }
+
+            success = binaryLogWithTimestamp(&writePos, endOfOutput,
+                                             entry.timestamp, entry.numArgs,
+                                             entry.doubles);
+        }
+
+        if (!success)
+            return Z_BUF_ERROR;
+    }
+
+    *outputSize = writePos - outputBuffer;
+    return Z_OK;
+}
@@ -0,0 +1,266 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef COMPRESSION_HISTORY_COMPRESSOR_H
+#define COMPRESSION_HISTORY_COMPRESSOR_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Logger.h"
+
+/**
+ * Keeps the last value seen in every argument slot, i.e. every
+ * (fmtId, argument index) pair. Slots for a fmtId are allocated contiguously
+ * the first time the fmtId is seen, so the table only grows with the number
+ * of log statements actually in use.
+ */
+class ArgumentHistory {
+public:
+    ArgumentHistory()
+        : slotOffsets()
+        , slots()
+    {}
+
+    /**
+     * Forget all the values seen so far.
+     */
+    void reset() {
+        slotOffsets.clear();
+        slots.clear();
+    }
+
+    /**
+     * Returns the slots for a fmtId (initially 0). The pointer is only valid
+     * until the next invocation.
+     *
+     * \param fmtId
+     *      Identifies the log statement
+     * \param numArgs
+     *      Number of arguments the log statement has
+     */
+    uint64_t *getSlots(uint32_t fmtId, int numArgs) {
+        if (fmtId >= slotOffsets.size())
+            slotOffsets.resize(fmtId + 1, 0);
+
+        // Offsets are stored + 1 so that 0 means unallocated
+        if (slotOffsets[fmtId] == 0) {
+            slotOffsets[fmtId] = slots.size() + 1;
+            slots.resize(slots.size() + numArgs, 0);
+        }
+
+        return slots.data() + slotOffsets[fmtId] - 1;
+    }
+
+private:
+    // Maps a fmtId to the (offset + 1) of its first slot in slots
+    std::vector<uint32_t> slotOffsets;
+
+    // Last value seen in every argument slot
+    std::vector<uint64_t> slots;
+};
+
+/**
+ * Bounded dictionary of recently seen string arguments that lets repeated
+ * strings be replaced with a short index. Strings are stored in a direct
+ * mapped table indexed by their hash, so a newer string simply evicts an
+ * older one with the same hash and the table never grows.
+ *
+ * Insertions are staged and only take effect on commit() so that the
+ * strings looked up for one log entry stay valid until the entry has been
+ * fully processed. As long as the encoder and decoder stage and commit the
+ * same strings, their dictionaries stay identical.
+ */
+class StringDictionary {
+public:
+    // Number of strings the dictionary holds; must fit in 15 bits.
+    static const uint32_t NUM_ENTRIES = 1 << 14;
+
+    // Strings shorter than this are cheaper to store than to reference
+    static const size_t MIN_LENGTH = 2;
+
+    StringDictionary()
+        : entries(NUM_ENTRIES)
+        , staged()
+    {}
+
+    /**
+     * Forget all the strings seen so far.
+     */
+    void reset() {
+        for (std::string &entry : entries)
+            entry.clear();
+        staged.clear();
+    }
+
+    /**
+     * Returns the index a string would be stored at.
+     *
+     * \param str
+     *      String to hash (need not be NULL terminated)
+     * \param length
+     *      Number of characters in the string
+     */
+    static uint32_t getIndex(const char *str, size_t length) {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037UL;
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= static_cast<unsigned char>(str[i]);
+            hash *= 1099511628211UL;
+        }
+
+        return static_cast<uint32_t>(hash ^ (hash >> 32)) % NUM_ENTRIES;
+    }
+
+    /**
+     * Returns true if the string at index is identical to str.
+     */
+    bool matches(uint32_t index, const char *str, size_t length) const {
+        const std::string &entry = entries[index];
+        return entry.size() == length &&
+                memcmp(entry.data(), str, length) == 0;
+    }
+
+    /**
+     * Returns the NULL terminated string at index. The pointer is only valid
+     * until the next commit().
+     */
+    const char *get(uint32_t index) const {
+        return entries[index].c_str();
+    }
+
+    /**
+     * Stages a string to be stored at getIndex(str, length) on the next
+     * commit(). The string must remain valid until then.
+     */
+    void stage(const char *str, size_t length) {
+        staged.emplace_back(str, length);
+    }
+
+    /**
+     * Stores all the strings staged since the last commit().
+     */
+    void commit() {
+        for (auto &s : staged)
+            entries[getIndex(s.first, s.second)].assign(s.first, s.second);
+        staged.clear();
+    }
+
+private:
+    // Strings stored in the dictionary, indexed by getIndex()
+    std::vector<std::string> entries;
+
+    // Strings to store on the next commit()
+    std::vector<std::pair<const char*, size_t>> staged;
+};
+
+/**
+ * HistoryCompressor applies the NanoLog compaction scheme with optional
+ * argument codecs that encode each argument relative to the previous value
+ * in the same argument slot (see ArgumentHistory). With all the codecs
+ * disabled, its output is identical to NanoLogCompress2()'s.
+ *
+ * The history is reset at the start of every compress()/uncompress()
+ * invocation, so every output buffer is independently decodable.
+ */
+class HistoryCompressor {
+public:
+    /**
+     * Selects the argument codecs to use.
+     */
+    struct Options {
+        // Store int/long arguments as the zigzag encoded difference from the
+        // previous value in the same slot; this turns counters, sequence
+        // numbers and offsets into 1 byte values.
+        bool deltaIntegers;
+
+        // Store double arguments as the XOR with the previous value in the
+        // same slot, dropping the XOR's leading and trailing zero bytes
+        // (a byte aligned take on Gorilla's encoding). Slowly changing values
+        // share their sign, exponent and high mantissa bits and cost only a
+        // few bytes.
+        bool xorDoubles;
+
+        // Replace string arguments seen recently (in any slot) with a 2 byte
+        // index into a StringDictionary. Hostnames, table names and status
+        // strings then cost 2 bytes instead of their full length.
+        bool stringDictionary;
+
+        Options()
+            : deltaIntegers(false)
+            , xorDoubles(false)
+            , stringDictionary(false)
+        {}
+    };
+
+    explicit HistoryCompressor(const Options &options);
+
+    /**
+     * Compacts inputBuffer with the selected codecs. It has the same API as
+     * zlib's compress function except the compressionLevel parameter is
+     * omitted.
+     *
+     * \param outputBuffer
+     *      Output buffer to store the compacted log entries
+     * \param outputSize
+     *      Initially set by the caller to indicate the size of outputBuffer.
+     *      On return, it is set to the number of bytes actually used.
+     * \param inputBuffer
+     *      Buffer that contains data generated by binaryLogWithArgs()
+     * \param inputSize
+     *      Number of bytes to consume in the inputBuffer
+     *
+     * \return
+     *      Same as libz's return status's
+     */
+    int compress(unsigned char *outputBuffer, long unsigned int *outputSize,
+                 const unsigned char *inputBuffer, long unsigned int inputSize);
+
+    /**
+     * Reverses compress() (which must have been invoked with the same
+     * Options) and reconstructs the original binaryLogWithArgs() log entries
+     * in outputBuffer. It has the same API as zlib's uncompress function.
+     *
+     * \param outputBuffer
+     *      Output buffer to store the reconstructed log entries
+     * \param outputSize
+     *      Initially set by the caller to indicate the size of outputBuffer.
+     *      On return, it is set to the number of bytes actually used.
+     * \param inputBuffer
+     *      Buffer containing the output of compress()
+     * \param inputSize
+     *      Number of valid bytes in the buffer
+     *
+     * \return
+     *      Same as libz's return status's
+     */
+    int uncompress(unsigned char *outputBuffer, long unsigned int *outputSize,
+                   const unsigned char *inputBuffer,
+                   long unsigned int inputSize);
+
+private:
+    // Codecs selected
+    const Options options;
+
+    // Previous value of every argument slot
+    ArgumentHistory history;
+
+    // Recently seen string arguments
+    StringDictionary dictionary;
+};
+
+#endif //COMPRESSION_HISTORY_COMPRESSOR_H
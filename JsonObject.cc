@@ -0,0 +1,193 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "JsonObject.h"
+
+// See Header
+std::string
+JsonObject::quote(const std::string &value)
+{
+    std::string quoted = "\"";
+    for (char c : value) {
+        switch (c) {
+            case '"':  quoted += "\\\""; break;
+            case '\\': quoted += "\\\\"; break;
+            case '\n': quoted += "\\n";  break;
+            case '\r': quoted += "\\r";  break;
+            case '\t': quoted += "\\t";  break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escape[8];
+                    snprintf(escape, sizeof(escape), "\\u%04x", c);
+                    quoted += escape;
+                } else {
+                    quoted += c;
+                }
+                break;
+        }
+    }
+
+    return quoted + "\"";
+}
+
+/**
+ * Appends the separator and key of a new member.
+ *
+ * \param key
+ *      Name of the member
+ */
+void
+JsonObject::addKey(const char *key)
+{
+    if (text.size() > 1)
+        text += ",";
+    text += quote(key) + ":";
+}
+
+// See Header
+JsonObject &
+JsonObject::addString(const char *key, const std::string &value)
+{
+    addKey(key);
+    text += quote(value);
+    return *this;
+}
+
+// See Header
+JsonObject &
+JsonObject::addInteger(const char *key, int64_t value)
+{
+    addKey(key);
+    text += std::to_string(value);
+    return *this;
+}
+
+// See Header
+JsonObject &
+JsonObject::addNumber(const char *key, double value)
+{
+    if (!std::isfinite(value))
+        return addNull(key);
+
+    char number[32];
+    snprintf(number, sizeof(number), "%.9g", value);
+    addKey(key);
+    text += number;
+    return *this;
+}
+
+// See Header
+JsonObject &
+JsonObject::addObject(const char *key, const JsonObject &value)
+{
+    addKey(key);
+    text += value.str();
+    return *this;
+}
+
+// See Header
+JsonObject &
+JsonObject::addNull(const char *key)
+{
+    addKey(key);
+    text += "null";
+    return *this;
+}
+
+/**
+ * Parses the JSON string starting at a position of a text, undoing the
+ * escapes quote() makes.
+ *
+ * \param text
+ *      Text containing the string
+ * \param pos
+ *      Position of the string's opening quote
+ * \param[out] end
+ *      Position after the string's closing quote
+ *
+ * \return
+ *      Value of the string
+ */
+static std::string
+unquote(const std::string &text, size_t pos, size_t *end)
+{
+    std::string value;
+    for (++pos; pos < text.size() && text[pos] != '"'; ++pos) {
+        if (text[pos] != '\\' || pos + 1 == text.size()) {
+            value += text[pos];
+            continue;
+        }
+
+        switch (text[++pos]) {
+            case 'n': value += '\n'; break;
+            case 'r': value += '\r'; break;
+            case 't': value += '\t'; break;
+            case 'u':
+                value += static_cast<char>(
+                        strtol(text.substr(pos + 1, 4).c_str(), nullptr, 16));
+                pos += 4;
+                break;
+            default:  value += text[pos]; break;
+        }
+    }
+
+    *end = std::min(pos + 1, text.size());
+    return value;
+}
+
+// See Header
+bool
+JsonObject::findMember(const std::string &record, const char *key,
+                       std::string *value)
+{
+    int depth = 0;
+    size_t pos = 0;
+    while (pos < record.size()) {
+        char c = record[pos];
+        if (c != '"') {
+            if (c == '{' || c == '[')
+                ++depth;
+            else if (c == '}' || c == ']')
+                --depth;
+            ++pos;
+            continue;
+        }
+
+        size_t end;
+        std::string name = unquote(record, pos, &end);
+        pos = end;
+        if (depth != 1 || pos >= record.size() || record[pos] != ':' ||
+                name != key)
+            continue;
+
+        ++pos;
+        if (pos < record.size() && record[pos] == '"') {
+            *value = unquote(record, pos, &end);
+            return true;
+        }
+
+        if (pos >= record.size() || record[pos] == '{' || record[pos] == '[')
+            return false;
+
+        *value = record.substr(pos, record.find_first_of(",}", pos) - pos);
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,106 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef COMPRESSION_JSON_OBJECT_H
+#define COMPRESSION_JSON_OBJECT_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * JsonObject builds the text of a flat or nested JSON object one member at
+ * a time, for the benchmark's JSON-lines output. Members are written in the
+ * order they're added, and keys aren't checked for duplicates.
+ */
+class JsonObject {
+public:
+    JsonObject()
+        : text("{")
+    {}
+
+    /**
+     * Adds a member. Each of these returns the object, so that additions
+     * can be chained.
+     *
+     * \param key
+     *      Name of the member
+     * \param value
+     *      Value of the member
+     */
+    JsonObject &addString(const char *key, const std::string &value);
+    JsonObject &addInteger(const char *key, int64_t value);
+    JsonObject &addObject(const char *key, const JsonObject &value);
+
+    /**
+     * Adds a floating point member with 9 significant digits. JSON can't
+     * represent infinities or NaNs (e.g. a rate computed over a zero time),
+     * so those are added as null.
+     *
+     * \param key
+     *      Name of the member
+     * \param value
+     *      Value of the member
+     */
+    JsonObject &addNumber(const char *key, double value);
+
+    /**
+     * Adds a null member, e.g. for a metric that wasn't measured.
+     *
+     * \param key
+     *      Name of the member
+     */
+    JsonObject &addNull(const char *key);
+
+    /**
+     * Returns the JSON text of the object
+     */
+    std::string str() const {
+        return text + "}";
+    }
+
+    /**
+     * Returns a string as a quoted JSON string, escaping the characters JSON
+     * requires to be.
+     *
+     * \param value
+     *      String to quote
+     */
+    static std::string quote(const std::string &value);
+
+    /**
+     * Finds a top-level member of a JSON record written by JsonObject (so
+     * without whitespace between the tokens) and returns its value: strings
+     * unquoted and unescaped, and other values as their JSON text.
+     *
+     * \param record
+     *      Text of the record
+     * \param key
+     *      Name of the member
+     * \param[out] value
+     *      Value of the member
+     *
+     * \return
+     *      False if the record has no such member (or no scalar one)
+     */
+    static bool findMember(const std::string &record, const char *key,
+                           std::string *value);
+
+private:
+    void addKey(const char *key);
+
+    // Text of the object so far, without the closing brace
+    std::string text;
+};
+
+#endif //COMPRESSION_JSON_OBJECT_H
@@ -0,0 +1,94 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <algorithm>
+#include <cmath>
+
+#include "Cycles.h"
+#include "LatencyHistogram.h"
+
+LatencyHistogram::LatencyHistogram()
+    : buckets()
+    , count(0)
+    , maxCycles(0)
+{
+}
+
+// See Header
+void
+LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    for (int i = 0; i < NUM_BUCKETS; ++i)
+        buckets[i] += other.buckets[i];
+
+    count += other.count;
+    maxCycles = std::max(maxCycles, other.maxCycles);
+}
+
+// See Header
+void
+LatencyHistogram::reset()
+{
+    std::fill(buckets, buckets + NUM_BUCKETS, 0);
+    count = 0;
+    maxCycles = 0;
+}
+
+/**
+ * Returns the largest value that getBucketIndex() maps to a bucket.
+ *
+ * \param index
+ *      Index of the bucket
+ */
+uint64_t
+LatencyHistogram::getBucketUpperBound(int index)
+{
+    if (index < SUB_BUCKETS)
+        return index;
+
+    int shift = index/SUB_BUCKETS - 1;
+    uint64_t lowerBound = static_cast<uint64_t>(SUB_BUCKETS +
+                                                index%SUB_BUCKETS) << shift;
+    return lowerBound + (1UL << shift) - 1;
+}
+
+// See Header
+double
+LatencyHistogram::getPercentileNs(double percentile) const
+{
+    if (count == 0)
+        return 0.0;
+
+    // Rank of the duration the percentile falls on, counting from 1
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percentile/100*count));
+    rank = std::max<uint64_t>(1, std::min(rank, count));
+
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            uint64_t cycles = std::min(getBucketUpperBound(i), maxCycles);
+            return PerfUtils::Cycles::toSeconds(cycles)*1e9;
+        }
+    }
+
+    return getMaxNs();
+}
+
+// See Header
+double
+LatencyHistogram::getMaxNs() const
+{
+    return PerfUtils::Cycles::toSeconds(maxCycles)*1e9;
+}
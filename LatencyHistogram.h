@@ -0,0 +1,115 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef COMPRESSION_LATENCY_HISTOGRAM_H
+#define COMPRESSION_LATENCY_HISTOGRAM_H
+
+#include <cstdint>
+
+/**
+ * LatencyHistogram accumulates Cycles::rdtsc() durations into log-scaled
+ * buckets in the style of an HDR histogram: every power of two is split into
+ * SUB_BUCKETS linear sub-buckets, so any recorded value is within 1/16th of
+ * the bucket it's reported as, while the whole 64-bit range fits in a few
+ * kilobytes of counters.
+ *
+ * Recording only increments a counter, so a histogram is cheap enough to
+ * sit on a log statement's fast path. It isn't thread-safe; each thread
+ * records into its own histogram and they're merge()-ed afterwards.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    /**
+     * Records one duration.
+     *
+     * \param cycles
+     *      Duration measured with Cycles::rdtsc()
+     */
+    void record(uint64_t cycles) {
+        ++buckets[getBucketIndex(cycles)];
+        ++count;
+        if (cycles > maxCycles)
+            maxCycles = cycles;
+    }
+
+    /**
+     * Adds all the durations recorded by another histogram to this one.
+     */
+    void merge(const LatencyHistogram &other);
+
+    /**
+     * Discards all the durations recorded so far.
+     */
+    void reset();
+
+    /**
+     * Returns the number of durations recorded
+     */
+    uint64_t getCount() const {
+        return count;
+    }
+
+    /**
+     * Returns the duration in nanoseconds that the given percentage of the
+     * recorded durations are less than or equal to. The value is the upper
+     * bound of the bucket the percentile falls in, so it's at most 1/16th
+     * more than the exact value.
+     *
+     * \param percentile
+     *      Percentile to compute, between 0 and 100
+     */
+    double getPercentileNs(double percentile) const;
+
+    /**
+     * Returns the exact maximum duration recorded in nanoseconds
+     */
+    double getMaxNs() const;
+
+private:
+    // log2 of the number of linear sub-buckets per power of two
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+    // Enough buckets to cover every 64-bit value
+    static const int NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1)*SUB_BUCKETS;
+
+    /**
+     * Maps a value to its bucket. Values less than SUB_BUCKETS get a bucket
+     * each; larger values are bucketed by the position of their most
+     * significant bit and the SUB_BUCKET_BITS bits that follow it.
+     */
+    static int getBucketIndex(uint64_t value) {
+        if (value < SUB_BUCKETS)
+            return static_cast<int>(value);
+
+        int shift = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS;
+        return (shift + 1)*SUB_BUCKETS +
+                static_cast<int>((value >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    static uint64_t getBucketUpperBound(int index);
+
+    // Number of durations recorded in each bucket
+    uint64_t buckets[NUM_BUCKETS];
+
+    // Total number of durations recorded
+    uint64_t count;
+
+    // Largest duration recorded
+    uint64_t maxCycles;
+};
+
+#endif //COMPRESSION_LATENCY_HISTOGRAM_H
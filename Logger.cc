@@ -12,12 +12,224 @@
  * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
+#include <algorithm>
+
+#include "FormatRegistry.h"
 #include "Logger.h"
+#include "SimdPacker.h"
 
 /**
  * This file implements some features in the Logger.h file
  */
 
+// See Header
+bool binaryLogFormatWithTimestamp(unsigned char **bufferIn,
+                                  unsigned char *endOfBuffer,
+                                  uint64_t timestamp, uint32_t fmtId,
+                                  const LogArgument *args)
+{
+    using namespace NanoLogInternal::Log;
+
+    const FormatSignature *signature = FormatRegistry::getSignature(fmtId);
+    if (signature == nullptr) {
+        fprintf(stderr, "Logged with unregistered fmtId %u\r\n", fmtId);
+        exit(1);
+    }
+
+    uint32_t bytesRequired = sizeof(UncompressedEntry);
+    for (int i = 0; i < signature->numArgs; ++i) {
+        switch (signature->argTypes[i]) {
+            case LOG_ARG_INT:
+                bytesRequired += sizeof(int);
+                break;
+            case LOG_ARG_LONG:
+                bytesRequired += sizeof(long);
+                break;
+            case LOG_ARG_DOUBLE:
+                bytesRequired += sizeof(double);
+                break;
+            default:
+                bytesRequired += strlen(args[i].stringArg) + 1;
+                break;
+        }
+    }
+
+    if (static_cast<uint64_t>(endOfBuffer - *bufferIn) < bytesRequired)
+        return false;
+
+    auto meta = reinterpret_cast<UncompressedEntry*>(*bufferIn);
+    unsigned char *writePos = *bufferIn + sizeof(UncompressedEntry);
+
+    meta->timestamp = timestamp;
+    meta->fmtId = fmtId;
+    meta->entrySize = bytesRequired;
+
+    // The arguments aren't necessarily aligned, so they're memcpy-ed
+    for (int i = 0; i < signature->numArgs; ++i) {
+        switch (signature->argTypes[i]) {
+            case LOG_ARG_INT:
+                memcpy(writePos, &args[i].intArg, sizeof(int));
+                writePos += sizeof(int);
+                break;
+            case LOG_ARG_LONG:
+                memcpy(writePos, &args[i].longArg, sizeof(long));
+                writePos += sizeof(long);
+                break;
+            case LOG_ARG_DOUBLE:
+                memcpy(writePos, &args[i].doubleArg, sizeof(double));
+                writePos += sizeof(double);
+                break;
+            default:
+                writePos = (unsigned char*)(stpcpy((char*)writePos,
+                                                   args[i].stringArg)) + 1;
+                break;
+        }
+    }
+
+    *bufferIn = writePos;
+    return true;
+}
+
+// See Header
+void compressFormatArgs(const NanoLogInternal::Log::UncompressedEntry *entry,
+                        unsigned char **writePosIn)
+{
+    const FormatSignature *signature =
+                                FormatRegistry::getSignature(entry->fmtId);
+    const char *readPos = entry->argData;
+    unsigned char *writePos = *writePosIn;
+    BufferUtils::TwoNibbles *twoNibbles = nullptr;
+    bool firstNibble = true;
+
+    for (int i = 0; i < signature->numArgs; ++i) {
+        LogArgType argType = signature->argTypes[i];
+
+        if (argType == LOG_ARG_DOUBLE) {
+            memcpy(writePos, readPos, sizeof(double));
+            readPos += sizeof(double);
+            writePos += sizeof(double);
+            continue;
+        } else if (argType == LOG_ARG_STRING) {
+            size_t length = strlen(readPos) + 1;
+            memcpy(writePos, readPos, length);
+            readPos += length;
+            writePos += length;
+            continue;
+        }
+
+        if (firstNibble) {
+            twoNibbles = reinterpret_cast<BufferUtils::TwoNibbles*>(writePos);
+            *writePos = 0;  // Don't leave junk in an unused nibble
+            writePos += sizeof(BufferUtils::TwoNibbles);
+        }
+
+        uint8_t nibble;
+        if (argType == LOG_ARG_INT) {
+            int arg;
+            memcpy(&arg, readPos, sizeof(int));
+            readPos += sizeof(int);
+            nibble = BufferUtils::pack((char**)&writePos, arg);
+        } else {
+            long arg;
+            memcpy(&arg, readPos, sizeof(long));
+            readPos += sizeof(long);
+            nibble = BufferUtils::pack((char**)&writePos, arg);
+        }
+
+        if (firstNibble)
+            twoNibbles->first = nibble;
+        else
+            twoNibbles->second = nibble;
+        firstNibble = !firstNibble;
+    }
+
+    *writePosIn = writePos;
+}
+
+/**
+ * Applies the NanoLog compaction scheme to a single log entry produced by
+ * binaryLogWithArgs() or binaryLogWithFormat().
+ *
+ * \param metadata
+ *      Log entry to compact
+ * \param[in/out] writePos
+ *      Buffer to output the compacted entry to (pointer will be incremented
+ *      after the write). Must have at least
+ *      NanoLogCompressBound(metadata->entrySize) bytes of space.
+ * \param lastTime
+ *      Timestamp of the previous log entry compacted
+ */
+static inline void
+compressEntry(const NanoLogInternal::Log::UncompressedEntry *metadata,
+              unsigned char **writePosIn, uint64_t lastTime)
+{
+    using namespace NanoLogInternal;
+    using namespace LoggerInternals;
+
+    unsigned char *writePos = *writePosIn;
+    const unsigned char *readPos =
+            reinterpret_cast<const unsigned char*>(metadata->argData);
+
+    Log::compressLogHeader(metadata, (char**)&writePos, lastTime);
+
+    int argSize = metadata->entrySize - sizeof(Log::UncompressedEntry);
+    if (argSize > 0) {
+        if (metadata->fmtId < LOG_ID_INT_ARGS_START) {
+            // Strings are incompressible, so we just memcpy them
+            memcpy(writePos, readPos, argSize);
+            writePos += argSize;
+        } else if (metadata->fmtId < LOG_ID_LONG_ARGS_START) {
+            int numInts =  metadata->fmtId - LOG_ID_INT_ARGS_START;
+            auto *args = reinterpret_cast<const int*>(metadata->argData);
+
+            int i = 0;
+            while (i < numInts) {
+                auto twoNibbles = reinterpret_cast<
+                                        BufferUtils::TwoNibbles*>(writePos);
+                *writePos = 0;  // Don't leave junk in an unused nibble
+                writePos += sizeof(BufferUtils::TwoNibbles);
+
+                twoNibbles->first =
+                        BufferUtils::pack((char**) &writePos, args[i]);
+
+                if (++i >= numInts) break;
+
+                twoNibbles->second =
+                        BufferUtils::pack((char**) &writePos, args[i]);
+                ++i;
+            }
+        } else if (metadata->fmtId < LOG_ID_DBL_ARGS_START) {
+            long numLongs =  metadata->fmtId - LOG_ID_LONG_ARGS_START;
+            auto *args = reinterpret_cast<const long*>(metadata->argData);
+
+            int i = 0;
+            while (i < numLongs) {
+                BufferUtils::TwoNibbles* twoNibbles = reinterpret_cast<
+                                        BufferUtils::TwoNibbles*>(writePos);
+                *writePos = 0;  // Don't leave junk in an unused nibble
+                writePos += sizeof(BufferUtils::TwoNibbles);
+
+                twoNibbles->first =
+                        BufferUtils::pack((char**) &writePos, args[i]);
+
+                if (++i >= numLongs) break;
+
+                twoNibbles->second =
+                        BufferUtils::pack((char**) &writePos, args[i]);
+                ++i;
+            }
+        } else if (metadata->fmtId < LOG_ID_FORMAT_START) {
+            // Doubles are incompressible, so just copy it.
+            memcpy(writePos, readPos, argSize);
+            writePos += argSize;
+        } else {
+            compressFormatArgs(metadata, &writePos);
+        }
+    }
+
+    *writePosIn = writePos;
+}
+
 // See Header
 int NanoLogCompress2(unsigned char *outputBuffer,
                      long unsigned int *outputSize,
@@ -26,7 +238,6 @@ int NanoLogCompress2(unsigned char *outputBuffer,
                      int compressionLevel)
 {
     using namespace NanoLogInternal;
-    using namespace LoggerInternals;
 
     const unsigned char *readPos = inputBuffer;
     unsigned char *writePos = outputBuffer;
@@ -34,63 +245,9 @@ int NanoLogCompress2(unsigned char *outputBuffer,
     uint64_t lastTime = 0;
     while (readPos < inputBuffer + inputSize) {
         auto metadata =reinterpret_cast<const Log::UncompressedEntry*>(readPos);
-        readPos += sizeof(Log::UncompressedEntry);
-
-        Log::compressLogHeader(metadata, (char**)&writePos, lastTime);
+        compressEntry(metadata, &writePos, lastTime);
         lastTime = metadata->timestamp;
-
-        int argSize = metadata->entrySize - sizeof(Log::UncompressedEntry);
-        if (argSize > 0) {
-            if (metadata->fmtId < LOG_ID_INT_ARGS_START) {
-                // Strings are incompressible, so we just memcpy them
-                memcpy(writePos, readPos, argSize);
-                writePos += argSize;
-            } else if (metadata->fmtId < LOG_ID_LONG_ARGS_START) {
-                int numInts =  metadata->fmtId - LOG_ID_INT_ARGS_START;
-                auto *args = reinterpret_cast<const int*>(metadata->argData);
-
-                int i = 0;
-                while (i < numInts) {
-                    auto twoNibbles = reinterpret_cast<
-                                            BufferUtils::TwoNibbles*>(writePos);
-                    writePos += sizeof(BufferUtils::TwoNibbles);
-
-                    twoNibbles->first =
-                            BufferUtils::pack((char**) &writePos, args[i]);
-
-                    if (++i >= numInts) break;
-
-                    twoNibbles->second =
-                            BufferUtils::pack((char**) &writePos, args[i]);
-                    ++i;
-                }
-            } else if (metadata->fmtId < LOG_ID_DBL_ARGS_START) {
-                long numLongs =  metadata->fmtId - LOG_ID_LONG_ARGS_START;
-                auto *args = reinterpret_cast<const long*>(metadata->argData);
-
-                int i = 0;
-                while (i < numLongs) {
-                    BufferUtils::TwoNibbles* twoNibbles = reinterpret_cast<
-                                            BufferUtils::TwoNibbles*>(writePos);
-                    writePos += sizeof(BufferUtils::TwoNibbles);
-
-                    twoNibbles->first =
-                            BufferUtils::pack((char**) &writePos, args[i]);
-
-                    if (++i >= numLongs) break;
-
-                    twoNibbles->second =
-                            BufferUtils::pack((char**) &writePos, args[i]);
-                    ++i;
-                }
-            } else {
-                // Doubles are incompressible, so just copy it.
-                memcpy(writePos, readPos, argSize);
-                writePos += argSize;
-            }
-
-            readPos += argSize;
-        }
+        readPos += metadata->entrySize;
     }
 
     if (outputBuffer + *outputSize < writePos) {
@@ -102,92 +259,496 @@ int NanoLogCompress2(unsigned char *outputBuffer,
     return Z_OK;
 }
 
+NanoLogStream::NanoLogStream()
+    : nextIn(nullptr)
+    , availIn(0)
+    , nextOut(nullptr)
+    , availOut(0)
+    , totalIn(0)
+    , totalOut(0)
+    , lastTime(0)
+    , partialEntry()
+    , partialEntryBytes(0)
+    , pendingOutput()
+    , pendingOutputStart(0)
+    , pendingOutputEnd(0)
+{
+    init();
+}
+
 // See Header
-void NanoLogDecompress(const char *inputBuffer, long unsigned int inputSize)
+void
+NanoLogStream::init()
 {
-    using namespace LoggerInternals;
+    totalIn = 0;
+    totalOut = 0;
+    lastTime = 0;
+    partialEntryBytes = 0;
+    pendingOutputStart = 0;
+    pendingOutputEnd = 0;
+}
 
-    const char *endOfBuffer = inputBuffer + inputSize;
-    uint64_t lastTimestamp = 0;
+// See Header
+int
+NanoLogStream::compress()
+{
+    using namespace NanoLogInternal;
 
-    while (endOfBuffer > inputBuffer) {
-        uint32_t logId;
-        uint64_t timestamp;
-        NanoLogInternal::Log::decompressLogHeader(&inputBuffer,
-                                                  lastTimestamp,
-                                                  logId,
-                                                  timestamp);
-        uint64_t timeDelta = timestamp - lastTimestamp;
-        lastTimestamp = timestamp;
-
-        if (logId < LOG_ID_INT_ARGS_START) {
-            uint32_t numStrings = logId - LOG_ID_STRING_START;
-            printf("Found at %llu (+%llu) timestamp %u strings:\r\n",
-                       timestamp, timeDelta, numStrings);
-            for (int i = 0; i < numStrings; ++i) {
-                printf("\t%d: %s\r\n", i, inputBuffer);
-                inputBuffer += strlen(inputBuffer) + 1;
-            }
-        } else if (logId < LOG_ID_LONG_ARGS_START) {
-            int numArgs = logId - LOG_ID_INT_ARGS_START;
-            printf("Found at %llu (+%llu) timestamp %u ints:\r\n",
-                       timestamp, timeDelta, numArgs);
+    const uint32_t headerSize = sizeof(Log::UncompressedEntry);
+    uint64_t startTotalIn = totalIn;
+    uint64_t startTotalOut = totalOut;
 
-            int i = 0;
-            while (i < numArgs) {
-                int result;
-                auto twoNibbles = reinterpret_cast<
-                                   const BufferUtils::TwoNibbles*>(inputBuffer);
-                inputBuffer += sizeof(BufferUtils::TwoNibbles);
+    while (drainPendingOutput() && availIn > 0) {
+        const Log::UncompressedEntry *entry;
+        bool isPartialEntry = (partialEntryBytes > 0);
 
-                result = BufferUtils::unpack<int>(&inputBuffer,
-                                                  twoNibbles->first);
-                printf("\t%d: %d\r\n", i, result);
+        if (!isPartialEntry && availIn >= headerSize) {
+            entry = reinterpret_cast<const Log::UncompressedEntry*>(nextIn);
+            if (entry->entrySize < headerSize)
+                return Z_DATA_ERROR;
 
-                if (++i >= numArgs) break;
+            isPartialEntry = (availIn < entry->entrySize);
+        }
 
-                result = BufferUtils::unpack<int>(&inputBuffer,
-                                                  twoNibbles->second);
-                printf("\t%d: %d\r\n", i, result);
-                ++i;
+        if (isPartialEntry || availIn < headerSize) {
+            // Accumulate the header first to learn the entry's size, then the
+            // rest of the entry.
+            if (partialEntry.size() < headerSize)
+                partialEntry.resize(headerSize);
+
+            long unsigned int bytesNeeded = headerSize;
+            if (partialEntryBytes >= headerSize) {
+                bytesNeeded = reinterpret_cast<Log::UncompressedEntry*>(
+                                            partialEntry.data())->entrySize;
             }
-        } else if (logId < LOG_ID_DBL_ARGS_START) {
-            int numArgs = logId - LOG_ID_LONG_ARGS_START;
-            printf("Found at %llu (+%llu) timestamp %lu longs:\r\n",
-                       timestamp, timeDelta, numArgs);
 
-            int i = 0;
-            while (i < numArgs) {
-                long result;
-                auto* twoNibbles = reinterpret_cast<
-                                   const BufferUtils::TwoNibbles*>(inputBuffer);
-                inputBuffer += sizeof(BufferUtils::TwoNibbles);
+            long unsigned int bytesToCopy =
+                    std::min(availIn, bytesNeeded - partialEntryBytes);
+            memcpy(partialEntry.data() + partialEntryBytes, nextIn,
+                   bytesToCopy);
+            partialEntryBytes += bytesToCopy;
+            nextIn += bytesToCopy;
+            availIn -= bytesToCopy;
+            totalIn += bytesToCopy;
+
+            if (partialEntryBytes == headerSize) {
+                auto header = reinterpret_cast<Log::UncompressedEntry*>(
+                                                        partialEntry.data());
+                if (header->entrySize < headerSize)
+                    return Z_DATA_ERROR;
+
+                if (partialEntry.size() < header->entrySize)
+                    partialEntry.resize(header->entrySize);
+
+                // The resize may have moved the buffer
+                header = reinterpret_cast<Log::UncompressedEntry*>(
+                                                        partialEntry.data());
+                bytesNeeded = header->entrySize;
+            }
 
-                result = BufferUtils::unpack<long>(&inputBuffer,
-                                                   twoNibbles->first);
-                printf("\t%d: %ld\r\n", i, result);
+            if (partialEntryBytes < bytesNeeded)
+                continue;
 
-                if (++i >= numArgs) break;
+            entry = reinterpret_cast<const Log::UncompressedEntry*>(
+                                                        partialEntry.data());
+        }
 
-                result = BufferUtils::unpack<long>(&inputBuffer,
-                                                   twoNibbles->second);
-                printf("\t%d: %ld\r\n", i, result);
-                ++i;
-            }
-        } else if (logId < LOG_ID_MAX_ARGS) {
-            int numArgs = logId - LOG_ID_DBL_ARGS_START;
-            printf("Found at %llu (+%llu) timestamp %lu doubles:\r\n",
-                       timestamp, timeDelta, numArgs);
+        // Compact directly into the output window if it's guaranteed to fit,
+        // otherwise go through the pending output buffer.
+        long unsigned int bound = NanoLogCompressBound(entry->entrySize);
+        if (availOut >= bound) {
+            unsigned char *writePos = nextOut;
+            compressEntry(entry, &writePos, lastTime);
+            availOut -= writePos - nextOut;
+            totalOut += writePos - nextOut;
+            nextOut = writePos;
+        } else {
+            if (pendingOutput.size() < bound)
+                pendingOutput.resize(bound);
 
-            auto args = reinterpret_cast<const double*>(inputBuffer);
-            for (int i = 0; i < numArgs; ++i)
-                printf("\t%d: %lf\r\n", i, args[i]);
+            unsigned char *writePos = pendingOutput.data();
+            compressEntry(entry, &writePos, lastTime);
+            pendingOutputStart = 0;
+            pendingOutputEnd = writePos - pendingOutput.data();
+        }
+
+        lastTime = entry->timestamp;
 
-            inputBuffer += numArgs*sizeof(double);
+        if (isPartialEntry) {
+            partialEntryBytes = 0;
         } else {
-            printf("Malformed data!\r\n");
+            nextIn += entry->entrySize;
+            availIn -= entry->entrySize;
+            totalIn += entry->entrySize;
+        }
+    }
+
+    if (totalIn == startTotalIn && totalOut == startTotalOut)
+        return Z_BUF_ERROR;
+
+    return Z_OK;
+}
+
+// See Header
+int
+NanoLogStream::flush()
+{
+    if (!drainPendingOutput())
+        return Z_OK;
+
+    if (partialEntryBytes > 0)
+        return Z_DATA_ERROR;
+
+    return Z_STREAM_END;
+}
+
+/**
+ * Copies as much of the pending output buffer as possible to the output
+ * window.
+ *
+ * \return
+ *      true if the pending output buffer was completely drained
+ */
+bool
+NanoLogStream::drainPendingOutput()
+{
+    long unsigned int bytesToCopy = std::min(availOut,
+                                    pendingOutputEnd - pendingOutputStart);
+    if (bytesToCopy > 0) {
+        memcpy(nextOut, pendingOutput.data() + pendingOutputStart,
+               bytesToCopy);
+        pendingOutputStart += bytesToCopy;
+        nextOut += bytesToCopy;
+        availOut -= bytesToCopy;
+        totalOut += bytesToCopy;
+    }
+
+    return pendingOutputStart == pendingOutputEnd;
+}
+
+/**
+ * Decodes a run of nibble-packed integer arguments (as output by
+ * compressEntry()).
+ *
+ * \param[in/out] readPos
+ *      Compacted arguments to decode (pointer will be incremented past them)
+ * \param endOfBuffer
+ *      End of the buffer readPos points into
+ * \param numArgs
+ *      Number of arguments to decode
+ * \param[out] args
+ *      Array to store the decoded arguments in
+ * \return
+ *      false if the arguments are cut short by endOfBuffer
+ */
+template<typename T>
+static inline bool
+unpackArgs(const char **readPos, const char *endOfBuffer, int numArgs,
+           T *args)
+{
+    using namespace LoggerInternals;
+
+    int i = 0;
+    while (i < numArgs) {
+        if (*readPos >= endOfBuffer)
+            return false;
+
+        auto twoNibbles = reinterpret_cast<
+                                const BufferUtils::TwoNibbles*>(*readPos);
+        int length = getPackedLength(twoNibbles->first);
+        if (i + 1 < numArgs)
+            length += getPackedLength(twoNibbles->second);
+        if (endOfBuffer - *readPos - 1 < length)
+            return false;
+        *readPos += sizeof(BufferUtils::TwoNibbles);
+
+        args[i] = BufferUtils::unpack<T>(readPos, twoNibbles->first);
+        if (++i >= numArgs) break;
+
+        args[i] = BufferUtils::unpack<T>(readPos, twoNibbles->second);
+        ++i;
+    }
+
+    return true;
+}
+
+/**
+ * Decodes a NULL terminated string argument in place.
+ *
+ * \param[in/out] readPos
+ *      String to decode (pointer will be incremented past its terminator)
+ * \param endOfBuffer
+ *      End of the buffer readPos points into
+ * \param[out] arg
+ *      Pointer to the string
+ * \return
+ *      false if the string isn't terminated before endOfBuffer
+ */
+static inline bool
+unpackString(const char **readPos, const char *endOfBuffer, const char **arg)
+{
+    size_t remaining = endOfBuffer - *readPos;
+    size_t length = strnlen(*readPos, remaining);
+    if (length == remaining)
+        return false;
+
+    *arg = *readPos;
+    *readPos += length + 1;
+    return true;
+}
+
+/**
+ * Reverses compressFormatArgs() for the entry being decoded.
+ *
+ * \param[in/out] entry
+ *      Entry being decoded; its fmtId must have been decoded already
+ * \return
+ *      false if the fmtId isn't registered or the data is malformed
+ */
+bool
+NanoLogDecoder::decodeFormatArgs(DecodedEntry *entry)
+{
+    using namespace LoggerInternals;
+
+    const FormatSignature *signature =
+                                FormatRegistry::getSignature(entry->fmtId);
+    if (signature == nullptr)
+        return false;
+
+    entry->argType = LOG_ARG_MIXED;
+    entry->numArgs = signature->numArgs;
+
+    const BufferUtils::TwoNibbles *twoNibbles = nullptr;
+    bool firstNibble = true;
+    for (int i = 0; i < entry->numArgs; ++i) {
+        LogArgument &arg = entry->mixed[i];
+
+        switch (signature->argTypes[i]) {
+            case LOG_ARG_DOUBLE:
+                if (endOfBuffer - readPos < long(sizeof(double)))
+                    return false;
+                memcpy(&arg.doubleArg, readPos, sizeof(double));
+                readPos += sizeof(double);
+                continue;
+            case LOG_ARG_STRING:
+                if (!unpackString(&readPos, endOfBuffer, &arg.stringArg))
+                    return false;
+                continue;
+            default:
+                break;
+        }
+
+        if (firstNibble) {
+            if (readPos >= endOfBuffer)
+                return false;
+            twoNibbles = reinterpret_cast<
+                                const BufferUtils::TwoNibbles*>(readPos);
+            readPos += sizeof(BufferUtils::TwoNibbles);
         }
+
+        uint8_t nibble = firstNibble ? twoNibbles->first : twoNibbles->second;
+        if (endOfBuffer - readPos < getPackedLength(nibble))
+            return false;
+
+        if (signature->argTypes[i] == LOG_ARG_INT)
+            arg.intArg = BufferUtils::unpack<int>(&readPos, nibble);
+        else
+            arg.longArg = BufferUtils::unpack<long>(&readPos, nibble);
+        firstNibble = !firstNibble;
     }
+
+    return true;
+}
+
+// See Header
+bool
+NanoLogDecoder::next(DecodedEntry *entry)
+{
+    using namespace LoggerInternals;
+
+    if (readPos >= endOfBuffer || malformed)
+        return false;
+
+    uint32_t logId;
+    if (!decodeLogHeader(&readPos, endOfBuffer, lastTimestamp, &logId,
+                         &entry->timestamp)) {
+        malformed = true;
+        return false;
+    }
+    lastTimestamp = entry->timestamp;
+    entry->fmtId = logId;
+
+    bool complete = true;
+    if (logId < LOG_ID_INT_ARGS_START) {
+        entry->argType = LOG_ARG_STRING;
+        entry->numArgs = logId - LOG_ID_STRING_START;
+        for (int i = 0; i < entry->numArgs && complete; ++i)
+            complete = unpackString(&readPos, endOfBuffer,
+                                    &entry->strings[i]);
+    } else if (logId < LOG_ID_LONG_ARGS_START) {
+        entry->argType = LOG_ARG_INT;
+        entry->numArgs = logId - LOG_ID_INT_ARGS_START;
+        if (vectorized)
+            complete = SimdPacker::unpackInts(&readPos, endOfBuffer,
+                                              entry->ints, entry->numArgs);
+        else
+            complete = unpackArgs(&readPos, endOfBuffer, entry->numArgs,
+                                  entry->ints);
+    } else if (logId < LOG_ID_DBL_ARGS_START) {
+        entry->argType = LOG_ARG_LONG;
+        entry->numArgs = logId - LOG_ID_LONG_ARGS_START;
+        if (vectorized)
+            complete = SimdPacker::unpackLongs(&readPos, endOfBuffer,
+                                               entry->longs, entry->numArgs);
+        else
+            complete = unpackArgs(&readPos, endOfBuffer, entry->numArgs,
+                                  entry->longs);
+    } else if (logId < LOG_ID_DBL_ARGS_START + LOG_ID_MAX_ARGS) {
+        entry->argType = LOG_ARG_DOUBLE;
+        entry->numArgs = logId - LOG_ID_DBL_ARGS_START;
+        long argBytes = entry->numArgs*sizeof(double);
+        complete = endOfBuffer - readPos >= argBytes;
+        if (complete) {
+            memcpy(entry->doubles, readPos, argBytes);
+            readPos += argBytes;
+        }
+    } else {
+        complete = decodeFormatArgs(entry);
+    }
+
+    if (!complete || readPos > endOfBuffer) {
+        malformed = true;
+        return false;
+    }
+
+    return true;
+}
+
+// See Header
+bool binaryLogDecodedEntry(unsigned char **bufferIn, unsigned char *endOfBuffer,
+                           DecodedEntry *entry)
+{
+    switch (entry->argType) {
+        case LOG_ARG_STRING:
+            return binaryLogWithTimestamp(bufferIn, endOfBuffer,
+                                          entry->timestamp, entry->numArgs,
+                                          entry->strings);
+        case LOG_ARG_INT:
+            return binaryLogWithTimestamp(bufferIn, endOfBuffer,
+                                          entry->timestamp, entry->numArgs,
+                                          entry->ints);
+        case LOG_ARG_LONG:
+            return binaryLogWithTimestamp(bufferIn, endOfBuffer,
+                                          entry->timestamp, entry->numArgs,
+                                          entry->longs);
+        case LOG_ARG_DOUBLE:
+            return binaryLogWithTimestamp(bufferIn, endOfBuffer,
+                                          entry->timestamp, entry->numArgs,
+                                          entry->doubles);
+        case LOG_ARG_MIXED:
+            return binaryLogFormatWithTimestamp(bufferIn, endOfBuffer,
+                                                entry->timestamp, entry->fmtId,
+                                                entry->mixed);
+    }
+
+    return false;
+}
+
+// See Header
+int NanoLogUncompress(unsigned char *outputBuffer,
+                      long unsigned int *outputSize,
+                      const unsigned char *inputBuffer,
+                      long unsigned int inputSize)
+{
+    NanoLogDecoder decoder((const char*)inputBuffer, inputSize);
+    DecodedEntry entry;
+    unsigned char *writePos = outputBuffer;
+    unsigned char *endOfBuffer = outputBuffer + *outputSize;
+
+    while (decoder.next(&entry)) {
+        if (!binaryLogDecodedEntry(&writePos, endOfBuffer, &entry))
+            return Z_BUF_ERROR;
+    }
+
+    if (decoder.isMalformed())
+        return Z_DATA_ERROR;
+
+    *outputSize = writePos - outputBuffer;
+    return Z_OK;
+}
+
+/**
+ * Prints an argument of a LOG_ARG_MIXED entry for NanoLogDecompress().
+ *
+ * \param i
+ *      Index of the argument
+ * \param entry
+ *      Entry the argument belongs to
+ */
+static void
+printMixedArg(int i, const DecodedEntry &entry)
+{
+    const FormatSignature *signature = FormatRegistry::getSignature(
+                                                                entry.fmtId);
+    const LogArgument &arg = entry.mixed[i];
+
+    switch (signature->argTypes[i]) {
+        case LOG_ARG_INT:
+            printf("\t%d: %d\r\n", i, arg.intArg);
+            break;
+        case LOG_ARG_LONG:
+            printf("\t%d: %ld\r\n", i, arg.longArg);
+            break;
+        case LOG_ARG_DOUBLE:
+            printf("\t%d: %lf\r\n", i, arg.doubleArg);
+            break;
+        default:
+            printf("\t%d: %s\r\n", i, arg.stringArg);
+            break;
+    }
+}
+
+// See Header
+void NanoLogDecompress(const char *inputBuffer, long unsigned int inputSize)
+{
+    static const char *typeNames[] = {"strings", "ints", "longs", "doubles",
+                                      "mixed"};
+
+    NanoLogDecoder decoder(inputBuffer, inputSize);
+    DecodedEntry entry;
+    uint64_t lastTimestamp = 0;
+
+    while (decoder.next(&entry)) {
+        uint64_t timeDelta = entry.timestamp - lastTimestamp;
+        lastTimestamp = entry.timestamp;
+
+        printf("Found at %lu (+%lu) timestamp %d %s:\r\n",
+               entry.timestamp, timeDelta, entry.numArgs,
+               typeNames[entry.argType]);
+
+        for (int i = 0; i < entry.numArgs; ++i) {
+            switch (entry.argType) {
+                case LOG_ARG_STRING:
+                    printf("\t%d: %s\r\n", i, entry.strings[i]);
+                    break;
+                case LOG_ARG_INT:
+                    printf("\t%d: %d\r\n", i, entry.ints[i]);
+                    break;
+                case LOG_ARG_LONG:
+                    printf("\t%d: %ld\r\n", i, entry.longs[i]);
+                    break;
+                case LOG_ARG_DOUBLE:
+                    printf("\t%d: %lf\r\n", i, entry.doubles[i]);
+                    break;
+                case LOG_ARG_MIXED:
+                    printMixedArg(i, entry);
+                    break;
+            }
+        }
+    }
+
+    if (decoder.isMalformed())
+        printf("Malformed data!\r\n");
 }
 
 // See Header
@@ -232,6 +793,16 @@ void simpleTest() {
     binaryLogWithArgs(&startingBuffer, endOfStartingBuffer, 4, strings);
     binaryLogWithArgs(&startingBuffer, endOfStartingBuffer, 1, &(strings[4]));
 
+    // log a statement with mixed argument types
+    uint32_t fmtId = FormatRegistry::registerFormat(
+                                    "%s has table %lu (%.1f%% full, %d rpcs)");
+    LogArgument mixedArgs[4];
+    mixedArgs[0].stringArg = "Master 1";
+    mixedArgs[1].longArg = ++counter;
+    mixedArgs[2].doubleArg = 42.5;
+    mixedArgs[3].intArg = -counter;
+    binaryLogWithFormat(&startingBuffer, endOfStartingBuffer, fmtId, mixedArgs);
+
     long unsigned int compressedBufferSize = bufferSize;
     long unsigned int uncompressedBufferDatalen = startingBuffer - origStartingBuffer;
     NanoLogCompress2(compressedBuffer, &compressedBufferSize,
@@ -29,6 +29,7 @@
  */
 
 #include <cstdint>
+#include <vector>
 #include <zlib.h>
 
 #include "Cycles.h"
@@ -50,6 +51,11 @@ static const uint32_t LOG_ID_INT_ARGS_START = 64;
 static const uint32_t LOG_ID_LONG_ARGS_START = 128;
 static const uint32_t LOG_ID_DBL_ARGS_START = 192;
 
+// Log statements whose arguments aren't all of the same type don't fit the
+// scheme above; they're assigned fmtIds from here on by the FormatRegistry,
+// which records their argument types.
+static const uint32_t LOG_ID_FORMAT_START = 256;
+
 // Returns the starting log id for a given type of argument.
 static constexpr uint32_t getLogIdStart(const char *dummy) {
     return LOG_ID_STRING_START;
@@ -124,17 +130,82 @@ getArgSize(int numArgs, const char **args) {
 
     return size;
 }
+
+// Longest header Log::compressLogHeader() produces: the header byte followed
+// by up to 4 bytes of fmtId and 8 bytes of timestamp difference.
+static const int MAX_LOG_HEADER_SIZE = 1 + sizeof(uint32_t) + sizeof(uint64_t);
+
+/**
+* Returns the number of bytes BufferUtils::unpack() reads for a value packed
+* with a given nibble; nibbles above 8 denote negated values of (nibble - 8)
+* bytes.
+*
+* @param nibble
+*      Nibble returned by BufferUtils::pack()
+*/
+static inline int
+getPackedLength(uint8_t nibble) {
+    return (nibble <= 8) ? nibble : nibble - 8;
+}
+
+/**
+* Same as Log::decompressLogHeader(), except that it never reads past the end
+* of the buffer; a header cut short by it is copied out and decoded from a
+* zero padded copy instead.
+*
+* @param[in/out] readPos
+*      Buffer to decode the header from (pointer will be incremented)
+* @param endOfBuffer
+*      End of the buffer readPos points into
+* @param lastTimestamp
+*      Timestamp of the previous log entry
+* @param[out] logId
+*      fmtId of the log entry
+* @param[out] timestamp
+*      Timestamp of the log entry
+* @return
+*      false if the header is truncated
+*/
+static inline bool
+decodeLogHeader(const char **readPos, const char *endOfBuffer,
+                uint64_t lastTimestamp, uint32_t *logId, uint64_t *timestamp) {
+    long remaining = endOfBuffer - *readPos;
+    if (remaining <= 0)
+        return false;
+
+    if (remaining >= MAX_LOG_HEADER_SIZE) {
+        NanoLogInternal::Log::decompressLogHeader(readPos, lastTimestamp,
+                                                  *logId, *timestamp);
+        return true;
+    }
+
+    char header[MAX_LOG_HEADER_SIZE] = {};
+    memcpy(header, *readPos, remaining);
+
+    const char *headerPos = header;
+    NanoLogInternal::Log::decompressLogHeader(&headerPos, lastTimestamp,
+                                              *logId, *timestamp);
+    if (headerPos - header > remaining)
+        return false;
+
+    *readPos += headerPos - header;
+    return true;
+}
 }; // namespace LoggerInternals
 
 /**
- * Create a binary NanoLog log entry in BufferIn containing a variable number
- * of int/long/double arguments (up to 64).
+ * Create a binary NanoLog log entry in BufferIn with an explicit timestamp
+ * containing a variable number of int/long/double/string arguments (up to 64).
+ * This is used directly to reconstruct log entries from their compacted form
+ * and indirectly via binaryLogWithArgs() to log new entries.
  *
  * @param[in/out] bufferIn
  *      Pointer to a buffer to write the log entry into (pointer will be
  *      incremented after write)
  * @param endOfBuffer
  *      A pointer to the end of the bufferIn
+ * @param timestamp
+ *      Timestamp to record in the log entry
  * @param numArgs
  *      Number arguments to place in the log entry
  * @param args
@@ -143,8 +214,10 @@ getArgSize(int numArgs, const char **args) {
  *      true if successful, false means disregard data.
  */
 template <typename ArgumentType>
-bool binaryLogWithArgs(unsigned char **bufferIn, unsigned char *endOfBuffer,
-                       int numArgs, ArgumentType *args)
+bool binaryLogWithTimestamp(unsigned char **bufferIn,
+                            unsigned char *endOfBuffer,
+                            uint64_t timestamp,
+                            int numArgs, ArgumentType *args)
 {
     using namespace NanoLogInternal::Log;
     using namespace LoggerInternals;
@@ -168,7 +241,7 @@ bool binaryLogWithArgs(unsigned char **bufferIn, unsigned char *endOfBuffer,
     auto meta = reinterpret_cast<UncompressedEntry*>(*bufferIn);
     *bufferIn += sizeof(UncompressedEntry);
 
-    meta->timestamp = PerfUtils::Cycles::rdtsc();
+    meta->timestamp = timestamp;
     meta->fmtId = logIdStart + numArgs;
     meta->entrySize = bytesRequired;
 
@@ -178,6 +251,30 @@ bool binaryLogWithArgs(unsigned char **bufferIn, unsigned char *endOfBuffer,
     return true;
 }
 
+/**
+ * Create a binary NanoLog log entry in BufferIn containing a variable number
+ * of int/long/double arguments (up to 64).
+ *
+ * @param[in/out] bufferIn
+ *      Pointer to a buffer to write the log entry into (pointer will be
+ *      incremented after write)
+ * @param endOfBuffer
+ *      A pointer to the end of the bufferIn
+ * @param numArgs
+ *      Number arguments to place in the log entry
+ * @param args
+ *      An array of arguments (int/long/double) to place into the array
+ * @return
+ *      true if successful, false means disregard data.
+ */
+template <typename ArgumentType>
+bool binaryLogWithArgs(unsigned char **bufferIn, unsigned char *endOfBuffer,
+                       int numArgs, ArgumentType *args)
+{
+    return binaryLogWithTimestamp(bufferIn, endOfBuffer,
+                                  PerfUtils::Cycles::rdtsc(), numArgs, args);
+}
+
 /**
  * Applies the NanoLog compaction scheme to data produced by
  * binaryLogWithArgs() in inputBuffer and outputs it to outputBuffer.
@@ -204,6 +301,324 @@ int NanoLogCompress2(unsigned char *outputBuffer, long unsigned int *outputSize,
                      const unsigned char *inputBuffer, long unsigned int inputSize,
                      int compressionLevel=0);
 
+/**
+ * Returns an upper bound on the number of bytes NanoLogCompress2() can output
+ * for inputSize bytes of binaryLogWithArgs() data (analogous to zlib's
+ * compressBound()). The worst case is an entry full of 4-byte integers that
+ * don't compact at all, which costs an extra nibble per 4 bytes of input.
+ *
+ * \param inputSize
+ *      Number of bytes of uncompressed log data
+ */
+static inline long unsigned int
+NanoLogCompressBound(long unsigned int inputSize) {
+    return inputSize + inputSize/8 + 64;
+}
+
+/**
+ * NanoLogStream applies the same compaction scheme as NanoLogCompress2(), but
+ * incrementally in the style of zlib's deflate() and z_stream. Instead of
+ * requiring the entire input and a worst-case sized output buffer up front,
+ * the caller feeds it arbitrarily sized pieces of binaryLogWithArgs() data
+ * (entries may be split across pieces) and provides a bounded output window
+ * on every call. The stream keeps the timestamp delta base across calls, so
+ * the concatenated output is identical to NanoLogCompress2()'s output on the
+ * concatenated input.
+ *
+ * Usage is similar to z_stream: set nextIn/availIn and nextOut/availOut,
+ * invoke compress() until availIn is 0 (draining the output window whenever
+ * availOut runs out), and invoke flush() at the end of the stream until it
+ * returns Z_STREAM_END.
+ */
+class NanoLogStream {
+public:
+    // Next input byte to consume and the number of bytes available there
+    const unsigned char *nextIn;
+    long unsigned int availIn;
+
+    // Next output byte to write and the amount of space available there
+    unsigned char *nextOut;
+    long unsigned int availOut;
+
+    // Total number of bytes consumed and output since init()
+    uint64_t totalIn;
+    uint64_t totalOut;
+
+    NanoLogStream();
+
+    /**
+     * Resets the stream so that it can be used to compress a new sequence of
+     * log entries; the next entry's timestamp will be encoded relative to 0.
+     */
+    void init();
+
+    /**
+     * Consumes as much input from nextIn as possible and outputs the compacted
+     * entries to nextOut until either the input runs out or the output window
+     * is full. Trailing partial entries are buffered internally and completed
+     * by the next invocation.
+     *
+     * \return
+     *      Z_OK if progress was made, Z_BUF_ERROR if no progress was possible
+     *      (i.e. no input or no output space), and Z_DATA_ERROR if the input
+     *      contains a malformed entry.
+     */
+    int compress();
+
+    /**
+     * Outputs any compacted data still buffered internally to nextOut.
+     *
+     * \return
+     *      Z_STREAM_END if all the data has been output, Z_OK if flush()
+     *      needs to be invoked again with more output space, and
+     *      Z_DATA_ERROR if the stream ended in the middle of an entry.
+     */
+    int flush();
+
+private:
+    bool drainPendingOutput();
+
+    // Timestamp of the last entry compressed
+    uint64_t lastTime;
+
+    // Buffers a log entry that was split across compress() invocations
+    std::vector<unsigned char> partialEntry;
+
+    // Number of valid bytes in partialEntry
+    long unsigned int partialEntryBytes;
+
+    // Buffers compacted output that didn't fit into the output window
+    std::vector<unsigned char> pendingOutput;
+
+    // Range of the valid bytes in pendingOutput that still need to be output
+    long unsigned int pendingOutputStart;
+    long unsigned int pendingOutputEnd;
+};
+
+/**
+ * Types of arguments a log entry can contain; the type is implied by the
+ * range the entry's fmtId falls into (see LoggerInternals::LOG_ID_*). Entries
+ * with fmtIds from the FormatRegistry are LOG_ARG_MIXED; the type of each of
+ * their arguments is given by the registered FormatSignature.
+ */
+enum LogArgType {
+    LOG_ARG_STRING,
+    LOG_ARG_INT,
+    LOG_ARG_LONG,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_MIXED
+};
+
+/**
+ * A single argument of a log statement with mixed argument types; which
+ * member is valid is given by the statement's FormatSignature.
+ */
+union LogArgument {
+    int intArg;
+    long longArg;
+    double doubleArg;
+    const char *stringArg;
+};
+
+/**
+ * Create a binary NanoLog log entry in bufferIn with an explicit timestamp
+ * for a log statement registered with the FormatRegistry, whose arguments
+ * may be of mixed types. The arguments are stored back to back in the order
+ * and with the types given by the statement's FormatSignature.
+ *
+ * \param[in/out] bufferIn
+ *      Pointer to a buffer to write the log entry into (pointer will be
+ *      incremented after write)
+ * \param endOfBuffer
+ *      A pointer to the end of the bufferIn
+ * \param timestamp
+ *      Timestamp to record in the log entry
+ * \param fmtId
+ *      fmtId returned by FormatRegistry::registerFormat()
+ * \param args
+ *      Arguments of the log statement
+ * \return
+ *      true if successful, false means disregard data.
+ */
+bool binaryLogFormatWithTimestamp(unsigned char **bufferIn,
+                                  unsigned char *endOfBuffer,
+                                  uint64_t timestamp, uint32_t fmtId,
+                                  const LogArgument *args);
+
+/**
+ * Same as binaryLogFormatWithTimestamp(), but timestamps the log entry with
+ * the current time.
+ *
+ * \param[in/out] bufferIn
+ *      Pointer to a buffer to write the log entry into (pointer will be
+ *      incremented after write)
+ * \param endOfBuffer
+ *      A pointer to the end of the bufferIn
+ * \param fmtId
+ *      fmtId returned by FormatRegistry::registerFormat()
+ * \param args
+ *      Arguments of the log statement
+ * \return
+ *      true if successful, false means disregard data.
+ */
+static inline bool
+binaryLogWithFormat(unsigned char **bufferIn, unsigned char *endOfBuffer,
+                    uint32_t fmtId, const LogArgument *args)
+{
+    return binaryLogFormatWithTimestamp(bufferIn, endOfBuffer,
+                                        PerfUtils::Cycles::rdtsc(), fmtId,
+                                        args);
+}
+
+/**
+ * Compacts the arguments of a log entry created by binaryLogWithFormat() in
+ * the order of its FormatSignature: int/long arguments are packed with
+ * BufferUtils::pack(), with every two of them sharing a TwoNibbles byte that
+ * precedes the first of the two, while double/string arguments are copied
+ * as is. This is what NanoLogCompress2() does after compressing the entry's
+ * header, and what other compressors use for such entries.
+ *
+ * \param entry
+ *      Log entry whose arguments should be compacted; its fmtId must have
+ *      been registered with the FormatRegistry
+ * \param[in/out] writePos
+ *      Buffer to output the compacted arguments to (pointer will be
+ *      incremented after the write). Must have at least
+ *      NanoLogCompressBound(entry->entrySize) bytes of space.
+ */
+void compressFormatArgs(const NanoLogInternal::Log::UncompressedEntry *entry,
+                        unsigned char **writePos);
+
+/**
+ * A log entry decoded from NanoLog compacted data by NanoLogDecoder. The
+ * structure is sized for the maximum number of arguments so that it can be
+ * reused across entries without any allocation; only the array matching
+ * argType is valid, and only its first numArgs elements.
+ */
+struct DecodedEntry {
+    // Identifies the log statement and the type/number of arguments
+    uint32_t fmtId;
+
+    // Runtime timestamp of the log entry (in Cycles::rdtsc() cycles)
+    uint64_t timestamp;
+
+    // Type of the arguments in the entry
+    LogArgType argType;
+
+    // Number of arguments in the entry
+    int numArgs;
+
+    // Argument values. String arguments point directly into the compacted
+    // buffer and are only valid for as long as the buffer is.
+    int ints[LoggerInternals::LOG_ID_MAX_ARGS];
+    long longs[LoggerInternals::LOG_ID_MAX_ARGS];
+    double doubles[LoggerInternals::LOG_ID_MAX_ARGS];
+    const char *strings[LoggerInternals::LOG_ID_MAX_ARGS];
+
+    // Argument values of LOG_ARG_MIXED entries
+    LogArgument mixed[LoggerInternals::LOG_ID_MAX_ARGS];
+};
+
+/**
+ * Decodes NanoLog compacted data (i.e. the output of NanoLogCompress2() or
+ * NanoLogStream) one entry at a time into a caller provided DecodedEntry.
+ */
+class NanoLogDecoder {
+public:
+    /**
+     * Construct a decoder over a buffer of NanoLog compacted data.
+     *
+     * \param inputBuffer
+     *      Buffer containing the compacted log entries
+     * \param inputSize
+     *      Number of valid bytes in the buffer
+     * \param vectorized
+     *      True means unpack int/long arguments with the SimdPacker vector
+     *      kernels instead of one BufferUtils::unpack() at a time
+     */
+    NanoLogDecoder(const char *inputBuffer, long unsigned int inputSize,
+                   bool vectorized = false)
+        : readPos(inputBuffer)
+        , endOfBuffer(inputBuffer + inputSize)
+        , lastTimestamp(0)
+        , malformed(false)
+        , vectorized(vectorized)
+    {}
+
+    /**
+     * Decodes the next log entry in the buffer.
+     *
+     * \param[out] entry
+     *      Decoded log entry
+     * \return
+     *      true if an entry was decoded; false if the end of the buffer was
+     *      reached or the data is malformed (see isMalformed()).
+     */
+    bool next(DecodedEntry *entry);
+
+    /**
+     * Returns true if decoding stopped because of malformed data.
+     */
+    bool isMalformed() const {
+        return malformed;
+    }
+
+private:
+    bool decodeFormatArgs(DecodedEntry *entry);
+
+    // Next byte to decode and the first invalid byte in the buffer
+    const char *readPos;
+    const char *endOfBuffer;
+
+    // Timestamp of the previous entry decoded
+    uint64_t lastTimestamp;
+
+    // Set when next() encounters data it cannot decode
+    bool malformed;
+
+    // Unpack int/long arguments with the SimdPacker kernels
+    bool vectorized;
+};
+
+/**
+ * Recreates the binaryLogWithArgs() log entry for a DecodedEntry.
+ *
+ * \param[in/out] bufferIn
+ *      Pointer to a buffer to write the log entry into (pointer will be
+ *      incremented after write)
+ * \param endOfBuffer
+ *      A pointer to the end of the bufferIn
+ * \param entry
+ *      Decoded log entry to recreate
+ * \return
+ *      true if successful, false means there was not enough space.
+ */
+bool binaryLogDecodedEntry(unsigned char **bufferIn, unsigned char *endOfBuffer,
+                           DecodedEntry *entry);
+
+/**
+ * Reverses NanoLogCompress2(); i.e. decodes NanoLog compacted data in
+ * inputBuffer and reconstructs the original binaryLogWithArgs() log entries in
+ * outputBuffer. It has the same API as zlib's uncompress function.
+ *
+ * \param outputBuffer
+ *      Output buffer to store the reconstructed log entries
+ * \param outputSize
+ *      Initially set by the caller to indicate the size of outputBuffer. On
+ *      return, it is set to the number of bytes actually used in the buffer.
+ * \param inputBuffer
+ *      Buffer containing NanoLog compacted data
+ * \param inputSize
+ *      Number of bytes to consume in the inputBuffer
+ *
+ * \return
+ *      Same as libz's return status's
+ */
+int NanoLogUncompress(unsigned char *outputBuffer,
+                      long unsigned int *outputSize,
+                      const unsigned char *inputBuffer,
+                      long unsigned int inputSize);
+
 /**
  * Primarily used as a debug function, takes a buffer with NanoLog log entries
  * and outputs their content to stdout for human consumption.
@@ -0,0 +1,343 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+
+#include "Logger.h"
+#include "ParallelCompressor.h"
+
+/**
+ * This file implements the ParallelCompressor declared in
+ * ParallelCompressor.h
+ */
+
+// Extra scratch space reserved per chunk by prepare() since chunks are split
+// on entry boundaries and can thus be slightly larger than inputSize/N.
+static const long unsigned int CHUNK_SLACK_BYTES = 64*1024;
+
+ParallelCompressor::ParallelCompressor(int maxThreads)
+    : maxThreads(std::max(1, maxThreads))
+    , threads()
+    , scratch(this->maxThreads, nullptr)
+    , scratchSize(this->maxThreads, 0)
+    , mutex()
+    , workReady()
+    , workDone()
+    , generation(0)
+    , activeWorkers(0)
+    , pendingWorkers(0)
+    , task(nullptr)
+    , shutdown(false)
+{
+    for (int i = 1; i < this->maxThreads; ++i)
+        threads.emplace_back(&ParallelCompressor::workerMain, this, i);
+}
+
+ParallelCompressor::~ParallelCompressor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shutdown = true;
+    }
+    workReady.notify_all();
+
+    for (std::thread &thread : threads)
+        thread.join();
+
+    for (unsigned char *buffer : scratch)
+        free(buffer);
+}
+
+// See Header
+void
+ParallelCompressor::prepare(long unsigned int maxInputSize)
+{
+    // Worker i only participates when there are at least i + 1 chunks, so
+    // the largest chunk it will ever see is roughly maxInputSize/(i + 1).
+    for (int i = 1; i < maxThreads; ++i) {
+        long unsigned int chunkSize = maxInputSize/(i + 1) + CHUNK_SLACK_BYTES;
+        reserveScratch(i, NanoLogCompressBound(chunkSize));
+    }
+}
+
+// See Header
+int
+ParallelCompressor::compress(unsigned char *outputBuffer,
+                             long unsigned int *outputSize,
+                             const unsigned char *inputBuffer,
+                             long unsigned int inputSize,
+                             int numThreads)
+{
+    using namespace NanoLogInternal;
+
+    numThreads = std::min(std::max(1, numThreads), maxThreads);
+
+    long unsigned int directorySize = getDirectorySize(numThreads);
+    if (*outputSize < directorySize) {
+        fprintf(stderr, "Ran out of space in the output buffer\r\n");
+        return Z_BUF_ERROR;
+    }
+
+    // Split the input into roughly equal chunks on entry boundaries. This
+    // has to be done serially since the raw entries have no sync markers,
+    // but it only touches the headers of the entries.
+    std::vector<const unsigned char*> bounds(numThreads + 1);
+    const unsigned char *pos = inputBuffer;
+    const unsigned char *endOfInput = inputBuffer + inputSize;
+
+    bounds[0] = inputBuffer;
+    for (int i = 1; i < numThreads; ++i) {
+        const unsigned char *target = inputBuffer + i*(inputSize/numThreads);
+        while (pos < target) {
+            pos += reinterpret_cast<const Log::UncompressedEntry*>(pos)
+                                                                ->entrySize;
+        }
+
+        bounds[i] = std::min(pos, endOfInput);
+    }
+    bounds[numThreads] = endOfInput;
+
+    // Phase 1: Compact every chunk. The first chunk is compacted directly
+    // into the output buffer and the rest go to scratch buffers.
+    std::vector<long unsigned int> chunkBytes(numThreads);
+    std::vector<int> status(numThreads);
+    runOnWorkers(numThreads, [&](int id) {
+        long unsigned int chunkInputSize = bounds[id + 1] - bounds[id];
+        unsigned char *chunkOutput;
+
+        if (id == 0) {
+            chunkOutput = outputBuffer + directorySize;
+            chunkBytes[id] = *outputSize - directorySize;
+        } else {
+            reserveScratch(id, NanoLogCompressBound(chunkInputSize));
+            chunkOutput = scratch[id];
+            chunkBytes[id] = scratchSize[id];
+        }
+
+        status[id] = NanoLogCompress2(chunkOutput, &chunkBytes[id],
+                                      bounds[id], chunkInputSize);
+    });
+
+    std::vector<long unsigned int> offsets(numThreads);
+    long unsigned int totalSize = directorySize;
+    for (int i = 0; i < numThreads; ++i) {
+        if (status[i] != Z_OK)
+            return status[i];
+
+        offsets[i] = totalSize;
+        totalSize += chunkBytes[i];
+    }
+
+    if (totalSize > *outputSize) {
+        fprintf(stderr, "Ran out of space in the output buffer\r\n");
+        return Z_BUF_ERROR;
+    }
+
+    // Phase 2: Write the chunk directory and stitch the chunks together
+    uint32_t numChunks = numThreads;
+    memcpy(outputBuffer, &numChunks, sizeof(uint32_t));
+    for (int i = 0; i < numThreads; ++i) {
+        uint64_t bytes = chunkBytes[i];
+        memcpy(outputBuffer + sizeof(uint32_t) + i*sizeof(uint64_t),
+               &bytes, sizeof(uint64_t));
+    }
+
+    runOnWorkers(numThreads, [&](int id) {
+        if (id > 0)
+            memcpy(outputBuffer + offsets[id], scratch[id], chunkBytes[id]);
+    });
+
+    *outputSize = totalSize;
+    return Z_OK;
+}
+
+// See Header
+int
+ParallelCompressor::uncompress(unsigned char *outputBuffer,
+                               long unsigned int *outputSize,
+                               const unsigned char *inputBuffer,
+                               long unsigned int inputSize)
+{
+    ChunkList chunks;
+    if (!readDirectory((const char*)inputBuffer, inputSize, &chunks))
+        return Z_DATA_ERROR;
+
+    long unsigned int totalSize = 0;
+    for (auto &chunk : chunks) {
+        long unsigned int chunkOutputSize = *outputSize - totalSize;
+        int retVal = NanoLogUncompress(outputBuffer + totalSize,
+                                       &chunkOutputSize,
+                                       (const unsigned char*)chunk.first,
+                                       chunk.second);
+        if (retVal != Z_OK)
+            return retVal;
+
+        totalSize += chunkOutputSize;
+    }
+
+    *outputSize = totalSize;
+    return Z_OK;
+}
+
+// See Header
+void
+ParallelCompressor::decompress(const char *inputBuffer,
+                               long unsigned int inputSize)
+{
+    ChunkList chunks;
+    if (!readDirectory(inputBuffer, inputSize, &chunks)) {
+        printf("Malformed data!\r\n");
+        return;
+    }
+
+    for (uint32_t i = 0; i < chunks.size(); ++i) {
+        printf("Chunk %u (%lu bytes):\r\n", i, chunks[i].second);
+        NanoLogDecompress(chunks[i].first, chunks[i].second);
+    }
+}
+
+/**
+ * Parses the chunk directory at the start of the output of compress().
+ *
+ * \param inputBuffer
+ *      Buffer containing the output of compress()
+ * \param inputSize
+ *      Number of valid bytes in the buffer
+ * \param[out] chunks
+ *      Populated with the start and size of every chunk
+ * \return
+ *      false if the directory is malformed
+ */
+bool
+ParallelCompressor::readDirectory(const char *inputBuffer,
+                                  long unsigned int inputSize,
+                                  ChunkList *chunks)
+{
+    uint32_t numChunks;
+    if (inputSize < getDirectorySize(0))
+        return false;
+
+    memcpy(&numChunks, inputBuffer, sizeof(uint32_t));
+    if (inputSize < getDirectorySize(numChunks))
+        return false;
+
+    const char *chunk = inputBuffer + getDirectorySize(numChunks);
+    for (uint32_t i = 0; i < numChunks; ++i) {
+        uint64_t chunkBytes;
+        memcpy(&chunkBytes,
+               inputBuffer + sizeof(uint32_t) + i*sizeof(uint64_t),
+               sizeof(uint64_t));
+
+        if (chunk + chunkBytes > inputBuffer + inputSize)
+            return false;
+
+        chunks->emplace_back(chunk, chunkBytes);
+        chunk += chunkBytes;
+    }
+
+    return true;
+}
+
+/**
+ * Main loop of the pool threads; waits for runOnWorkers() to hand out tasks
+ * and executes them until the ParallelCompressor is destroyed.
+ *
+ * \param workerId
+ *      Identifies which part of a task this thread is responsible for
+ */
+void
+ParallelCompressor::workerMain(int workerId)
+{
+    uint64_t lastGeneration = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        workReady.wait(lock, [&] {
+            return shutdown || generation != lastGeneration;
+        });
+
+        if (shutdown)
+            return;
+
+        lastGeneration = generation;
+        if (workerId >= activeWorkers)
+            continue;
+
+        const std::function<void(int)> *fn = task;
+        lock.unlock();
+        (*fn)(workerId);
+        lock.lock();
+
+        if (--pendingWorkers == 0)
+            workDone.notify_one();
+    }
+}
+
+// See Header
+void
+ParallelCompressor::runOnWorkers(int numWorkers,
+                                 const std::function<void(int)> &fn)
+{
+    if (numWorkers <= 1) {
+        fn(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &fn;
+        activeWorkers = numWorkers;
+        pendingWorkers = numWorkers - 1;
+        ++generation;
+    }
+    workReady.notify_all();
+
+    fn(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    workDone.wait(lock, [&] { return pendingWorkers == 0; });
+    task = nullptr;
+}
+
+/**
+ * Ensures that the scratch buffer for a worker is at least a certain size.
+ * Newly allocated buffers are zeroed so that their pages are faulted in
+ * before they are used in a timed region.
+ *
+ * \param workerId
+ *      Worker whose scratch buffer to grow
+ * \param bytes
+ *      Minimum size of the scratch buffer
+ */
+void
+ParallelCompressor::reserveScratch(int workerId, long unsigned int bytes)
+{
+    if (scratchSize[workerId] >= bytes)
+        return;
+
+    free(scratch[workerId]);
+    scratch[workerId] = static_cast<unsigned char*>(malloc(bytes));
+    if (scratch[workerId] == nullptr) {
+        fprintf(stderr, "Could not allocate a scratch buffer of %lu bytes "
+                "for parallel compression\r\n", bytes);
+        exit(-1);
+    }
+
+    bzero(scratch[workerId], bytes);
+    scratchSize[workerId] = bytes;
+}
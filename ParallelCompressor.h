@@ -0,0 +1,189 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef COMPRESSION_PARALLEL_COMPRESSOR_H
+#define COMPRESSION_PARALLEL_COMPRESSOR_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * ParallelCompressor applies the NanoLog compaction scheme (i.e.
+ * NanoLogCompress2()) to binaryLogWithArgs() data using a pool of worker
+ * threads. The input is split on UncompressedEntry boundaries into one chunk
+ * per thread and each chunk is compacted independently (the timestamp delta
+ * base restarts for every chunk), so the chunks can also be decoded
+ * independently.
+ *
+ * The compacted output is a small chunk directory followed by the chunks:
+ *
+ *      uint32_t numChunks
+ *      uint64_t chunkBytes[numChunks]
+ *      <chunk 0> <chunk 1> ... <chunk numChunks - 1>
+ *
+ * The worker threads and their scratch buffers persist across compress()
+ * invocations so that thread creation and first-touch page faults are not
+ * charged to the compression itself.
+ */
+class ParallelCompressor {
+public:
+    explicit ParallelCompressor(int maxThreads);
+    ~ParallelCompressor();
+
+    /**
+     * Pre-allocates (and pre-faults) the per-thread scratch buffers so that
+     * subsequent compress() calls with up to maxInputSize bytes of input do
+     * not allocate memory.
+     *
+     * \param maxInputSize
+     *      Largest inputSize that will be passed to compress()
+     */
+    void prepare(long unsigned int maxInputSize);
+
+    /**
+     * Compacts inputBuffer with numThreads threads. It has the same API as
+     * zlib's compress function except the compressionLevel parameter is
+     * replaced by the number of threads to use.
+     *
+     * \param outputBuffer
+     *      Output buffer to store the chunk directory and compacted chunks
+     * \param outputSize
+     *      Initially set by the caller to indicate the size of outputBuffer.
+     *      On return, it is set to the number of bytes actually used.
+     * \param inputBuffer
+     *      Buffer that contains data generated by binaryLogWithArgs()
+     * \param inputSize
+     *      Number of bytes to consume in the inputBuffer
+     * \param numThreads
+     *      Number of chunks/threads to use; clamped to [1, maxThreads]
+     *
+     * \return
+     *      Same as libz's return status's
+     */
+    int compress(unsigned char *outputBuffer, long unsigned int *outputSize,
+                 const unsigned char *inputBuffer, long unsigned int inputSize,
+                 int numThreads);
+
+    /**
+     * Primarily used as a debug function, walks the chunk directory produced
+     * by compress() and outputs the content of every chunk to stdout via
+     * NanoLogDecompress().
+     *
+     * \param inputBuffer
+     *      Buffer containing the output of compress()
+     * \param inputSize
+     *      Number of valid bytes in the buffer
+     */
+    static void decompress(const char *inputBuffer,
+                           long unsigned int inputSize);
+
+    /**
+     * Reverses compress(); i.e. decodes every chunk listed in the chunk
+     * directory and reconstructs the original binaryLogWithArgs() log entries
+     * in outputBuffer. It has the same API as zlib's uncompress function.
+     *
+     * \param outputBuffer
+     *      Output buffer to store the reconstructed log entries
+     * \param outputSize
+     *      Initially set by the caller to indicate the size of outputBuffer.
+     *      On return, it is set to the number of bytes actually used.
+     * \param inputBuffer
+     *      Buffer containing the output of compress()
+     * \param inputSize
+     *      Number of valid bytes in the buffer
+     *
+     * \return
+     *      Same as libz's return status's
+     */
+    static int uncompress(unsigned char *outputBuffer,
+                          long unsigned int *outputSize,
+                          const unsigned char *inputBuffer,
+                          long unsigned int inputSize);
+
+    /**
+     * Invokes fn(workerId) for workerIds [0, numWorkers) in parallel on the
+     * pool's threads and returns once all of them complete. The calling
+     * thread executes workerId 0. This lets other parallel work, such as
+     * generating the benchmark's datasets, reuse the pool.
+     *
+     * \param numWorkers
+     *      Number of workers to run fn on (at most getMaxThreads())
+     * \param fn
+     *      Task to run
+     */
+    void runOnWorkers(int numWorkers, const std::function<void(int)> &fn);
+
+    /**
+     * Returns the maximum number of threads compress() can use
+     */
+    int getMaxThreads() const {
+        return maxThreads;
+    }
+
+    /**
+     * Returns the number of bytes the chunk directory occupies
+     */
+    static long unsigned int getDirectorySize(int numChunks) {
+        return sizeof(uint32_t) + numChunks*sizeof(uint64_t);
+    }
+
+private:
+    typedef std::vector<std::pair<const char*, uint64_t>> ChunkList;
+    static bool readDirectory(const char *inputBuffer,
+                              long unsigned int inputSize,
+                              ChunkList *chunks);
+
+    void workerMain(int workerId);
+    void reserveScratch(int workerId, long unsigned int bytes);
+
+    // Maximum number of threads (including the caller's) compress() uses
+    const int maxThreads;
+
+    // Worker threads; threads[i] executes work for workerId i + 1 since
+    // workerId 0 is always executed by the thread invoking compress().
+    std::vector<std::thread> threads;
+
+    // Per-worker buffers that chunks 1..N-1 are compacted into before being
+    // stitched into the final output (chunk 0 is compacted in place).
+    std::vector<unsigned char*> scratch;
+    std::vector<long unsigned int> scratchSize;
+
+    // Protects the fields below and is used with the condition variables to
+    // hand out work to the worker threads.
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+
+    // Incremented every time a new task is handed to the workers
+    uint64_t generation;
+
+    // Number of workers (including the caller) participating in the task
+    int activeWorkers;
+
+    // Number of pool threads that have yet to finish the current task
+    int pendingWorkers;
+
+    // Task to invoke with the workerId of the thread running it
+    const std::function<void(int)> *task;
+
+    // Set by the destructor to stop the worker threads
+    bool shutdown;
+};
+
+#endif //COMPRESSION_PARALLEL_COMPRESSOR_H
@@ -0,0 +1,195 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "PerfCounters.h"
+
+// See Header
+PerfCounts
+PerfCounts::operator-(const PerfCounts &other) const
+{
+    PerfCounts difference;
+    for (int i = 0; i < NUM_COUNTERS; ++i)
+        difference.values[i] = values[i] - other.values[i];
+
+    difference.available = available & other.available;
+    difference.timeEnabled = timeEnabled - other.timeEnabled;
+    difference.timeRunning = timeRunning - other.timeRunning;
+    return difference;
+}
+
+// See Header
+PerfCounts
+PerfCounts::operator+(const PerfCounts &other) const
+{
+    PerfCounts sum;
+    for (int i = 0; i < NUM_COUNTERS; ++i)
+        sum.values[i] = values[i] + other.values[i];
+
+    sum.available = available & other.available;
+    sum.timeEnabled = timeEnabled + other.timeEnabled;
+    sum.timeRunning = timeRunning + other.timeRunning;
+    return sum;
+}
+
+/**
+ * Returns the short name of a counter, for labelling output.
+ *
+ * \param counter
+ *      Counter to name
+ */
+const char *
+PerfCounts::getName(Counter counter)
+{
+    static const char *names[NUM_COUNTERS] = {
+        "cycles", "instr", "br-miss", "L1d-miss", "LLC-miss", "dTLB-miss"
+    };
+
+    return names[counter];
+}
+
+PerfCounters::PerfCounters()
+    : fds()
+    , slots()
+    , groupFd(-1)
+    , numOpen(0)
+{
+    for (int i = 0; i < PerfCounts::NUM_COUNTERS; ++i) {
+        fds[i] = -1;
+        slots[i] = -1;
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (int i = 0; i < PerfCounts::NUM_COUNTERS; ++i) {
+        if (fds[i] >= 0)
+            close(fds[i]);
+    }
+}
+
+/**
+ * Encodes the perf_event_attr config of a generalized cache event.
+ *
+ * \param cache
+ *      One of the PERF_COUNT_HW_CACHE_* caches
+ * \param op
+ *      One of the PERF_COUNT_HW_CACHE_OP_* operations
+ * \param result
+ *      One of the PERF_COUNT_HW_CACHE_RESULT_* results
+ */
+static uint64_t
+cacheEvent(uint64_t cache, uint64_t op, uint64_t result)
+{
+    return cache | (op << 8) | (result << 16);
+}
+
+// See Header
+bool
+PerfCounters::open()
+{
+    if (isOpen())
+        return true;
+
+    static const struct {
+        uint32_t type;
+        uint64_t config;
+    } events[PerfCounts::NUM_COUNTERS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE, cacheEvent(PERF_COUNT_HW_CACHE_L1D,
+                                        PERF_COUNT_HW_CACHE_OP_READ,
+                                        PERF_COUNT_HW_CACHE_RESULT_MISS)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HW_CACHE, cacheEvent(PERF_COUNT_HW_CACHE_DTLB,
+                                        PERF_COUNT_HW_CACHE_OP_READ,
+                                        PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    };
+
+    int firstError = 0;
+    for (int i = 0; i < PerfCounts::NUM_COUNTERS; ++i) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.disabled = (groupFd < 0);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP |
+                           PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1,
+                                          groupFd, 0));
+        if (fd < 0) {
+            if (firstError == 0)
+                firstError = errno;
+            continue;
+        }
+
+        if (groupFd < 0)
+            groupFd = fd;
+        fds[i] = fd;
+        slots[i] = numOpen++;
+    }
+
+    if (groupFd < 0) {
+        fprintf(stderr, "Hardware performance counters are unavailable "
+                "(perf_event_open: %s)%s\r\n", strerror(firstError),
+                (firstError == EACCES || firstError == EPERM)
+                        ? "; check /proc/sys/kernel/perf_event_paranoid" : "");
+        return false;
+    }
+
+    ioctl(groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+// See Header
+PerfCounts
+PerfCounters::read() const
+{
+    PerfCounts counts;
+    if (!isOpen())
+        return counts;
+
+    // Layout of PERF_FORMAT_GROUP with both times: nr, time_enabled,
+    // time_running and then a value per counter
+    uint64_t buffer[3 + PerfCounts::NUM_COUNTERS];
+    ssize_t bytesRead = ::read(groupFd, buffer, sizeof(buffer));
+    if (bytesRead < static_cast<ssize_t>((3 + numOpen)*sizeof(uint64_t)))
+        return counts;
+
+    counts.timeEnabled = buffer[1];
+    counts.timeRunning = buffer[2];
+    for (int i = 0; i < PerfCounts::NUM_COUNTERS; ++i) {
+        if (slots[i] >= 0) {
+            counts.values[i] = buffer[3 + slots[i]];
+            counts.available |= 1U << i;
+        }
+    }
+
+    return counts;
+}
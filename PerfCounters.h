@@ -0,0 +1,170 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef COMPRESSION_PERF_COUNTERS_H
+#define COMPRESSION_PERF_COUNTERS_H
+
+#include <cstdint>
+
+/**
+ * Values of the hardware performance counters read by PerfCounters. Like
+ * Cycles::rdtsc() timestamps, readings only become meaningful as the
+ * difference between one taken before a region of code and one after it,
+ * and those differences can be added up.
+ */
+struct PerfCounts {
+    // The counters PerfCounters tries to open
+    enum Counter {
+        CYCLES,
+        INSTRUCTIONS,
+        BRANCH_MISSES,
+        L1D_READ_MISSES,
+        LLC_MISSES,
+        DTLB_READ_MISSES,
+        NUM_COUNTERS
+    };
+
+    // Raw value of each counter
+    uint64_t values[NUM_COUNTERS];
+
+    // Bit mask of the counters that were part of the group read
+    uint32_t available;
+
+    // Nanoseconds the counters were enabled, and actually counting. The
+    // kernel time-multiplexes the hardware between counter groups when
+    // there are more groups than counters, in which case the counting
+    // time falls short of the enabled time. A counting time of 0 means the
+    // counts weren't measured.
+    uint64_t timeEnabled;
+    uint64_t timeRunning;
+
+    PerfCounts()
+        : values()
+        , available(0)
+        , timeEnabled(0)
+        , timeRunning(0)
+    {}
+
+    PerfCounts operator-(const PerfCounts &other) const;
+    PerfCounts operator+(const PerfCounts &other) const;
+
+    /**
+     * Returns true if the counts were measured
+     */
+    bool isMeasured() const {
+        return timeRunning > 0;
+    }
+
+    /**
+     * Returns true if a counter was measured
+     *
+     * \param counter
+     *      Counter to check
+     */
+    bool isMeasured(Counter counter) const {
+        return timeRunning > 0 && (available & (1U << counter)) != 0;
+    }
+
+    /**
+     * Returns the value of a counter, scaled up to the time the counters were
+     * enabled if the group was multiplexed.
+     *
+     * \param counter
+     *      Counter to return
+     */
+    double get(Counter counter) const {
+        if (timeRunning == 0)
+            return 0;
+
+        return values[counter]*(1.0*timeEnabled/timeRunning);
+    }
+
+    static const char *getName(Counter counter);
+};
+
+/**
+ * PerfCounters reads a group of hardware performance counters of the
+ * calling thread via perf_event_open(2): core cycles, instructions, branch
+ * misses, L1 data cache read misses, last level cache misses and data TLB
+ * read misses. Only user space events are counted, so that the usual
+ * perf_event_paranoid setting of 2 is enough.
+ *
+ * The counters run from open() until the object is destroyed and read()
+ * returns their current values, so a region of code is measured by
+ * subtracting a reading taken before it from one taken after it. Each
+ * read() is a system call, so readings belong outside of rdtsc()-timed
+ * regions.
+ *
+ * Opening fails gracefully: if the kernel forbids access or there's no PMU
+ * (e.g. in most containers and VMs), read() returns unmeasured counts, and
+ * counters the CPU doesn't support are left out of the group.
+ */
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    /**
+     * Opens and starts the counters of the calling thread.
+     *
+     * \return
+     *      False if no counters could be opened; the reason is printed to
+     *      stderr
+     */
+    bool open();
+
+    /**
+     * Returns true if the counters were opened
+     */
+    bool isOpen() const {
+        return groupFd >= 0;
+    }
+
+    /**
+     * Returns true if a counter is part of the opened group
+     *
+     * \param counter
+     *      Counter to check
+     */
+    bool isAvailable(PerfCounts::Counter counter) const {
+        return slots[counter] >= 0;
+    }
+
+    /**
+     * Returns the current values of the counters; they aren't measured if
+     * the counters aren't open.
+     */
+    PerfCounts read() const;
+
+private:
+    // File descriptor of each counter (-1 if unavailable); the first
+    // available one leads the group
+    int fds[PerfCounts::NUM_COUNTERS];
+
+    // Position of each counter's value in the group's read() format (-1 if
+    // unavailable)
+    int slots[PerfCounts::NUM_COUNTERS];
+
+    // File descriptor of the group leader (-1 if the group isn't open)
+    int groupFd;
+
+    // Number of counters in the group
+    int numOpen;
+
+    // PerfCounters owns file descriptors
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+};
+
+#endif //COMPRESSION_PERF_COUNTERS_H
@@ -0,0 +1,106 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <algorithm>
+#include <cmath>
+
+#include "SampleStatistics.h"
+
+SampleStatistics::SampleStatistics(const std::vector<double> &samples)
+    : count(static_cast<int>(samples.size()))
+    , min(0)
+    , max(0)
+    , median(0)
+    , mean(0)
+    , stddev(0)
+    , confidence95(0)
+    , numOutliers(0)
+{
+    if (count == 0)
+        return;
+
+    std::vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    min = sorted.front();
+    max = sorted.back();
+    median = getQuantile(sorted, 0.5);
+
+    for (double sample : sorted)
+        mean += sample;
+    mean /= count;
+
+    if (count < 2)
+        return;
+
+    double sumOfSquares = 0;
+    for (double sample : sorted)
+        sumOfSquares += (sample - mean)*(sample - mean);
+    stddev = std::sqrt(sumOfSquares/(count - 1));
+    confidence95 = getStudentT95(count - 1)*stddev/std::sqrt(count);
+
+    double q1 = getQuantile(sorted, 0.25);
+    double q3 = getQuantile(sorted, 0.75);
+    double lowerFence = q1 - 1.5*(q3 - q1);
+    double upperFence = q3 + 1.5*(q3 - q1);
+    for (double sample : sorted) {
+        if (sample < lowerFence || sample > upperFence)
+            ++numOutliers;
+    }
+}
+
+/**
+ * Returns a quantile of sorted measurements, interpolating linearly between
+ * the two closest ranks.
+ *
+ * \param sorted
+ *      Measurements in ascending order; must not be empty
+ * \param fraction
+ *      Quantile to compute, between 0 and 1
+ */
+double
+SampleStatistics::getQuantile(const std::vector<double> &sorted,
+                              double fraction)
+{
+    double position = fraction*(sorted.size() - 1);
+    size_t below = static_cast<size_t>(position);
+    if (below + 1 >= sorted.size())
+        return sorted.back();
+
+    double weight = position - below;
+    return sorted[below]*(1 - weight) + sorted[below + 1]*weight;
+}
+
+/**
+ * Returns the two-sided 95% critical value of Student's t-distribution.
+ *
+ * \param degreesOfFreedom
+ *      Degrees of freedom, at least 1
+ */
+double
+SampleStatistics::getStudentT95(int degreesOfFreedom)
+{
+    static const double criticalValues[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    static const int TABLE_SIZE = sizeof(criticalValues)/sizeof(double);
+
+    if (degreesOfFreedom <= TABLE_SIZE)
+        return criticalValues[degreesOfFreedom - 1];
+
+    // Past 30 degrees of freedom the distribution is close enough to normal
+    // that the tail correction below is within 0.002 of the exact value
+    return 1.960 + 2.4/degreesOfFreedom;
+}
@@ -0,0 +1,102 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef COMPRESSION_SAMPLE_STATISTICS_H
+#define COMPRESSION_SAMPLE_STATISTICS_H
+
+#include <vector>
+
+/**
+ * SampleStatistics summarizes the measurements of a metric taken over
+ * repeated trials of a benchmark: the minimum, median, mean, sample standard
+ * deviation, the half-width of the 95% confidence interval of the mean
+ * (using Student's t-distribution, since the trials are few), and the number
+ * of outliers by Tukey's fences, i.e. measurements more than 1.5 times the
+ * interquartile range below the first or above the third quartile.
+ *
+ * Outliers are counted but not excluded from the other statistics; a
+ * non-zero count flags a run disturbed by frequency scaling, page faults or
+ * a noisy neighbor, for which the median is the figure to trust.
+ */
+class SampleStatistics {
+public:
+    /**
+     * Computes the statistics of a set of measurements.
+     *
+     * \param samples
+     *      Measurements of the metric, in any order
+     */
+    explicit SampleStatistics(const std::vector<double> &samples);
+
+    /**
+     * Returns the number of measurements
+     */
+    int getCount() const {
+        return count;
+    }
+
+    double getMin() const {
+        return min;
+    }
+
+    double getMax() const {
+        return max;
+    }
+
+    double getMedian() const {
+        return median;
+    }
+
+    double getMean() const {
+        return mean;
+    }
+
+    /**
+     * Returns the sample standard deviation (0 for fewer than 2 samples)
+     */
+    double getStddev() const {
+        return stddev;
+    }
+
+    /**
+     * Returns the half-width of the 95% confidence interval of the mean
+     * (0 for fewer than 2 samples)
+     */
+    double getConfidence95() const {
+        return confidence95;
+    }
+
+    /**
+     * Returns the number of measurements outside of Tukey's fences
+     */
+    int getNumOutliers() const {
+        return numOutliers;
+    }
+
+private:
+    static double getQuantile(const std::vector<double> &sorted,
+                              double fraction);
+    static double getStudentT95(int degreesOfFreedom);
+
+    int count;
+    double min;
+    double max;
+    double median;
+    double mean;
+    double stddev;
+    double confidence95;
+    int numOutliers;
+};
+
+#endif //COMPRESSION_SAMPLE_STATISTICS_H
@@ -0,0 +1,698 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "Logger.h"
+#include "SimdPacker.h"
+
+/**
+ * Packs a run of int/long arguments one at a time with BufferUtils::pack();
+ * this is the fallback for CPUs without the vector extensions and handles
+ * the arguments left over after the vector kernels' last full group.
+ *
+ * \param[in/out] writePos
+ *      Buffer to pack the arguments into (pointer will be incremented)
+ * \param args
+ *      Arguments to pack
+ * \param numArgs
+ *      Number of arguments to pack
+ */
+template<typename T>
+static inline void
+packScalar(unsigned char **writePos, const T *args, int numArgs)
+{
+    int i = 0;
+    while (i < numArgs) {
+        auto twoNibbles = reinterpret_cast<BufferUtils::TwoNibbles*>(
+                                                                *writePos);
+        **writePos = 0;  // Don't leave junk in an unused nibble
+        *writePos += sizeof(BufferUtils::TwoNibbles);
+
+        twoNibbles->first = BufferUtils::pack((char**)writePos, args[i]);
+        if (++i >= numArgs) break;
+
+        twoNibbles->second = BufferUtils::pack((char**)writePos, args[i]);
+        ++i;
+    }
+}
+
+/**
+ * Reverses packScalar() with BufferUtils::unpack().
+ *
+ * \param[in/out] readPos
+ *      Buffer to unpack the arguments from (pointer will be incremented)
+ * \param endOfInput
+ *      End of the buffer readPos points into
+ * \param[out] args
+ *      Array to store the unpacked arguments in
+ * \param numArgs
+ *      Number of arguments to unpack
+ *
+ * \return
+ *      false if the arguments are cut short by endOfInput
+ */
+template<typename T>
+static inline bool
+unpackScalar(const char **readPos, const char *endOfInput, T *args,
+             int numArgs)
+{
+    using namespace LoggerInternals;
+
+    int i = 0;
+    while (i < numArgs) {
+        if (*readPos >= endOfInput)
+            return false;
+
+        auto twoNibbles = reinterpret_cast<
+                                const BufferUtils::TwoNibbles*>(*readPos);
+        int length = getPackedLength(twoNibbles->first);
+        if (i + 1 < numArgs)
+            length += getPackedLength(twoNibbles->second);
+        if (endOfInput - *readPos - 1 < length)
+            return false;
+        *readPos += sizeof(BufferUtils::TwoNibbles);
+
+        args[i] = BufferUtils::unpack<T>(readPos, twoNibbles->first);
+        if (++i >= numArgs) break;
+
+        args[i] = BufferUtils::unpack<T>(readPos, twoNibbles->second);
+        ++i;
+    }
+
+    return true;
+}
+
+#if defined(__x86_64__)
+
+/**
+ * Byte shuffle masks that gather the significant bytes of a group of values
+ * to the front of each 8 (ints) or 16 (longs) byte output half. Bytes not
+ * needed are zeroed via a 0x80 mask byte.
+ */
+struct ShuffleTables {
+    // Indexed by the 4 (length - 1)'s of 4 ints, 2 bits each. The low half
+    // gathers ints 0 and 1, the high half ints 2 and 3.
+    alignas(16) uint8_t ints[256][16];
+
+    // Indexed by the 2 (length - 1)'s of 2 longs, 3 bits each.
+    alignas(16) uint8_t longs[64][16];
+
+    // Inverses of ints and longs for a pair of values; i.e. they expand the
+    // packed bytes of the pair back into two int (in the low half) or two
+    // long lanes. Indexed by the pair's (length - 1)'s, 2 bits each for
+    // ints and 3 bits each for longs.
+    alignas(16) uint8_t expandInts[16][16];
+    alignas(16) uint8_t expandLongs[64][16];
+
+    // Byte length of the value described by a pack() nibble, or 0 if the
+    // nibble is one the kernels don't handle.
+    uint8_t nibbleLength[16];
+
+    ShuffleTables()
+    {
+        memset(ints, 0x80, sizeof(ints));
+        for (int key = 0; key < 256; ++key) {
+            for (int half = 0; half < 2; ++half) {
+                int pos = 8*half;
+                for (int i = 2*half; i < 2*half + 2; ++i) {
+                    int length = ((key >> (2*i)) & 0x3) + 1;
+                    for (int byte = 0; byte < length; ++byte)
+                        ints[key][pos++] = 4*i + byte;
+                }
+            }
+        }
+
+        memset(longs, 0x80, sizeof(longs));
+        for (int key = 0; key < 64; ++key) {
+            int pos = 0;
+            for (int i = 0; i < 2; ++i) {
+                int length = ((key >> (3*i)) & 0x7) + 1;
+                for (int byte = 0; byte < length; ++byte)
+                    longs[key][pos++] = 8*i + byte;
+            }
+        }
+
+        memset(expandInts, 0x80, sizeof(expandInts));
+        for (int key = 0; key < 16; ++key) {
+            int pos = 0;
+            for (int i = 0; i < 2; ++i) {
+                int length = ((key >> (2*i)) & 0x3) + 1;
+                for (int byte = 0; byte < length; ++byte)
+                    expandInts[key][4*i + byte] = pos++;
+            }
+        }
+
+        memset(expandLongs, 0x80, sizeof(expandLongs));
+        for (int key = 0; key < 64; ++key) {
+            int pos = 0;
+            for (int i = 0; i < 2; ++i) {
+                int length = ((key >> (3*i)) & 0x7) + 1;
+                for (int byte = 0; byte < length; ++byte)
+                    expandLongs[key][8*i + byte] = pos++;
+            }
+        }
+
+        // Nibbles 9-15 are small negative values of (nibble - 8) bytes;
+        // 0 denotes a 16 byte value, which ints and longs never use.
+        for (int nibble = 0; nibble < 16; ++nibble)
+            nibbleLength[nibble] = (nibble <= 8) ? nibble : nibble - 8;
+    }
+};
+
+static const ShuffleTables shuffleTables;
+
+/**
+ * Stores a group of 4 packed ints as two TwoNibbles + bytes pairs.
+ *
+ * \param writePos
+ *      Buffer to output the group to
+ * \param info
+ *      The 4 nibbles in bytes 0-3 and the 4 byte lengths in bytes 4-7
+ * \param packed
+ *      Significant bytes of ints 0 and 1 in the low half and of ints 2 and 3
+ *      in the high half (as shuffled by ShuffleTables::ints)
+ *
+ * \return
+ *      Position right after the group
+ */
+__attribute__((target("sse4.1")))
+static inline unsigned char *
+storeIntGroup(unsigned char *writePos, uint64_t info, __m128i packed)
+{
+    writePos[0] = (info & 0x0f) | ((info >> 4) & 0xf0);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(writePos + 1), packed);
+    writePos += 1 + ((info >> 32) & 0xff) + ((info >> 40) & 0xff);
+
+    writePos[0] = ((info >> 16) & 0x0f) | ((info >> 20) & 0xf0);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(writePos + 1),
+                     _mm_unpackhi_epi64(packed, packed));
+    writePos += 1 + ((info >> 48) & 0xff) + ((info >> 56) & 0xff);
+
+    return writePos;
+}
+
+/**
+ * Returns the ShuffleTables::ints index for a group's info (see
+ * storeIntGroup())
+ */
+static inline uint32_t
+getIntShuffleKey(uint64_t info)
+{
+    uint32_t lengths = static_cast<uint32_t>(info >> 32) - 0x01010101;
+    return (lengths & 0x03) | ((lengths >> 6) & 0x0c) |
+           ((lengths >> 12) & 0x30) | ((lengths >> 18) & 0xc0);
+}
+
+/**
+ * Packs 4 ints with SSE4.1.
+ *
+ * \param writePos
+ *      Buffer to output the packed ints to
+ * \param args
+ *      Ints to pack
+ *
+ * \return
+ *      Position right after the packed ints
+ */
+__attribute__((target("sse4.1")))
+static inline unsigned char *
+packIntGroupSse41(unsigned char *writePos, const int *args)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(args));
+
+    // Small negative values are packed as their magnitude with nibble + 8
+    __m128i isNegative = _mm_and_si128(
+                            _mm_cmpgt_epi32(zero, value),
+                            _mm_cmpgt_epi32(value, _mm_set1_epi32(-(1 << 24))));
+    __m128i packValue = _mm_sub_epi32(_mm_xor_si128(value, isNegative),
+                                      isNegative);
+
+    // length = 4 - (value <= 0xffffff) - (value <= 0xffff) - (value <= 0xff)
+    __m128i length = _mm_set1_epi32(4);
+    for (int limit : {0xff, 0xffff, 0xffffff}) {
+        __m128i fits = _mm_cmpeq_epi32(
+                _mm_min_epu32(packValue, _mm_set1_epi32(limit)), packValue);
+        length = _mm_add_epi32(length, fits);
+    }
+
+    __m128i nibble = _mm_add_epi32(length,
+                            _mm_and_si128(isNegative, _mm_set1_epi32(8)));
+    __m128i info = _mm_packus_epi16(_mm_packus_epi32(nibble, length), zero);
+    uint64_t groupInfo = _mm_cvtsi128_si64(info);
+
+    __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(
+                        shuffleTables.ints[getIntShuffleKey(groupInfo)]));
+    return storeIntGroup(writePos, groupInfo,
+                         _mm_shuffle_epi8(packValue, mask));
+}
+
+/**
+ * SSE4.1 version of SimdPacker::packInts()
+ */
+__attribute__((target("sse4.1")))
+static void
+packIntsSse41(unsigned char **writePosIn, const int *args, int numArgs)
+{
+    unsigned char *writePos = *writePosIn;
+
+    int i = 0;
+    for (; i + 4 <= numArgs; i += 4)
+        writePos = packIntGroupSse41(writePos, args + i);
+
+    packScalar(&writePos, args + i, numArgs - i);
+    *writePosIn = writePos;
+}
+
+/**
+ * AVX2 version of SimdPacker::packInts(); identical to packIntsSse41() but
+ * processes 8 ints at a time (as two groups of 4 in the two 128-bit lanes).
+ */
+__attribute__((target("avx2")))
+static void
+packIntsAvx2(unsigned char **writePosIn, const int *args, int numArgs)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    unsigned char *writePos = *writePosIn;
+
+    int i = 0;
+    for (; i + 8 <= numArgs; i += 8) {
+        __m256i value = _mm256_loadu_si256(
+                                reinterpret_cast<const __m256i*>(args + i));
+
+        __m256i isNegative = _mm256_and_si256(
+                        _mm256_cmpgt_epi32(zero, value),
+                        _mm256_cmpgt_epi32(value,
+                                           _mm256_set1_epi32(-(1 << 24))));
+        __m256i packValue = _mm256_sub_epi32(
+                        _mm256_xor_si256(value, isNegative), isNegative);
+
+        __m256i length = _mm256_set1_epi32(4);
+        for (int limit : {0xff, 0xffff, 0xffffff}) {
+            __m256i fits = _mm256_cmpeq_epi32(
+                    _mm256_min_epu32(packValue, _mm256_set1_epi32(limit)),
+                    packValue);
+            length = _mm256_add_epi32(length, fits);
+        }
+
+        __m256i nibble = _mm256_add_epi32(length,
+                        _mm256_and_si256(isNegative, _mm256_set1_epi32(8)));
+        __m256i info = _mm256_packus_epi16(
+                        _mm256_packus_epi32(nibble, length), zero);
+        uint64_t lowInfo = _mm256_extract_epi64(info, 0);
+        uint64_t highInfo = _mm256_extract_epi64(info, 2);
+
+        __m256i mask = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_load_si128(
+                        reinterpret_cast<const __m128i*>(
+                            shuffleTables.ints[getIntShuffleKey(lowInfo)]))),
+                _mm_load_si128(reinterpret_cast<const __m128i*>(
+                            shuffleTables.ints[getIntShuffleKey(highInfo)])),
+                1);
+        __m256i packed = _mm256_shuffle_epi8(packValue, mask);
+
+        writePos = storeIntGroup(writePos, lowInfo,
+                                 _mm256_castsi256_si128(packed));
+        writePos = storeIntGroup(writePos, highInfo,
+                                 _mm256_extracti128_si256(packed, 1));
+    }
+
+    if (i + 4 <= numArgs) {
+        writePos = packIntGroupSse41(writePos, args + i);
+        i += 4;
+    }
+
+    packScalar(&writePos, args + i, numArgs - i);
+    *writePosIn = writePos;
+}
+
+/**
+ * SSE4.1 version of SimdPacker::packLongs(). There are no unsigned 64-bit
+ * vector compares before AVX-512, so the byte lengths are computed from the
+ * leading zero count of each value instead and only the gathering of the
+ * significant bytes is vectorized.
+ */
+__attribute__((target("sse4.1")))
+static void
+packLongsSse41(unsigned char **writePosIn, const long *args, int numArgs)
+{
+    unsigned char *writePos = *writePosIn;
+
+    int i = 0;
+    for (; i + 2 <= numArgs; i += 2) {
+        uint64_t packValue[2];
+        int length[2];
+        int nibble[2];
+
+        for (int j = 0; j < 2; ++j) {
+            long value = args[i + j];
+
+            // Small negative values are packed as their magnitude
+            uint64_t isNegative = -static_cast<uint64_t>(
+                                    value < 0 && value > -(1L << 56));
+            packValue[j] = (value ^ isNegative) - isNegative;
+            length[j] = (64 - __builtin_clzll(packValue[j] | 1) + 7)/8;
+            nibble[j] = length[j] + (isNegative & 8);
+        }
+
+        __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(
+                shuffleTables.longs[(length[0] - 1) | (length[1] - 1) << 3]));
+        __m128i packed = _mm_shuffle_epi8(
+                _mm_set_epi64x(packValue[1], packValue[0]), mask);
+
+        writePos[0] = nibble[0] | (nibble[1] << 4);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(writePos + 1), packed);
+        writePos += 1 + length[0] + length[1];
+    }
+
+    packScalar(&writePos, args + i, numArgs - i);
+    *writePosIn = writePos;
+}
+
+/**
+ * Expands the two ints described by the TwoNibbles byte at readPos.
+ *
+ * \param[in/out] readPos
+ *      TwoNibbles byte followed by the packed ints; must have at least 17
+ *      readable bytes. Incremented past the pair on success.
+ * \param[out] pair
+ *      The two ints in the low half
+ *
+ * \return
+ *      false if the pair uses an encoding the kernel doesn't handle
+ */
+__attribute__((target("sse4.1")))
+static inline bool
+unpackIntPairSse41(const char **readPos, __m128i *pair)
+{
+    uint8_t control = static_cast<uint8_t>(**readPos);
+    int first = control & 0x0f;
+    int second = control >> 4;
+    int firstLength = shuffleTables.nibbleLength[first];
+    int secondLength = shuffleTables.nibbleLength[second];
+
+    if (firstLength == 0 || firstLength > 4 ||
+            secondLength == 0 || secondLength > 4)
+        return false;
+
+    __m128i packed = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(*readPos + 1));
+    __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(
+            shuffleTables.expandInts[(firstLength - 1) |
+                                     (secondLength - 1) << 2]));
+    __m128i value = _mm_shuffle_epi8(packed, mask);
+
+    // Nibbles above 8 denote negated values
+    __m128i negate = _mm_set_epi32(0, 0, -(second > 8), -(first > 8));
+    *pair = _mm_sub_epi32(_mm_xor_si128(value, negate), negate);
+    *readPos += 1 + firstLength + secondLength;
+    return true;
+}
+
+/**
+ * SSE4.1 version of SimdPacker::unpackInts(); expands 4 ints (two
+ * TwoNibbles pairs) per iteration for as long as it is safe to load 16 bytes
+ * past each TwoNibbles byte.
+ *
+ * \return
+ *      Number of arguments unpacked (always a multiple of 2)
+ */
+__attribute__((target("sse4.1")))
+static int
+unpackIntsSse41(const char **readPosIn, const char *endOfInput, int *args,
+                int numArgs)
+{
+    const char *readPos = *readPosIn;
+    __m128i low, high;
+
+    int i = 0;
+    while (i + 2 <= numArgs && endOfInput - readPos >= 17) {
+        const char *pairPos = readPos;
+        if (!unpackIntPairSse41(&pairPos, &low))
+            break;
+
+        if (i + 4 <= numArgs && endOfInput - pairPos >= 17 &&
+                unpackIntPairSse41(&pairPos, &high)) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(args + i),
+                             _mm_unpacklo_epi64(low, high));
+            i += 4;
+        } else {
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(args + i), low);
+            i += 2;
+        }
+
+        readPos = pairPos;
+    }
+
+    *readPosIn = readPos;
+    return i;
+}
+
+/**
+ * SSE4.1 version of SimdPacker::unpackLongs(); expands 2 longs per
+ * iteration.
+ *
+ * \return
+ *      Number of arguments unpacked (always a multiple of 2)
+ */
+__attribute__((target("sse4.1")))
+static int
+unpackLongsSse41(const char **readPosIn, const char *endOfInput, long *args,
+                 int numArgs)
+{
+    const char *readPos = *readPosIn;
+
+    int i = 0;
+    for (; i + 2 <= numArgs && endOfInput - readPos >= 17; i += 2) {
+        uint8_t control = static_cast<uint8_t>(*readPos);
+        int first = control & 0x0f;
+        int second = control >> 4;
+        int firstLength = shuffleTables.nibbleLength[first];
+        int secondLength = shuffleTables.nibbleLength[second];
+
+        if (firstLength == 0 || secondLength == 0)
+            break;
+
+        __m128i packed = _mm_loadu_si128(
+                            reinterpret_cast<const __m128i*>(readPos + 1));
+        __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(
+                shuffleTables.expandLongs[(firstLength - 1) |
+                                          (secondLength - 1) << 3]));
+        __m128i value = _mm_shuffle_epi8(packed, mask);
+
+        __m128i negate = _mm_set_epi64x(-(second > 8), -(first > 8));
+        value = _mm_sub_epi64(_mm_xor_si128(value, negate), negate);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(args + i), value);
+
+        readPos += 1 + firstLength + secondLength;
+    }
+
+    *readPosIn = readPos;
+    return i;
+}
+
+/**
+ * Picks the best kernels the CPU supports
+ */
+static SimdPacker::Isa
+detectIsa()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SimdPacker::ISA_AVX2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return SimdPacker::ISA_SSE41;
+    return SimdPacker::ISA_SCALAR;
+}
+
+#else
+
+static SimdPacker::Isa
+detectIsa()
+{
+    return SimdPacker::ISA_SCALAR;
+}
+
+#endif // __x86_64__
+
+static const SimdPacker::Isa isa = detectIsa();
+
+// See Header
+SimdPacker::Isa
+SimdPacker::getIsa()
+{
+    return isa;
+}
+
+// See Header
+const char *
+SimdPacker::getIsaName(Isa isa)
+{
+    switch (isa) {
+        case ISA_AVX2:
+            return "avx2";
+        case ISA_SSE41:
+            return "sse4.1";
+        default:
+            return "scalar";
+    }
+}
+
+// See Header
+void
+SimdPacker::packInts(unsigned char **writePos, const int *args, int numArgs)
+{
+    switch (isa) {
+#if defined(__x86_64__)
+        case ISA_AVX2:
+            packIntsAvx2(writePos, args, numArgs);
+            break;
+        case ISA_SSE41:
+            packIntsSse41(writePos, args, numArgs);
+            break;
+#endif
+        default:
+            packScalar(writePos, args, numArgs);
+            break;
+    }
+}
+
+// See Header
+void
+SimdPacker::packLongs(unsigned char **writePos, const long *args,
+                      int numArgs)
+{
+    switch (isa) {
+#if defined(__x86_64__)
+        case ISA_AVX2:
+        case ISA_SSE41:
+            packLongsSse41(writePos, args, numArgs);
+            break;
+#endif
+        default:
+            packScalar(writePos, args, numArgs);
+            break;
+    }
+}
+
+// See Header
+bool
+SimdPacker::unpackInts(const char **readPos, const char *endOfInput,
+                       int *args, int numArgs)
+{
+    int i = 0;
+#if defined(__x86_64__)
+    if (isa != ISA_SCALAR)
+        i = unpackIntsSse41(readPos, endOfInput, args, numArgs);
+#endif
+    return unpackScalar(readPos, endOfInput, args + i, numArgs - i);
+}
+
+// See Header
+bool
+SimdPacker::unpackLongs(const char **readPos, const char *endOfInput,
+                        long *args, int numArgs)
+{
+    int i = 0;
+#if defined(__x86_64__)
+    if (isa != ISA_SCALAR)
+        i = unpackLongsSse41(readPos, endOfInput, args, numArgs);
+#endif
+    return unpackScalar(readPos, endOfInput, args + i, numArgs - i);
+}
+
+// See Header
+int
+SimdPacker::uncompress(unsigned char *outputBuffer,
+                       long unsigned int *outputSize,
+                       const unsigned char *inputBuffer,
+                       long unsigned int inputSize)
+{
+    NanoLogDecoder decoder((const char*)inputBuffer, inputSize, true);
+    DecodedEntry entry;
+    unsigned char *writePos = outputBuffer;
+    unsigned char *endOfBuffer = outputBuffer + *outputSize;
+
+    while (decoder.next(&entry)) {
+        if (!binaryLogDecodedEntry(&writePos, endOfBuffer, &entry))
+            return Z_BUF_ERROR;
+    }
+
+    if (decoder.isMalformed())
+        return Z_DATA_ERROR;
+
+    *outputSize = writePos - outputBuffer;
+    return Z_OK;
+}
+
+// See Header
+int
+SimdPacker::compress(unsigned char *outputBuffer,
+                     long unsigned int *outputSize,
+                     const unsigned char *inputBuffer,
+                     long unsigned int inputSize)
+{
+    using namespace NanoLogInternal;
+    using namespace LoggerInternals;
+
+    const unsigned char *readPos = inputBuffer;
+    const unsigned char *endOfInput = inputBuffer + inputSize;
+    unsigned char *writePos = outputBuffer;
+    unsigned char *endOfOutput = outputBuffer + *outputSize;
+
+    uint64_t lastTime = 0;
+    while (readPos < endOfInput) {
+        auto entry = reinterpret_cast<const Log::UncompressedEntry*>(readPos);
+        if (entry->entrySize < sizeof(Log::UncompressedEntry) ||
+                entry->entrySize > endOfInput - readPos)
+            return Z_DATA_ERROR;
+
+        if (NanoLogCompressBound(entry->entrySize) >
+                static_cast<uint64_t>(endOfOutput - writePos)) {
+            fprintf(stderr, "Ran out of space in the output buffer\r\n");
+            return Z_BUF_ERROR;
+        }
+
+        Log::compressLogHeader(entry, (char**)&writePos, lastTime);
+        lastTime = entry->timestamp;
+
+        uint32_t fmtId = entry->fmtId;
+        int argSize = entry->entrySize - sizeof(Log::UncompressedEntry);
+
+        if (fmtId >= LOG_ID_FORMAT_START) {
+            // Mixed argument types leave no runs of ints/longs to vectorize
+            compressFormatArgs(entry, &writePos);
+        } else if (fmtId < LOG_ID_INT_ARGS_START ||
+                   fmtId >= LOG_ID_DBL_ARGS_START) {
+            // Strings and doubles are incompressible, so just copy them.
+            memcpy(writePos, entry->argData, argSize);
+            writePos += argSize;
+        } else if (fmtId < LOG_ID_LONG_ARGS_START) {
+            packInts(&writePos, reinterpret_cast<const int*>(entry->argData),
+                     fmtId - LOG_ID_INT_ARGS_START);
+        } else {
+            packLongs(&writePos,
+                      reinterpret_cast<const long*>(entry->argData),
+                      fmtId - LOG_ID_LONG_ARGS_START);
+        }
+
+        readPos += entry->entrySize;
+    }
+
+    *outputSize = writePos - outputBuffer;
+    return Z_OK;
+}
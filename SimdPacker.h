@@ -0,0 +1,170 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef COMPRESSION_SIMD_PACKER_H
+#define COMPRESSION_SIMD_PACKER_H
+
+#include <cstdint>
+
+/**
+ * SimdPacker packs runs of int/long arguments into exactly the same
+ * TwoNibbles + packed bytes format as BufferUtils::pack() (and thus
+ * NanoLogCompress2()), but several values at a time with vector instructions
+ * in the style of stream-vbyte: the byte lengths of a group of values are
+ * computed at once with vector compares, and their significant bytes are
+ * gathered into place with a single byte shuffle whose mask comes from a
+ * lookup table indexed by the lengths.
+ *
+ * Unpacking reverses this: the packed bytes of each TwoNibbles pair are
+ * expanded back into int/long lanes with a byte shuffle whose mask is looked
+ * up by the pair's nibbles.
+ *
+ * The kernels are selected at runtime based on the CPU: AVX2 packs 8 ints at
+ * a time, SSE4.1 packs 4 (and does all the unpacking), and CPUs with neither
+ * fall back to the scalar BufferUtils::pack()/unpack() loops. The packing
+ * kernels may write up to 16 bytes past the end of the packed output, which
+ * NanoLogCompressBound() leaves room for.
+ */
+class SimdPacker {
+public:
+    /**
+     * Instruction set extensions the kernels can be built on
+     */
+    enum Isa {
+        ISA_SCALAR,
+        ISA_SSE41,
+        ISA_AVX2
+    };
+
+    /**
+     * Returns the instruction set the kernels selected at runtime use
+     */
+    static Isa getIsa();
+
+    /**
+     * Returns a printable name for an instruction set
+     */
+    static const char *getIsaName(Isa isa);
+
+    /**
+     * Packs a run of int arguments two nibbles at a time.
+     *
+     * \param[in/out] writePos
+     *      Buffer to pack the arguments into (pointer will be incremented)
+     * \param args
+     *      Arguments to pack
+     * \param numArgs
+     *      Number of arguments to pack
+     */
+    static void packInts(unsigned char **writePos, const int *args,
+                         int numArgs);
+
+    /**
+     * Packs a run of long arguments two nibbles at a time.
+     *
+     * \param[in/out] writePos
+     *      Buffer to pack the arguments into (pointer will be incremented)
+     * \param args
+     *      Arguments to pack
+     * \param numArgs
+     *      Number of arguments to pack
+     */
+    static void packLongs(unsigned char **writePos, const long *args,
+                          int numArgs);
+
+    /**
+     * Reverses packInts(). The int bytes of two arguments at a time are
+     * expanded into place with a byte shuffle whose mask is looked up by the
+     * two nibbles of their TwoNibbles byte.
+     *
+     * \param[in/out] readPos
+     *      Buffer to unpack the arguments from (pointer will be incremented)
+     * \param endOfInput
+     *      End of the buffer readPos points into; the kernels never read
+     *      past it
+     * \param[out] args
+     *      Array to store the unpacked arguments in
+     * \param numArgs
+     *      Number of arguments to unpack
+     *
+     * \return
+     *      false if the arguments are cut short by endOfInput
+     */
+    static bool unpackInts(const char **readPos, const char *endOfInput,
+                           int *args, int numArgs);
+
+    /**
+     * Reverses packLongs(); see unpackInts().
+     *
+     * \param[in/out] readPos
+     *      Buffer to unpack the arguments from (pointer will be incremented)
+     * \param endOfInput
+     *      End of the buffer readPos points into
+     * \param[out] args
+     *      Array to store the unpacked arguments in
+     * \param numArgs
+     *      Number of arguments to unpack
+     *
+     * \return
+     *      false if the arguments are cut short by endOfInput
+     */
+    static bool unpackLongs(const char **readPos, const char *endOfInput,
+                            long *args, int numArgs);
+
+    /**
+     * Same as NanoLogUncompress(), except that the int/long arguments are
+     * unpacked with the vector kernels.
+     *
+     * \param outputBuffer
+     *      Output buffer to store the reconstructed log entries
+     * \param outputSize
+     *      Initially set by the caller to indicate the size of outputBuffer.
+     *      On return, it is set to the number of bytes actually used.
+     * \param inputBuffer
+     *      Buffer containing the output of compress() or NanoLogCompress2()
+     * \param inputSize
+     *      Number of valid bytes in the buffer
+     *
+     * \return
+     *      Same as libz's return status's
+     */
+    static int uncompress(unsigned char *outputBuffer,
+                          long unsigned int *outputSize,
+                          const unsigned char *inputBuffer,
+                          long unsigned int inputSize);
+
+    /**
+     * Same as NanoLogCompress2() (and produces identical output), except
+     * that the int/long arguments are packed with the vector kernels.
+     *
+     * \param outputBuffer
+     *      Output buffer to store the compacted log entries
+     * \param outputSize
+     *      Initially set by the caller to indicate the size of outputBuffer.
+     *      On return, it is set to the number of bytes actually used.
+     * \param inputBuffer
+     *      Buffer that contains data generated by binaryLogWithArgs()
+     * \param inputSize
+     *      Number of bytes to consume in the inputBuffer
+     *
+     * \return
+     *      Same as libz's return status's
+     */
+    static int compress(unsigned char *outputBuffer,
+                        long unsigned int *outputSize,
+                        const unsigned char *inputBuffer,
+                        long unsigned int inputSize);
+};
+
+#endif //COMPRESSION_SIMD_PACKER_H
@@ -0,0 +1,98 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <algorithm>
+
+#include "FormatRegistry.h"
+#include "SpecializedLogger.h"
+
+namespace Specialized {
+
+using namespace LoggerInternals;
+
+// Number of fmtIds binaryLogWithArgs() can assign
+static const uint32_t NUM_FMT_IDS = LOG_ID_DBL_ARGS_START + LOG_ID_MAX_ARGS;
+
+/**
+ * Flat table of the compressEntry() instantiations, indexed by fmtId.
+ */
+struct FmtIdTable {
+    CompressEntryFn compressFns[NUM_FMT_IDS];
+
+    FmtIdTable() {
+        copy(Internals::DispatchTable<const char*>::get(), LOG_ID_STRING_START);
+        copy(Internals::DispatchTable<int>::get(), LOG_ID_INT_ARGS_START);
+        copy(Internals::DispatchTable<long>::get(), LOG_ID_LONG_ARGS_START);
+        copy(Internals::DispatchTable<double>::get(), LOG_ID_DBL_ARGS_START);
+    }
+
+    template<typename T>
+    void copy(const Internals::DispatchTable<T> &table, uint32_t logIdStart) {
+        std::copy(table.compressFns, table.compressFns + LOG_ID_MAX_ARGS,
+                  compressFns + logIdStart);
+    }
+
+    static const FmtIdTable &get() {
+        static const FmtIdTable table;
+        return table;
+    }
+};
+
+// See Header
+CompressEntryFn
+getCompressEntryFn(uint32_t fmtId)
+{
+    return FmtIdTable::get().compressFns[fmtId];
+}
+
+// See Header
+int
+compress(unsigned char *outputBuffer, long unsigned int *outputSize,
+         const unsigned char *inputBuffer, long unsigned int inputSize)
+{
+    using namespace NanoLogInternal;
+
+    const CompressEntryFn *compressFns = FmtIdTable::get().compressFns;
+    const unsigned char *readPos = inputBuffer;
+    unsigned char *writePos = outputBuffer;
+
+    uint64_t lastTime = 0;
+    while (readPos < inputBuffer + inputSize) {
+        auto metadata =reinterpret_cast<const Log::UncompressedEntry*>(readPos);
+        if (metadata->fmtId < NUM_FMT_IDS) {
+            compressFns[metadata->fmtId](metadata, &writePos, lastTime);
+        } else if (FormatRegistry::getSignature(metadata->fmtId) != nullptr) {
+            // Signatures registered at runtime have no instantiation
+            Log::compressLogHeader(metadata, (char**)&writePos, lastTime);
+            compressFormatArgs(metadata, &writePos);
+        } else {
+            fprintf(stderr, "Log entry with unknown fmtId %u\r\n",
+                    metadata->fmtId);
+            return Z_DATA_ERROR;
+        }
+
+        lastTime = metadata->timestamp;
+        readPos += metadata->entrySize;
+    }
+
+    if (outputBuffer + *outputSize < writePos) {
+        fprintf(stderr, "Ran out of space in the output buffer\r\n");
+        return Z_BUF_ERROR;
+    }
+
+    *outputSize = writePos - outputBuffer;
+    return Z_OK;
+}
+
+}; // namespace Specialized
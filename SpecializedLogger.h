@@ -0,0 +1,419 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef COMPRESSION_SPECIALIZED_LOGGER_H
+#define COMPRESSION_SPECIALIZED_LOGGER_H
+
+/**
+ * This header removes the two approximations Logger.h makes of NanoLog's
+ * generated code: instead of for-loops over numArgs, recordLog() and
+ * compressEntry() are variadic templates that get instantiated once per
+ * argument signature, so the compiler unrolls the argument pushes and packs
+ * just like the per log statement functions NanoLog generates. The log
+ * entries and compacted output are identical to binaryLogWithArgs()'s and
+ * NanoLogCompress2()'s, so the two can be compared head to head.
+ *
+ * Since the benchmark only uses homogeneous argument arrays, there are only
+ * 4*LOG_ID_MAX_ARGS signatures (one per fmtId), and dispatch tables indexed
+ * by fmtId/numArgs take the place of NanoLog's per log statement function
+ * pointers.
+ */
+
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+#include "Logger.h"
+
+namespace Specialized {
+
+// This namespace is meant to be internally used by the functions below.
+namespace Internals {
+
+// C++11 stand-in for std::integer_sequence; IndexSequence<0, ..., N-1> is
+// used to expand an argument array into a parameter pack.
+template<int... Indexes>
+struct IndexSequence {};
+
+template<int N, int... Indexes>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, Indexes...> {};
+
+template<int... Indexes>
+struct MakeIndexSequence<0, Indexes...> {
+    typedef IndexSequence<Indexes...> type;
+};
+
+// Maps every index of an IndexSequence to the same type T
+template<typename T, int Index>
+struct Repeat {
+    typedef T type;
+};
+
+// True if all the types in the pack are the same
+template<typename... Args>
+struct AllSame : std::true_type {};
+
+template<typename T, typename U, typename... Rest>
+struct AllSame<T, U, Rest...>
+    : std::integral_constant<bool, std::is_same<T, U>::value &&
+                                   AllSame<U, Rest...>::value> {};
+
+// First type of a parameter pack; const char* (whose fmtIds start at
+// LOG_ID_STRING_START) for an empty one
+template<typename... Args>
+struct FirstType {
+    typedef const char *type;
+};
+
+template<typename T, typename... Rest>
+struct FirstType<T, Rest...> {
+    typedef T type;
+};
+
+/**
+ * Returns the fmtId binaryLogWithArgs() would assign to a log entry with
+ * the argument signature Args logged from an array of type T. Like the
+ * array's type for binaryLogWithArgs(), T alone picks the fmtId range of
+ * an entry without arguments.
+ */
+template<typename T, typename... Args>
+constexpr uint32_t
+getFmtId()
+{
+    return LoggerInternals::getLogIdStart(T()) + sizeof...(Args);
+}
+
+/**
+ * Returns the total byte size of the arguments in a log entry.
+ */
+static inline uint32_t
+getArgSizes()
+{
+    return 0;
+}
+
+template<typename T, typename... Rest>
+static inline uint32_t
+getArgSizes(T arg, Rest... rest)
+{
+    return LoggerInternals::getArgSize(1, &arg) + getArgSizes(rest...);
+}
+
+/**
+ * Stores the arguments of a log entry into a buffer.
+ */
+static inline void
+pushArgs(unsigned char ** /* buffer */)
+{
+}
+
+template<typename T, typename... Rest>
+static inline void
+pushArgs(unsigned char **buffer, T arg, Rest... rest)
+{
+    LoggerInternals::pushArgs(buffer, 1, &arg);
+    pushArgs(buffer, rest...);
+}
+
+/**
+ * Compacts one int/long argument. The Nibble-th packable argument of the
+ * entry shares a TwoNibbles byte with its neighbor, exactly like the loops
+ * in NanoLogCompress2() pair them up.
+ */
+template<int Nibble, typename T>
+static inline typename std::enable_if<std::is_integral<T>::value>::type
+compressArg(const unsigned char **readPos, unsigned char **writePos,
+            BufferUtils::TwoNibbles **twoNibbles)
+{
+    T arg = *reinterpret_cast<const T*>(*readPos);
+    *readPos += sizeof(T);
+
+    if (Nibble % 2 == 0) {
+        *twoNibbles = reinterpret_cast<BufferUtils::TwoNibbles*>(*writePos);
+        **writePos = 0;  // Don't leave junk in an unused nibble
+        *writePos += sizeof(BufferUtils::TwoNibbles);
+        (*twoNibbles)->first = BufferUtils::pack((char**)writePos, arg);
+    } else {
+        (*twoNibbles)->second = BufferUtils::pack((char**)writePos, arg);
+    }
+}
+
+/**
+ * Copies one double argument, which is incompressible.
+ */
+template<int Nibble, typename T>
+static inline typename std::enable_if<std::is_floating_point<T>::value>::type
+compressArg(const unsigned char **readPos, unsigned char **writePos,
+            BufferUtils::TwoNibbles ** /* twoNibbles */)
+{
+    memcpy(*writePos, *readPos, sizeof(T));
+    *readPos += sizeof(T);
+    *writePos += sizeof(T);
+}
+
+/**
+ * Copies one string argument (including its null terminator), which is
+ * incompressible.
+ */
+template<int Nibble, typename T>
+static inline typename std::enable_if<std::is_pointer<T>::value>::type
+compressArg(const unsigned char **readPos, unsigned char **writePos,
+            BufferUtils::TwoNibbles ** /* twoNibbles */)
+{
+    size_t length = strlen(reinterpret_cast<const char*>(*readPos)) + 1;
+    memcpy(*writePos, *readPos, length);
+    *readPos += length;
+    *writePos += length;
+}
+
+/**
+ * Compacts the arguments of a log entry one at a time, in order.
+ */
+template<int Nibble>
+static inline void
+compressArgs(const unsigned char ** /* readPos */,
+             unsigned char ** /* writePos */,
+             BufferUtils::TwoNibbles ** /* twoNibbles */)
+{
+}
+
+template<int Nibble, typename T, typename... Rest>
+static inline void
+compressArgs(const unsigned char **readPos, unsigned char **writePos,
+             BufferUtils::TwoNibbles **twoNibbles)
+{
+    compressArg<Nibble, T>(readPos, writePos, twoNibbles);
+    compressArgs<Nibble + std::is_integral<T>::value, Rest...>(
+            readPos, writePos, twoNibbles);
+}
+
+/**
+ * recordLog() for arguments of type T, which stamps the entry with the
+ * fmtId binaryLogWithArgs() would give it logged from an array of type T;
+ * unlike recordLog(), that includes entries without arguments.
+ */
+template<typename T, typename... Args>
+static inline bool
+recordTypedLog(unsigned char **bufferIn, unsigned char *endOfBuffer,
+               Args... args)
+{
+    using namespace NanoLogInternal::Log;
+
+    static_assert(AllSame<T, Args...>::value,
+                  "fmtIds can only encode homogeneous argument signatures");
+    static_assert(sizeof...(Args) < LoggerInternals::LOG_ID_MAX_ARGS,
+                  "Too many arguments for a fmtId to encode");
+
+    uint64_t remainingSpace = endOfBuffer - *bufferIn;
+    uint32_t bytesRequired = sizeof(UncompressedEntry) +
+                                getArgSizes(args...);
+    if (remainingSpace < bytesRequired)
+        return false;
+
+    auto meta = reinterpret_cast<UncompressedEntry*>(*bufferIn);
+    *bufferIn += sizeof(UncompressedEntry);
+
+    meta->timestamp = PerfUtils::Cycles::rdtsc();
+    meta->fmtId = getFmtId<T, Args...>();
+    meta->entrySize = bytesRequired;
+
+    pushArgs(bufferIn, args...);
+    return true;
+}
+}; // namespace Internals
+
+/**
+ * Same as binaryLogWithArgs(), but with the arguments passed individually
+ * so that the size computation and the argument pushes are unrolled for the
+ * argument signature at compile time.
+ *
+ * \param[in/out] bufferIn
+ *      Pointer to a buffer to write the log entry into (pointer will be
+ *      incremented after write)
+ * \param endOfBuffer
+ *      A pointer to the end of the bufferIn
+ * \param args
+ *      Arguments (all int, long, double or const char*) to place into the
+ *      log entry
+ * \return
+ *      true if successful, false means disregard data.
+ */
+template<typename... Args>
+static inline bool
+recordLog(unsigned char **bufferIn, unsigned char *endOfBuffer, Args... args)
+{
+    return Internals::recordTypedLog<
+            typename Internals::FirstType<Args...>::type>(bufferIn,
+                                                           endOfBuffer,
+                                                           args...);
+}
+
+/**
+ * Same as the NanoLogCompress2() compaction of a single log entry, but
+ * unrolled for the argument signature of the entry at compile time.
+ *
+ * \param metadata
+ *      Log entry to compact; must have been logged with the signature Args
+ * \param[in/out] writePosIn
+ *      Buffer to output the compacted entry to (pointer will be incremented
+ *      after the write). Must have at least
+ *      NanoLogCompressBound(metadata->entrySize) bytes of space.
+ * \param lastTime
+ *      Timestamp of the previous log entry compacted
+ */
+template<typename... Args>
+static void
+compressEntry(const NanoLogInternal::Log::UncompressedEntry *metadata,
+              unsigned char **writePosIn, uint64_t lastTime)
+{
+    using namespace NanoLogInternal;
+
+    unsigned char *writePos = *writePosIn;
+    const unsigned char *readPos =
+            reinterpret_cast<const unsigned char*>(metadata->argData);
+    BufferUtils::TwoNibbles *twoNibbles = nullptr;
+
+    Log::compressLogHeader(metadata, (char**)&writePos, lastTime);
+    Internals::compressArgs<0, Args...>(&readPos, &writePos, &twoNibbles);
+
+    *writePosIn = writePos;
+}
+
+// Signature of the compressEntry() instantiations
+typedef void (*CompressEntryFn)(const NanoLogInternal::Log::UncompressedEntry*,
+                                unsigned char**, uint64_t);
+
+/**
+ * Returns the compressEntry() instantiation for the argument signature
+ * encoded by a fmtId.
+ *
+ * \param fmtId
+ *      fmtId of the log entry to compact (less than LOG_ID_DBL_ARGS_START +
+ *      LOG_ID_MAX_ARGS)
+ */
+CompressEntryFn getCompressEntryFn(uint32_t fmtId);
+
+// Signature of the recordLog() instantiations that log numArgs arguments of
+// type T from an array
+template<typename T>
+using RecordFn = bool (*)(unsigned char **, unsigned char *, T *);
+
+namespace Internals {
+/**
+ * Expands an argument array into a recordLog() call for sizeof...(Indexes)
+ * arguments.
+ */
+template<typename T, int... Indexes>
+static bool
+recordLogFromArray(unsigned char **bufferIn, unsigned char *endOfBuffer,
+                   T *args)
+{
+    return recordTypedLog<T>(bufferIn, endOfBuffer, args[Indexes]...);
+}
+
+template<typename T, int... Indexes>
+static constexpr RecordFn<T>
+getRecordFn(IndexSequence<Indexes...>)
+{
+    return &recordLogFromArray<T, Indexes...>;
+}
+
+template<typename T, int... Indexes>
+static constexpr CompressEntryFn
+getCompressEntryFn(IndexSequence<Indexes...>)
+{
+    return &compressEntry<typename Repeat<T, Indexes>::type...>;
+}
+
+/**
+ * Fills in table[0..NumArgs] with the RecordFn and CompressEntryFn
+ * instantiations for 0 to NumArgs arguments of type T.
+ */
+template<typename T, int NumArgs>
+struct TableBuilder {
+    static void fill(RecordFn<T> *recordFns, CompressEntryFn *compressFns) {
+        typedef typename MakeIndexSequence<NumArgs>::type Indexes;
+        recordFns[NumArgs] = getRecordFn<T>(Indexes());
+        compressFns[NumArgs] = getCompressEntryFn<T>(Indexes());
+        TableBuilder<T, NumArgs - 1>::fill(recordFns, compressFns);
+    }
+};
+
+template<typename T>
+struct TableBuilder<T, -1> {
+    static void fill(RecordFn<T> * /* recordFns */,
+                     CompressEntryFn * /* compressFns */) {}
+};
+
+/**
+ * Dispatch tables of the instantiations for arguments of type T, indexed
+ * by the number of arguments.
+ */
+template<typename T>
+struct DispatchTable {
+    RecordFn<T> recordFns[LoggerInternals::LOG_ID_MAX_ARGS];
+    CompressEntryFn compressFns[LoggerInternals::LOG_ID_MAX_ARGS];
+
+    DispatchTable() {
+        TableBuilder<T, LoggerInternals::LOG_ID_MAX_ARGS - 1>::fill(
+                recordFns, compressFns);
+    }
+
+    static const DispatchTable &get() {
+        static const DispatchTable table;
+        return table;
+    }
+};
+}; // namespace Internals
+
+/**
+ * Returns the recordLog() instantiation that logs numArgs arguments of
+ * type T from an array; i.e. the unrolled equivalent of
+ * binaryLogWithArgs(bufferIn, endOfBuffer, numArgs, args).
+ *
+ * \param numArgs
+ *      Number of arguments the log entries have (less than LOG_ID_MAX_ARGS)
+ */
+template<typename T>
+static inline RecordFn<T>
+getRecordFn(int numArgs)
+{
+    return Internals::DispatchTable<T>::get().recordFns[numArgs];
+}
+
+/**
+ * Same as NanoLogCompress2() (and produces identical output), except that
+ * every log entry is compacted by the compressEntry() instantiation its
+ * fmtId dispatches to.
+ *
+ * \param outputBuffer
+ *      Output buffer to store the compacted log entries
+ * \param outputSize
+ *      Initially set by the caller to indicate the size of outputBuffer.
+ *      On return, it is set to the number of bytes actually used.
+ * \param inputBuffer
+ *      Buffer that contains data generated by binaryLogWithArgs() or
+ *      recordLog()
+ * \param inputSize
+ *      Number of bytes to consume in the inputBuffer
+ *
+ * \return
+ *      Same as libz's return status's
+ */
+int compress(unsigned char *outputBuffer, long unsigned int *outputSize,
+             const unsigned char *inputBuffer, long unsigned int inputSize);
+
+}; // namespace Specialized
+
+#endif //COMPRESSION_SPECIALIZED_LOGGER_H
@@ -0,0 +1,243 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <cstdlib>
+#include <strings.h>
+
+#include "StagingBuffer.h"
+
+StagingBuffer::StagingBuffer(uint64_t bufferSize)
+    : storage(nullptr)
+    , bufferSize(bufferSize)
+    , producerPos(nullptr)
+    , endOfRecordedSpace(nullptr)
+    , minFreeSpace(bufferSize)
+    , numTimesProducerBlocked(0)
+    , cacheLineSpacer()
+    , consumerPos(nullptr)
+{
+    storage = static_cast<char*>(malloc(bufferSize));
+    if (storage == nullptr) {
+        fprintf(stderr, "Could not allocate a %lu byte staging buffer\r\n",
+                bufferSize);
+        exit(1);
+    }
+
+    // Pre-fault the memory so the producer isn't charged for it
+    bzero(storage, bufferSize);
+
+    producerPos = storage;
+    endOfRecordedSpace = storage + bufferSize;
+    consumerPos = storage;
+}
+
+StagingBuffer::~StagingBuffer()
+{
+    free(storage);
+}
+
+/**
+ * Slow path of reserveProducerSpace(); re-reads the consumer's position to
+ * recompute the space available, wrapping around to the start of the buffer
+ * when there isn't enough space left at the end.
+ *
+ * \param nbytes
+ *      Number of contiguous bytes needed
+ */
+char *
+StagingBuffer::reserveSpaceInternal(uint64_t nbytes)
+{
+    const char *endOfBuffer = storage + bufferSize;
+    char *writePos = producerPos.load(std::memory_order_relaxed);
+
+    // Strictly greater so that the producer never catches up to the
+    // consumer, since equal positions mean the buffer is empty.
+    while (minFreeSpace <= nbytes) {
+        char *cachedConsumerPos = consumerPos.load(std::memory_order_acquire);
+
+        if (cachedConsumerPos <= writePos) {
+            minFreeSpace = endOfBuffer - writePos;
+            if (minFreeSpace > nbytes)
+                break;
+
+            // Not enough space at the end; wrap around unless the consumer
+            // is still at the start of the buffer.
+            if (cachedConsumerPos != storage) {
+                endOfRecordedSpace.store(writePos, std::memory_order_release);
+                writePos = storage;
+                producerPos.store(writePos, std::memory_order_release);
+                minFreeSpace = cachedConsumerPos - storage;
+            }
+        } else {
+            minFreeSpace = cachedConsumerPos - writePos;
+        }
+
+        if (minFreeSpace <= nbytes) {
+            ++numTimesProducerBlocked;
+            std::this_thread::yield();
+        }
+    }
+
+    return writePos;
+}
+
+// See Header
+char *
+StagingBuffer::peek(uint64_t *bytesAvailable)
+{
+    char *cachedProducerPos = producerPos.load(std::memory_order_acquire);
+    char *readPos = consumerPos.load(std::memory_order_relaxed);
+
+    if (cachedProducerPos < readPos) {
+        // The producer has wrapped around; drain up to the end of the
+        // recorded space first, then follow it to the start.
+        char *end = endOfRecordedSpace.load(std::memory_order_acquire);
+        *bytesAvailable = end - readPos;
+        if (*bytesAvailable > 0)
+            return readPos;
+
+        readPos = storage;
+        consumerPos.store(readPos, std::memory_order_release);
+    }
+
+    *bytesAvailable = cachedProducerPos - readPos;
+    return readPos;
+}
+
+BackgroundCompressor::BackgroundCompressor(uint64_t stagingBufferSize,
+                                           uint64_t outputBufferSize)
+    : stagingBufferSize(stagingBufferSize)
+    , mutex()
+    , stagingBuffers()
+    , outputBuffer(nullptr)
+    , outputBufferSize(outputBufferSize)
+    , outputPos(nullptr)
+    , bytesConsumed(0)
+    , bytesOutput(0)
+    , shutdown(false)
+    , consumer()
+{
+    if (NanoLogCompressBound(stagingBufferSize) > outputBufferSize) {
+        fprintf(stderr, "The output buffer must be able to hold a full "
+                        "staging buffer's worth of compacted data\r\n");
+        exit(1);
+    }
+
+    outputBuffer = static_cast<unsigned char*>(malloc(outputBufferSize));
+    if (outputBuffer == nullptr) {
+        fprintf(stderr, "Could not allocate a %lu byte output buffer\r\n",
+                outputBufferSize);
+        exit(1);
+    }
+
+    bzero(outputBuffer, outputBufferSize);
+    outputPos = outputBuffer;
+
+    consumer = std::thread(&BackgroundCompressor::consumerMain, this);
+}
+
+BackgroundCompressor::~BackgroundCompressor()
+{
+    shutdown = true;
+    consumer.join();
+    free(outputBuffer);
+}
+
+// See Header
+StagingBuffer *
+BackgroundCompressor::registerProducer()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stagingBuffers.emplace_back(new StagingBuffer(stagingBufferSize));
+    return stagingBuffers.back().get();
+}
+
+// See Header
+void
+BackgroundCompressor::sync()
+{
+    while (true) {
+        bool allEmpty = true;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto &stagingBuffer : stagingBuffers)
+                allEmpty &= stagingBuffer->isEmpty();
+        }
+
+        if (allEmpty)
+            return;
+
+        std::this_thread::yield();
+    }
+}
+
+// See Header
+uint64_t
+BackgroundCompressor::getNumTimesProducerBlocked()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint64_t numTimesBlocked = 0;
+    for (auto &stagingBuffer : stagingBuffers)
+        numTimesBlocked += stagingBuffer->getNumTimesProducerBlocked();
+
+    return numTimesBlocked;
+}
+
+/**
+ * Main loop of the background thread; polls the StagingBuffers round robin
+ * and compacts whatever log entries it finds until shutdown is set.
+ */
+void
+BackgroundCompressor::consumerMain()
+{
+    while (!shutdown) {
+        bool foundWork = false;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        for (auto &stagingBuffer : stagingBuffers) {
+            uint64_t bytesAvailable;
+            char *readPos = stagingBuffer->peek(&bytesAvailable);
+            if (bytesAvailable == 0)
+                continue;
+
+            // Model writing out a full output buffer by starting over
+            uint64_t spaceLeft = outputBuffer + outputBufferSize - outputPos;
+            if (NanoLogCompressBound(bytesAvailable) > spaceLeft)
+                outputPos = outputBuffer;
+
+            long unsigned int outputSize = outputBuffer + outputBufferSize
+                                                                - outputPos;
+            int retVal = NanoLogCompress2(outputPos, &outputSize,
+                                          reinterpret_cast<unsigned char*>(
+                                                  readPos),
+                                          bytesAvailable, 0);
+            if (retVal != Z_OK) {
+                fprintf(stderr, "Background compaction failed with error "
+                                "code %d\r\n", retVal);
+            }
+
+            outputPos += outputSize;
+            stagingBuffer->consume(bytesAvailable);
+            bytesConsumed.fetch_add(bytesAvailable, std::memory_order_release);
+            bytesOutput.fetch_add(outputSize, std::memory_order_release);
+            foundWork = true;
+        }
+        lock.unlock();
+
+        if (!foundWork)
+            std::this_thread::yield();
+    }
+}
@@ -0,0 +1,244 @@
+/* Copyright (c) 2018 Stanford University
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR(S) DISCLAIM ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL AUTHORS BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef COMPRESSION_STAGING_BUFFER_H
+#define COMPRESSION_STAGING_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Logger.h"
+
+/**
+ * StagingBuffer is a lock-free single producer/single consumer ring buffer
+ * that one logging thread records binaryLogWithArgs() log entries into and
+ * the BackgroundCompressor drains, modeled after the per-thread staging
+ * buffers of the NanoLog runtime.
+ *
+ * Log entries are never split across the end of the buffer; when an entry
+ * doesn't fit in the space left at the end, the producer marks the end of
+ * the recorded space and wraps around to the start. Thus every region
+ * returned by peek() consists of whole log entries.
+ */
+class StagingBuffer {
+public:
+    explicit StagingBuffer(uint64_t bufferSize);
+    ~StagingBuffer();
+
+    /**
+     * Records a log entry with a variable number of int/long/double/string
+     * arguments, waiting for the consumer to free up space if the buffer is
+     * full. Must only be invoked by the producer thread.
+     *
+     * \param numArgs
+     *      Number of arguments to place in the log entry
+     * \param args
+     *      An array of arguments to place into the log entry
+     */
+    template<typename ArgumentType>
+    void log(int numArgs, ArgumentType *args) {
+        using namespace NanoLogInternal::Log;
+
+        uint32_t bytesRequired = sizeof(UncompressedEntry) +
+                LoggerInternals::getArgSize(numArgs, args);
+        unsigned char *writePos = reinterpret_cast<unsigned char*>(
+                                        reserveProducerSpace(bytesRequired));
+
+        binaryLogWithArgs(&writePos, writePos + bytesRequired, numArgs, args);
+        finishReservation(bytesRequired);
+    }
+
+    /**
+     * Returns a pointer to at least nbytes of contiguous space in the buffer,
+     * waiting for the consumer if necessary. Must only be invoked by the
+     * producer thread and followed by finishReservation().
+     *
+     * \param nbytes
+     *      Number of bytes to reserve; must be less than the buffer size
+     */
+    char *reserveProducerSpace(uint64_t nbytes) {
+        if (nbytes < minFreeSpace)
+            return producerPos.load(std::memory_order_relaxed);
+
+        return reserveSpaceInternal(nbytes);
+    }
+
+    /**
+     * Makes the nbytes written to the space returned by
+     * reserveProducerSpace() visible to the consumer.
+     *
+     * \param nbytes
+     *      Number of bytes written; at most the number reserved
+     */
+    void finishReservation(uint64_t nbytes) {
+        minFreeSpace -= nbytes;
+        producerPos.store(producerPos.load(std::memory_order_relaxed) + nbytes,
+                          std::memory_order_release);
+    }
+
+    /**
+     * Returns the next contiguous region of recorded log entries. Must only
+     * be invoked by the consumer thread.
+     *
+     * \param[out] bytesAvailable
+     *      Number of bytes in the region (0 means the buffer is empty)
+     */
+    char *peek(uint64_t *bytesAvailable);
+
+    /**
+     * Releases the first nbytes of the region returned by peek() back to
+     * the producer. Must only be invoked by the consumer thread.
+     *
+     * \param nbytes
+     *      Number of bytes consumed
+     */
+    void consume(uint64_t nbytes) {
+        consumerPos.store(consumerPos.load(std::memory_order_relaxed) + nbytes,
+                          std::memory_order_release);
+    }
+
+    /**
+     * Returns true if the consumer has consumed everything recorded so far.
+     */
+    bool isEmpty() const {
+        return consumerPos.load(std::memory_order_acquire) ==
+                producerPos.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Returns the number of times the producer had to wait for the consumer
+     * to free up space.
+     */
+    uint64_t getNumTimesProducerBlocked() const {
+        return numTimesProducerBlocked;
+    }
+
+private:
+    char *reserveSpaceInternal(uint64_t nbytes);
+
+    // Start and size of the ring buffer's memory
+    char *storage;
+    const uint64_t bufferSize;
+
+    // Position the producer will record the next log entry at
+    std::atomic<char*> producerPos;
+
+    // End of the recorded space when the producer wraps around to the start
+    // of the buffer before the consumer does
+    std::atomic<char*> endOfRecordedSpace;
+
+    // Lower bound on the contiguous space available to the producer at
+    // producerPos; allows reserveProducerSpace() to skip reading consumerPos
+    // most of the time. Only accessed by the producer.
+    uint64_t minFreeSpace;
+
+    // Number of times the producer had to wait for space
+    uint64_t numTimesProducerBlocked;
+
+    // Keeps consumerPos off the cache lines of the producer's fields so that
+    // the producer's updates don't invalidate it.
+    char cacheLineSpacer[2*64];
+
+    // Position the consumer will read the next log entry from
+    std::atomic<char*> consumerPos;
+};
+
+/**
+ * BackgroundCompressor hands out a StagingBuffer per producer thread and runs
+ * a background thread that polls all the StagingBuffers and compacts the log
+ * entries it drains with NanoLogCompress2(), like the NanoLog runtime's
+ * background thread does before writing the log out.
+ *
+ * The compacted output is written into an in-memory output buffer that is
+ * reused from the start whenever it fills up, as if it had been written out.
+ */
+class BackgroundCompressor {
+public:
+    /**
+     * \param stagingBufferSize
+     *      Size of each producer's StagingBuffer
+     * \param outputBufferSize
+     *      Size of the buffer the compacted log entries are output to
+     */
+    BackgroundCompressor(uint64_t stagingBufferSize,
+                         uint64_t outputBufferSize);
+    ~BackgroundCompressor();
+
+    /**
+     * Allocates a new StagingBuffer for a producer thread. The buffer remains
+     * owned by the BackgroundCompressor.
+     */
+    StagingBuffer *registerProducer();
+
+    /**
+     * Waits until the background thread has drained and compacted
+     * everything the producers have recorded so far.
+     */
+    void sync();
+
+    /**
+     * Returns the number of bytes of log entries compacted so far
+     */
+    uint64_t getBytesConsumed() const {
+        return bytesConsumed.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Returns the number of bytes of compacted output produced so far
+     */
+    uint64_t getBytesOutput() const {
+        return bytesOutput.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Returns the number of times the producers had to wait for space in
+     * their StagingBuffers.
+     */
+    uint64_t getNumTimesProducerBlocked();
+
+private:
+    void consumerMain();
+
+    // Size of the StagingBuffers handed out
+    const uint64_t stagingBufferSize;
+
+    // Protects stagingBuffers
+    std::mutex mutex;
+
+    // StagingBuffers of all the producers registered so far
+    std::vector<std::unique_ptr<StagingBuffer>> stagingBuffers;
+
+    // Buffer the compacted log entries are output to
+    unsigned char *outputBuffer;
+    const uint64_t outputBufferSize;
+
+    // Position to output the next compacted region at
+    unsigned char *outputPos;
+
+    // Statistics on the work the background thread has done
+    std::atomic<uint64_t> bytesConsumed;
+    std::atomic<uint64_t> bytesOutput;
+
+    // Set by the destructor to stop the background thread
+    std::atomic<bool> shutdown;
+
+    // Thread running consumerMain()
+    std::thread consumer;
+};
+
+#endif //COMPRESSION_STAGING_BUFFER_H
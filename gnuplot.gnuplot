@@ -10,18 +10,18 @@ set mxtics 11
 
 set key autotitle columnhead
 
-FILES = system("ls -1 details/*.txt")
+FILES = system("ls -1 details/*.txt | grep -v absolute")
 do for [ file in FILES]{
     set output file.".svg"
-    plot file u 1:2 w l lc 'red', \
-           '' u 1:3 w l, \
-           '' u 1:4 w l, \
-           '' u 1:5 w l, \
-           '' u 1:6 w l, \
-           '' u 1:7 w l, \
-           '' u 1:8 w l, \
-           '' u 1:9 w l, \
-           '' u 1:10 w l, \
+    plot file u 1:2 w steps lc 'red', \
+           '' u 1:3 w steps, \
+           '' u 1:4 w steps, \
+           '' u 1:5 w steps, \
+           '' u 1:6 w steps, \
+           '' u 1:7 w steps, \
+           '' u 1:8 w steps, \
+           '' u 1:9 w steps, \
+           '' u 1:10 w steps, \
 }
 
 set logscale y
@@ -14,20 +14,49 @@
  */
 
 
+#include <fnmatch.h>
+#include <getopt.h>
 #include <math.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <unistd.h>
 
+#include <cctype>
+#include <cerrno>
 #include <cstring>
 #include <cstdint>
 #include <cstdio>
+#include <ctime>
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <thread>
 
 #include "./snappy/snappy.h"
 #include "zlib.h"
 
+#include "BandwidthModel.h"
+#include "BuildInfo.h"
 #include "CommonWords.h"
+#include "ColumnarCompressor.h"
+#include "DirectSink.h"
+#include "FormatRegistry.h"
+#include "HistoryCompressor.h"
+#include "JsonObject.h"
+#include "LatencyHistogram.h"
 #include "Logger.h"
+#include "ParallelCompressor.h"
+#include "PerfCounters.h"
+#include "RAMCloudLogs.h"
+#include "SampleStatistics.h"
+#include "SimdPacker.h"
+#include "SpecializedLogger.h"
+#include "StagingBuffer.h"
 
 using namespace PerfUtils;
 
@@ -45,9 +74,21 @@ public:
         , counter(0)
     {}
 
-    void reset(uint64_t seed=0) {
+    /**
+     * Resets the state of the generator
+     *
+     * \param seed
+     *      Seed of the PRNG
+     * \param counterStart
+     *      Value the incrementing generators start from
+     */
+    void reset(uint64_t seed, uint64_t counterStart) {
         generator.seed(seed);
-        counter = seed;
+        counter = counterStart;
+    }
+
+    void reset(uint64_t seed=0) {
+        reset(seed, seed);
     }
 
     template <typename T>
@@ -121,14 +162,21 @@ public:
  * skewed toward the lower integers; e.g. 0 will be the most popular, 1 the next
  * most popular, etc.
  *
- * This class implements the core algorithm from YCSB's ZipfianGenerator; it, in
- * turn, uses the algorithm from "Quickly Generating Billion-Record Synthetic
- * Databases", Jim Gray et al, SIGMOD 1994.
+ * For n up to ALIAS_TABLE_MAX_N, numbers are drawn from a Walker/Vose alias
+ * table of the exact distribution, which costs one PRNG draw and no floating
+ * point math per number. The tables are cached and shared by all generators
+ * with the same parameters, so copying a generator or constructing another
+ * one like it is cheap.
+ *
+ * Larger n fall back to the core algorithm from YCSB's ZipfianGenerator; it,
+ * in turn, uses the algorithm from "Quickly Generating Billion-Record
+ * Synthetic Databases", Jim Gray et al, SIGMOD 1994.
  */
 class ZipfianGenerator {
 public:
     /**
-     * Construct a generator.  This may be expensive if n is large.
+     * Construct a generator. The first generator constructed with a given n
+     * and theta may be expensive if n is large.
      *
      * \param n
      *      The generator will output random numbers between 0 and n-1.
@@ -144,6 +192,8 @@ public:
             , zetan(zeta(n, theta))
             , eta((1 - pow(2.0 / static_cast<double>(n), 1 - theta)) /
                   (1 - zeta(2, theta) / zetan))
+            , secondRankBound(1 + std::pow(0.5, theta))
+            , aliasTable(getAliasTable(n, theta))
     {}
 
     /**
@@ -151,13 +201,22 @@ public:
      */
     uint64_t nextNumber()
     {
-        std::uniform_int_distribution<uint64_t> distribution(0, ~0UL);
-        double u = static_cast<double>(distribution(randomness)) /
-                   static_cast<double>(~0UL);
+        uint64_t random = randomness();
+
+        if (aliasTable) {
+            // The upper half of the draw picks the slot, the lower half
+            // decides between the slot and its alias
+            uint64_t slot = ((random >> 32)*n) >> 32;
+            if ((random & 0xffffffffUL) < aliasTable->threshold[slot])
+                return slot;
+            return aliasTable->alias[slot];
+        }
+
+        double u = static_cast<double>(random) / static_cast<double>(~0UL);
         double uz = u * zetan;
         if (uz < 1)
             return 0;
-        if (uz < 1 + std::pow(0.5, theta))
+        if (uz < secondRankBound)
             return 1;
         return 0 + static_cast<uint64_t>(static_cast<double>(n) *
                                          std::pow(eta*u - eta + 1.0, alpha));
@@ -167,28 +226,235 @@ public:
         randomness.seed(seed);
     }
 
+    // Largest n that numbers are drawn from an alias table for
+    static const uint64_t ALIAS_TABLE_MAX_N = 1UL << 20;
+
 private:
-    std::default_random_engine randomness;
+    /**
+     * Alias table of the zipfian distribution over [0, n); number i is
+     * returned when the lower 32 bits of the draw that picked slot i are less
+     * than threshold[i], and alias[i] is returned otherwise.
+     */
+    struct AliasTable {
+        std::vector<uint64_t> threshold;
+        std::vector<uint32_t> alias;
+    };
+
+    // Produces 64 random bits per call, which is all a number needs
+    std::mt19937_64 randomness;
 
     const uint64_t n;       // Range of numbers to be generated.
     const double theta;     // Parameter of the zipfian distribution.
     const double alpha;     // Special intermediate result used for generation.
     const double zetan;     // Special intermediate result used for generation.
     const double eta;       // Special intermediate result used for generation.
+    const double secondRankBound;   // 1 + 0.5^theta; uz below it returns 1.
+
+    // Alias table to draw from, or nullptr if n exceeds ALIAS_TABLE_MAX_N
+    std::shared_ptr<const AliasTable> aliasTable;
+
+    // Number of terms zeta() sums exactly before approximating the rest
+    static const uint64_t ZETA_EXACT_TERMS = 1UL << 20;
 
     /**
      * Returns the nth harmonic number with parameter theta; e.g. H_{n,theta}.
+     * The first ZETA_EXACT_TERMS terms are summed and the remainder is
+     * approximated with the Euler-Maclaurin formula, which is accurate to
+     * well within a double's precision at that point. Results are cached.
      */
     static double zeta(uint64_t n, double theta)
     {
+        static std::mutex mutex;
+        static std::map<std::pair<uint64_t, double>, double> cache;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(std::make_pair(n, theta));
+        if (it != cache.end())
+            return it->second;
+
+        uint64_t exactTerms = std::min(n, ZETA_EXACT_TERMS);
         double sum = 0;
-        for (uint64_t i = 0; i < n; i++) {
+        for (uint64_t i = 0; i < exactTerms; i++) {
             sum = sum + 1.0/(std::pow(i+1, theta));
         }
+
+        if (n > exactTerms) {
+            // Sum of x^-theta over (m, n] ~ integral + endpoint corrections
+            double m = static_cast<double>(exactTerms);
+            double x = static_cast<double>(n);
+            sum += (std::pow(x, 1 - theta) - std::pow(m, 1 - theta))/(1 - theta)
+                    + (std::pow(x, -theta) - std::pow(m, -theta))/2
+                    - theta*(std::pow(x, -theta - 1) -
+                             std::pow(m, -theta - 1))/12;
+        }
+
+        cache[std::make_pair(n, theta)] = sum;
         return sum;
     }
+
+    /**
+     * Returns the cached alias table for a zipfian distribution, building
+     * it on first use, or nullptr if n is too large to build one for.
+     */
+    static std::shared_ptr<const AliasTable>
+    getAliasTable(uint64_t n, double theta)
+    {
+        if (n > ALIAS_TABLE_MAX_N)
+            return nullptr;
+
+        static std::mutex mutex;
+        static std::map<std::pair<uint64_t, double>,
+                        std::shared_ptr<const AliasTable>> cache;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::shared_ptr<const AliasTable> &cached =
+                                        cache[std::make_pair(n, theta)];
+        if (cached)
+            return cached;
+
+        // Vose's algorithm on the probabilities scaled by n, so that every
+        // slot holds 1.0 worth of probability
+        std::shared_ptr<AliasTable> table = std::make_shared<AliasTable>();
+        std::vector<double> scaled(n);
+        std::vector<uint32_t> small, large;
+        double zetan = zeta(n, theta);
+        for (uint64_t i = 0; i < n; ++i) {
+            scaled[i] = n/(std::pow(i+1, theta)*zetan);
+            if (scaled[i] < 1.0)
+                small.push_back(i);
+            else
+                large.push_back(i);
+        }
+
+        table->threshold.assign(n, 1UL << 32);
+        table->alias.resize(n);
+        for (uint64_t i = 0; i < n; ++i)
+            table->alias[i] = i;
+
+        while (!small.empty() && !large.empty()) {
+            uint32_t borrower = small.back();
+            uint32_t lender = large.back();
+            small.pop_back();
+
+            table->threshold[borrower] = static_cast<uint64_t>(
+                                        scaled[borrower]*(1UL << 32));
+            table->alias[borrower] = lender;
+            scaled[lender] -= 1.0 - scaled[borrower];
+            if (scaled[lender] < 1.0) {
+                large.pop_back();
+                small.push_back(lender);
+            }
+        }
+
+        // Slots left over only differ from 1.0 by rounding error and keep
+        // their full threshold
+        cached = table;
+        return cached;
+    }
 };
 
+/**
+ * Decompression function with the same API as zlib's uncompress(). The
+ * functions below wrap the remaining algorithms' decompression routines in
+ * this API so that BenchmarkRunner can chain and time them uniformly.
+ */
+typedef std::function<int(unsigned char *dest, unsigned long *destLen,
+                          const unsigned char *source,
+                          unsigned long sourceLen)> UncompressFn;
+
+/**
+ * Compression function with the same API as zlib's compress(); used by the
+ * batch size sweep to run the algorithms uniformly.
+ */
+typedef std::function<int(unsigned char *dest, unsigned long *destLen,
+                          const unsigned char *source,
+                          unsigned long sourceLen)> CompressFn;
+
+static int
+memcpyUncompress(unsigned char *dest, unsigned long *destLen,
+                 const unsigned char *source, unsigned long sourceLen)
+{
+    if (*destLen < sourceLen)
+        return Z_BUF_ERROR;
+
+    memcpy(dest, source, sourceLen);
+    *destLen = sourceLen;
+    return Z_OK;
+}
+
+static int
+snappyUncompress(unsigned char *dest, unsigned long *destLen,
+                 const unsigned char *source, unsigned long sourceLen)
+{
+    size_t uncompressedLength;
+    if (!snappy::GetUncompressedLength((const char*)source, sourceLen,
+                                       &uncompressedLength))
+        return Z_DATA_ERROR;
+
+    if (*destLen < uncompressedLength)
+        return Z_BUF_ERROR;
+
+    if (!snappy::RawUncompress((const char*)source, sourceLen, (char*)dest))
+        return Z_DATA_ERROR;
+
+    *destLen = uncompressedLength;
+    return Z_OK;
+}
+
+/**
+ * Formats the benchmark results can be printed in
+ */
+enum OutputFormat {
+    // Fixed-width columns for reading
+    FORMAT_TABLE,
+
+    // Comma separated values with a header line
+    FORMAT_CSV,
+
+    // A JSON object per line, whose "type" member tells the run's metadata,
+    // results, latencies, batch sweep points and bandwidth analysis apart
+    FORMAT_JSON
+};
+
+/**
+ * A stream the benchmark results are printed to
+ */
+struct Output {
+    FILE *file;
+    OutputFormat format;
+};
+
+// Streams the BenchmarkRunner prints its results to (set from the command
+// line): stdout, plus optionally a file archiving the results as records
+static std::vector<Output> outputs = {{stdout, FORMAT_TABLE}};
+
+// Bandwidth in MB/s of the device the "Output (s)" metric assumes the
+// compressed logs are written to (the first of --bandwidths)
+static double deviceBandwidth = 250.0;
+
+/**
+ * Returns a field of a CSV record, quoted if it contains a comma, a quote or
+ * a line break (e.g. the algorithm "gzip,6").
+ *
+ * \param value
+ *      Value of the field
+ */
+static std::string
+csvField(const std::string &value)
+{
+    if (value.find_first_of(",\"\r\n") == std::string::npos)
+        return value;
+
+    std::string quoted = "\"";
+    for (char c : value) {
+        if (c == '"')
+            quoted += '"';
+        quoted += c;
+    }
+
+    return quoted + "\"";
+}
+
 /**
  * This class maintains all the data buffers, generates the uncompressed log
  * data given constraints, and benchmarks all the compression algorithms on
@@ -207,12 +473,100 @@ class BenchmarkRunner {
     // Stores output data that's compressed a second time
     unsigned char *doubleCompressedOutputBuffer;
 
+    // Stores the output of the first decompression stage when decompressing
+    // data that was compressed twice (same size as the compressed buffers)
+    unsigned char *intermediateBuffer;
+
+    // Stores the fully decompressed data for round-trip verification (same
+    // size as the rawDataBuffer)
+    unsigned char *decompressedBuffer;
+
     // Stores the sizes of the two buffers above
     unsigned long int rawBufferSize;
     unsigned long int compressedBufferSize;
 
-    // Maintains the state for argument generation
-    ArgumentGenerator argumentGenerator;
+    // Thread pool used to run the multi-threaded NanoLog compression
+    ParallelCompressor parallelCompressor;
+
+    // Maintains the scratch streams for the columnar NanoLog compression
+    ColumnarCompressor columnarCompressor;
+
+    // Durations of the sampled binaryLogWithArgs() and
+    // Specialized::recordLog() invocations made while generating the current
+    // dataset
+    LatencyHistogram latencyHistogram;
+    LatencyHistogram specializedLatencyHistogram;
+
+    // fmtIds of the RAMCloudLogs[] log statements registered by
+    // ramcloudTest(), in the order of their popularity
+    std::vector<uint32_t> ramcloudSites;
+
+    // fmtIds of the log statements registered by formatTest(), by format
+    std::map<std::string, uint32_t> formatIds;
+
+    // Batch sizes to sweep the datasets over (see setBatchSizes()); empty
+    // means each dataset is compressed in one piece
+    std::vector<uint64_t> batchSizes;
+
+    // fnmatch() patterns of the algorithms to run; empty means all of them
+    std::vector<std::string> algorithmPatterns;
+
+    // Numbers of threads to run the multi-threaded NanoLog with
+    std::vector<int> threadCounts;
+
+    // Number of untimed runs of every algorithm on every dataset before the
+    // timed trials, and the number of trials (see setTrials())
+    int warmups;
+    int trials;
+
+    // fnmatch() patterns of the datasets to generate; empty means all
+    std::vector<std::string> datasetPatterns;
+
+    // Print the names of the selected datasets instead of generating them
+    bool listDatasetsOnly;
+
+    // Hardware performance counters of the thread running the benchmarks,
+    // read around every timed compression once enablePerfCounters() opens
+    // them
+    PerfCounters perfCounters;
+
+    // Records the Results of the compressions for the bandwidth analysis
+    // (see setBandwidthModel()); nullptr if there's none
+    BandwidthModel *bandwidthModel;
+
+    // File the main algorithms' output is written to after every dataset
+    // once enableSink() opens it
+    DirectSink sink;
+
+    /**
+     * One GENERATION_REGION_SIZE slice of rawDataBuffer that a dataset is
+     * generated into independently of the others (see generateDataset()).
+     */
+    struct Region {
+        // Position of the region in rawDataBuffer
+        uint64_t index;
+
+        // Seed derived from the index; all of the randomness used to fill
+        // the region must come from it so the dataset is reproducible
+        uint64_t seed;
+
+        // Next free byte in the region and first byte after it
+        unsigned char *writePos;
+        unsigned char *end;
+
+        // Number of log statements generated into the region
+        uint32_t numLogStatements;
+
+        // Number of binaryLogWithArgs() invocations made through recordLog()
+        uint64_t numLogsRecorded;
+
+        // Histograms of the thread generating the region
+        LatencyHistogram *latencyHistogram;
+        LatencyHistogram *specializedLatencyHistogram;
+    };
+
+    // Fills a Region with log entries until it runs out of space
+    typedef std::function<void(Region *region)> RegionFn;
 
 public:
     /**
@@ -238,24 +592,80 @@ public:
         // Number of Cycles::rdtsc() cycles required to perform the compression
         uint64_t compressionCycles;
 
+        // Number of Cycles::rdtsc() cycles required to decompress the output
+        // back into the original data (0 means it wasn't measured)
+        uint64_t decompressionCycles;
+
+        // Compression and decompression times in seconds measured by each of
+        // the trials a Result combines (see combineTrials()); the cycle
+        // counts above are then the medians of these
+        std::vector<double> compressionTrials;
+        std::vector<double> decompressionTrials;
+
+        // Hardware performance counts of the compression (unmeasured unless
+        // the runner's perfCounters are open)
+        PerfCounts counters;
+
         Result(const char *algorithm, const char *dataset,
                 uint64_t inputBytes, uint64_t outputBytes,
-                uint32_t numLogMsgs, uint64_t compressionCycles)
+                uint32_t numLogMsgs, uint64_t compressionCycles,
+                uint64_t decompressionCycles = 0,
+                const PerfCounts &counters = PerfCounts())
                     : algorithm(algorithm)
                     , dataset(dataset)
                     , inputBytes(inputBytes)
                     , outputBytes(outputBytes)
                     , numLogMsgs(numLogMsgs)
                     , compressionCycles(compressionCycles)
+                    , decompressionCycles(decompressionCycles)
+                    , compressionTrials()
+                    , decompressionTrials()
+                    , counters(counters)
         {}
 
 
         static constexpr const char *metricsOutputString =
-            "%-10s%20s%10lu%15lu%15lu%10.4lf%15.6lf%15.6lf%15.6lf%20.3lf"
-                    "%15.3lf%10.3lf%10.2lf\r\n";
+            "%-15s%20s%10lu%15lu%15lu%10.4lf%15.6lf%15.6lf%15.6lf%20.3lf"
+                    "%15.3lf%10.3lf%10.2lf%15.6lf%15.3lf\r\n";
+
+        static constexpr const char *csvOutputString =
+            "%s,%s,%lu,%lu,%lu,%.4lf,%.6lf,%.6lf,%.6lf,%.3lf,%.3lf,%.3lf,"
+                    "%.2lf,%.6lf,%.3lf,%d";
+
+        /**
+         * Prints the header of the table or CSV records print() outputs;
+         * JSON records need none.
+         *
+         * \param output
+         *      Stream to print to
+         * \param withCounters
+         *      True adds the columns of the performance counts to the CSV
+         */
+        static void printHeader(const Output &output, bool withCounters) {
+            FILE *out = output.file;
+            if (output.format == FORMAT_JSON)
+                return;
+
+            if (output.format == FORMAT_CSV) {
+                fprintf(out, "Algorithm,Dataset,NumLogs,Input Bytes,"
+                        "Output Bytes,Ratio,Compute (s),Output (s),Max (s),"
+                        "MB/s Processing,MB/s saved,Mlogs/s,B/msg,Decomp (s),"
+                        "Decomp MB/s,Trials");
+                for (const char *metric : {"Compute", "Decomp"}) {
+                    for (const char *statistic : {"Min", "Mean", "Stddev",
+                                                  "CI95", "Outliers"})
+                        fprintf(out, ",%s %s", metric, statistic);
+                }
+                if (withCounters) {
+                    fprintf(out, ",Cycles,Instructions,IPC,Branch Misses,"
+                            "L1d Read Misses,LLC Misses,dTLB Read Misses");
+                }
+                fprintf(out, "\r\n");
+                return;
+            }
 
-        static void printHeader() {
-            printf("#%-9s%20s%10s%15s%15s%10s%15s%15s%15s%20s%15s%10s%10s\r\n",
+            fprintf(out, "#%-14s%20s%10s%15s%15s%10s%15s%15s%15s%20s%15s%10s"
+                    "%10s%15s%15s\r\n",
                 "Algorithm",
                 "Dataset",
                 "NumLogs",
@@ -268,17 +678,43 @@ public:
                 "MB/s Processing",
                 "MB/s saved",
                 "Mlogs/s",
-                "B/msg");
+                "B/msg",
+                "Decomp (s)",
+                "Decomp MB/s");
         }
 
-        void print() {
+        /**
+         * Prints the Result as a row of the table printHeader() starts, a CSV
+         * record or a JSON record. Results combining several trials are
+         * followed by their statistics, and measured performance counts
+         * follow as well: on lines of their own in the table, or as
+         * additional fields.
+         *
+         * \param output
+         *      Stream to print to
+         * \param withCounters
+         *      True adds the fields of the performance counts to the CSV
+         *      record, left empty if they weren't measured
+         */
+        void print(const Output &output, bool withCounters) {
+            FILE *out = output.file;
             double computeTime = PerfUtils::Cycles::toSeconds(compressionCycles);
-            double outputTime = outputBytes/(250.0*1024*1024);
+            double outputTime = outputBytes/(deviceBandwidth*1024*1024);
+            double decompressTime =
+                            PerfUtils::Cycles::toSeconds(decompressionCycles);
             int64_t bytesSaved = inputBytes - outputBytes;
 
-            printf(metricsOutputString,
-                    algorithm.c_str(),
-                    dataset.c_str(),
+            if (output.format == FORMAT_JSON) {
+                fprintf(out, "%s\n", toJson().str().c_str());
+                return;
+            }
+
+            fprintf(out, (output.format == FORMAT_CSV) ? csvOutputString
+                                                       : metricsOutputString,
+                    (output.format == FORMAT_CSV)
+                            ? csvField(algorithm).c_str() : algorithm.c_str(),
+                    (output.format == FORMAT_CSV)
+                            ? csvField(dataset).c_str() : dataset.c_str(),
                     numLogMsgs,
                     inputBytes,
                     outputBytes,
@@ -289,13 +725,201 @@ public:
                     inputBytes/(1024*1024*computeTime),
                     bytesSaved/(1024*1024*computeTime),
                     numLogMsgs/(1e6*computeTime),
-                    outputBytes/(1.0*numLogMsgs)
-                    );
+                    outputBytes/(1.0*numLogMsgs),
+                    decompressTime,
+                    (decompressionCycles == 0) ? 0.0 :
+                                    inputBytes/(1024*1024*decompressTime),
+                    std::max<int>(1, compressionTrials.size()));
+
+            if (output.format == FORMAT_TABLE) {
+                if (compressionTrials.size() > 1)
+                    printTrials(out, "compute", compressionTrials);
+                if (decompressionTrials.size() > 1 && decompressionCycles > 0)
+                    printTrials(out, "decomp", decompressionTrials);
+                if (counters.isMeasured())
+                    printCounters(out);
+                return;
+            }
+
+            for (const std::vector<double> *times : {&compressionTrials,
+                                                     &decompressionTrials}) {
+                SampleStatistics stats(*times);
+                fprintf(out, ",%.6lf,%.6lf,%.6lf,%.6lf,%d", stats.getMin(),
+                        stats.getMean(), stats.getStddev(),
+                        stats.getConfidence95(), stats.getNumOutliers());
+            }
+
+            for (int i = 0; withCounters && i < PerfCounts::NUM_COUNTERS;
+                    ++i) {
+                PerfCounts::Counter counter =
+                                        static_cast<PerfCounts::Counter>(i);
+                if (counters.isMeasured(counter))
+                    fprintf(out, ",%.0lf", counters.get(counter));
+                else
+                    fprintf(out, ",");
+
+                if (counter == PerfCounts::INSTRUCTIONS) {
+                    if (getIpc() > 0)
+                        fprintf(out, ",%.3lf", getIpc());
+                    else
+                        fprintf(out, ",");
+                }
+            }
+            fprintf(out, "\r\n");
+        }
+
+        /**
+         * Returns the Result as a JSON record with every metric. Times are
+         * in seconds and rates in MB (2^20 bytes) per second; metrics that
+         * weren't measured are null.
+         */
+        JsonObject toJson() const {
+            double computeTime = PerfUtils::Cycles::toSeconds(compressionCycles);
+            double outputTime = outputBytes/(deviceBandwidth*1024*1024);
+            double decompressTime =
+                            PerfUtils::Cycles::toSeconds(decompressionCycles);
+            int64_t bytesSaved = inputBytes - outputBytes;
+
+            JsonObject record;
+            record.addString("type", "result")
+                  .addString("algorithm", algorithm)
+                  .addString("dataset", dataset)
+                  .addInteger("num_logs", numLogMsgs)
+                  .addInteger("input_bytes", inputBytes)
+                  .addInteger("output_bytes", outputBytes)
+                  .addNumber("ratio", (1.0*outputBytes)/inputBytes)
+                  .addNumber("compute_s", computeTime)
+                  .addNumber("output_s", outputTime)
+                  .addNumber("max_s", std::max(computeTime, outputTime))
+                  .addNumber("processing_mbps",
+                             inputBytes/(1024*1024*computeTime))
+                  .addNumber("saved_mbps", bytesSaved/(1024*1024*computeTime))
+                  .addNumber("mlogs_per_s", numLogMsgs/(1e6*computeTime))
+                  .addNumber("bytes_per_msg", outputBytes/(1.0*numLogMsgs));
+
+            if (decompressionCycles == 0) {
+                record.addNull("decomp_s")
+                      .addNull("decomp_mbps");
+            } else {
+                record.addNumber("decomp_s", decompressTime)
+                      .addNumber("decomp_mbps",
+                                 inputBytes/(1024*1024*decompressTime));
+            }
+
+            record.addInteger("trials", std::max<int>(1,
+                                                  compressionTrials.size()));
+            const char *keys[] = {"compute_stats", "decomp_stats"};
+            const std::vector<double> *times[] = {&compressionTrials,
+                                                  &decompressionTrials};
+            for (int i = 0; i < 2; ++i) {
+                SampleStatistics stats(*times[i]);
+                if (stats.getCount() == 0 ||
+                        (i == 1 && decompressionCycles == 0)) {
+                    record.addNull(keys[i]);
+                    continue;
+                }
+
+                record.addObject(keys[i], JsonObject()
+                        .addNumber("min", stats.getMin())
+                        .addNumber("median", stats.getMedian())
+                        .addNumber("mean", stats.getMean())
+                        .addNumber("stddev", stats.getStddev())
+                        .addNumber("ci95", stats.getConfidence95())
+                        .addInteger("outliers", stats.getNumOutliers()));
+            }
+
+            if (!counters.isMeasured())
+                return record.addNull("counters");
+
+            JsonObject counts;
+            for (int i = 0; i < PerfCounts::NUM_COUNTERS; ++i) {
+                PerfCounts::Counter counter =
+                                        static_cast<PerfCounts::Counter>(i);
+                if (counters.isMeasured(counter))
+                    counts.addNumber(PerfCounts::getName(counter),
+                                     counters.get(counter));
+                else
+                    counts.addNull(PerfCounts::getName(counter));
+            }
+
+            if (getIpc() > 0)
+                counts.addNumber("ipc", getIpc());
+            else
+                counts.addNull("ipc");
+
+            return record.addObject("counters", counts);
+        }
+
+        /**
+         * Returns the instructions retired per core cycle during the
+         * compression, or 0 if they weren't both measured.
+         */
+        double getIpc() const {
+            double cycles = counters.get(PerfCounts::CYCLES);
+            if (!counters.isMeasured(PerfCounts::CYCLES) ||
+                    !counters.isMeasured(PerfCounts::INSTRUCTIONS) ||
+                    cycles == 0)
+                return 0;
+
+            return counters.get(PerfCounts::INSTRUCTIONS)/cycles;
+        }
+
+        /**
+         * Prints a table line with the performance counts of the
+         * compression; counters the CPU doesn't support are printed as "-".
+         *
+         * \param out
+         *      Stream to print to
+         */
+        void printCounters(FILE *out) const {
+            static const int widths[PerfCounts::NUM_COUNTERS] =
+                                                    {11, 11, 10, 10, 10, 9};
+
+            fprintf(out, "# Counters %-15s", algorithm.c_str());
+            for (int i = 0; i < PerfCounts::NUM_COUNTERS; ++i) {
+                PerfCounts::Counter counter =
+                                        static_cast<PerfCounts::Counter>(i);
+                if (counters.isMeasured(counter)) {
+                    fprintf(out, "  %s %*.0lf", PerfCounts::getName(counter),
+                            widths[i], counters.get(counter));
+                } else {
+                    fprintf(out, "  %s %*s", PerfCounts::getName(counter),
+                            widths[i], "-");
+                }
+
+                if (counter == PerfCounts::INSTRUCTIONS)
+                    fprintf(out, "  IPC %5.2lf", getIpc());
+            }
+            fprintf(out, "\r\n");
+        }
+
+        /**
+         * Prints a table line with the statistics of the times the trials
+         * took.
+         *
+         * \param out
+         *      Stream to print to
+         * \param metric
+         *      Name of the times
+         * \param times
+         *      Times the trials took in seconds
+         */
+        void printTrials(FILE *out, const char *metric,
+                         const std::vector<double> &times) const {
+            SampleStatistics stats(times);
+            fprintf(out, "# Trials %-15s%20s %-7s %3d  min %10.6lf  "
+                    "med %10.6lf  mean %10.6lf +- %9.6lf  sd %9.6lf  "
+                    "outliers %d\r\n",
+                    algorithm.c_str(), dataset.c_str(), metric,
+                    stats.getCount(), stats.getMin(), stats.getMedian(),
+                    stats.getMean(), stats.getConfidence95(),
+                    stats.getStddev(), stats.getNumOutliers());
         }
     };
 
     void printHeader() {
-        Result::printHeader();
+        for (const Output &output : outputs)
+            Result::printHeader(output, perfCounters.isOpen());
     }
 
     /**
@@ -305,15 +929,36 @@ public:
      *
      * @param bufferSize
      *      Size of the uncompresesd log data buffer
+     * @param maxThreads
+     *      Number of threads to generate datasets with and the most the
+     *      multi-threaded NanoLog can use
      */
-    BenchmarkRunner(const unsigned long int bufferSize)
+    BenchmarkRunner(const unsigned long int bufferSize,
+                    int maxThreads = std::thread::hardware_concurrency())
             : rawDataBuffer(nullptr)
             , endOfRawDataBuffer(nullptr)
             , compressedOutputBuffer(nullptr)
             , doubleCompressedOutputBuffer(nullptr)
+            , intermediateBuffer(nullptr)
+            , decompressedBuffer(nullptr)
             , rawBufferSize(bufferSize)
             , compressedBufferSize(2*bufferSize)
-            , argumentGenerator()
+            , parallelCompressor(maxThreads)
+            , columnarCompressor()
+            , latencyHistogram()
+            , specializedLatencyHistogram()
+            , ramcloudSites()
+            , formatIds()
+            , batchSizes()
+            , algorithmPatterns()
+            , threadCounts()
+            , warmups(0)
+            , trials(1)
+            , datasetPatterns()
+            , listDatasetsOnly(false)
+            , perfCounters()
+            , bandwidthModel(nullptr)
+            , sink()
     {
         rawDataBuffer = static_cast<unsigned char*>(malloc(rawBufferSize));
         compressedOutputBuffer = static_cast<unsigned char*>(
@@ -322,9 +967,15 @@ public:
         doubleCompressedOutputBuffer = static_cast<unsigned char*>(
                                                   malloc(compressedBufferSize));
 
+        intermediateBuffer = static_cast<unsigned char*>(
+                                                  malloc(compressedBufferSize));
+        decompressedBuffer = static_cast<unsigned char*>(malloc(rawBufferSize));
+
         if (rawDataBuffer == nullptr
                 || compressedOutputBuffer == nullptr
-                || doubleCompressedOutputBuffer == nullptr) {
+                || doubleCompressedOutputBuffer == nullptr
+                || intermediateBuffer == nullptr
+                || decompressedBuffer == nullptr) {
             fprintf(stderr, "Could not allocate input/output buffers of "
                     "size %lu and %lu bytes for compression\r\n",
                     rawBufferSize, compressedBufferSize);
@@ -334,7 +985,13 @@ public:
         bzero(rawDataBuffer, rawBufferSize);
         bzero(compressedOutputBuffer, compressedBufferSize);
         bzero(doubleCompressedOutputBuffer, compressedBufferSize);
+        bzero(intermediateBuffer, compressedBufferSize);
+        bzero(decompressedBuffer, rawBufferSize);
         endOfRawDataBuffer = rawDataBuffer + bufferSize;
+        parallelCompressor.prepare(rawBufferSize);
+
+        for (int i = 1; i <= parallelCompressor.getMaxThreads(); ++i)
+            threadCounts.push_back(i);
     }
 
     ~BenchmarkRunner() {
@@ -349,6 +1006,152 @@ public:
         if (doubleCompressedOutputBuffer != nullptr)
             free(doubleCompressedOutputBuffer);
         doubleCompressedOutputBuffer = nullptr;
+
+        if (intermediateBuffer != nullptr)
+            free(intermediateBuffer);
+        intermediateBuffer = nullptr;
+
+        if (decompressedBuffer != nullptr)
+            free(decompressedBuffer);
+        decompressedBuffer = nullptr;
+    }
+
+    /**
+     * Switches the runner into sweeping batch sizes: instead of compressing
+     * every generated dataset in one piece with every algorithm, the main
+     * algorithms compress it in slices of each of the given sizes, which
+     * models log flushes of that size (see runBatchSweep()).
+     *
+     * \param sizes
+     *      Batch sizes in bytes; none may exceed the runner's buffer size
+     */
+    void setBatchSizes(const std::vector<uint64_t> &sizes) {
+        batchSizes = sizes;
+    }
+
+    /**
+     * Restricts the algorithms run to the ones whose names match one of the
+     * patterns. Algorithms that are chained after another (e.g. NL+gzip,6)
+     * run the algorithm they build upon even if it isn't selected itself.
+     *
+     * \param patterns
+     *      fnmatch() patterns of the algorithm names; empty selects all
+     */
+    void setAlgorithms(const std::vector<std::string> &patterns) {
+        algorithmPatterns = patterns;
+    }
+
+    /**
+     * Sets the numbers of threads the multi-threaded NanoLog is run with
+     * (the default is every count from 1 to the runner's maxThreads).
+     *
+     * \param counts
+     *      Thread counts; ones larger than maxThreads are clamped
+     */
+    void setThreadCounts(const std::vector<int> &counts) {
+        threadCounts = counts;
+    }
+
+    /**
+     * Restricts the datasets generated to the ones whose names match one of
+     * the patterns.
+     *
+     * \param patterns
+     *      fnmatch() patterns of the dataset names; empty selects all
+     * \param listOnly
+     *      Print the names of the selected datasets instead of generating
+     *      and compressing them
+     */
+    void setDatasets(const std::vector<std::string> &patterns,
+                     bool listOnly = false) {
+        datasetPatterns = patterns;
+        listDatasetsOnly = listOnly;
+    }
+
+    /**
+     * Sets how many times every algorithm compresses every dataset. The
+     * first warmupCount runs fault in the buffers and warm up the caches and
+     * CPU frequency; their times are discarded. Each algorithm's Result then
+     * reports the median times of the trialCount runs that follow, along
+     * with their statistics when there's more than one.
+     *
+     * \param warmupCount
+     *      Number of untimed runs
+     * \param trialCount
+     *      Number of timed runs
+     */
+    void setTrials(int warmupCount, int trialCount) {
+        warmups = std::max(0, warmupCount);
+        trials = std::max(1, trialCount);
+    }
+
+    /**
+     * Records the Result of every algorithm on every dataset compressed
+     * from now on in a BandwidthModel, for an analysis of which algorithm to
+     * log with at which device bandwidths once the benchmarks are done.
+     *
+     * \param model
+     *      Model to record the Results in; nullptr stops recording
+     */
+    void setBandwidthModel(BandwidthModel *model) {
+        bandwidthModel = model;
+    }
+
+    /**
+     * Starts writing the compressed output of the main algorithms to a
+     * file after compressing each dataset, measuring the real write times
+     * and how much of them compression hides (see runSinkStage()). The
+     * writes are made with O_DIRECT from aligned buffers, queued on an
+     * io_uring (see DirectSink).
+     *
+     * \param path
+     *      File to write to; overwritten for every algorithm and dataset
+     *
+     * \return
+     *      False if the file couldn't be opened, in which case the
+     *      benchmarks run without the sink
+     */
+    bool enableSink(const char *path) {
+        return sink.open(path, compressedBufferSize);
+    }
+
+    /**
+     * Returns how the sink writes (see DirectSink::getMode())
+     */
+    const char *getSinkMode() const {
+        return sink.getMode();
+    }
+
+    /**
+     * Starts measuring the compressions with hardware performance counters
+     * (see PerfCounters). Each Result then reports the core cycles,
+     * instructions, IPC, branch misses, L1 data cache, last level cache and
+     * data TLB misses of its compression, except for the multi-threaded
+     * NanoLog, whose work happens on other threads. Must be called from the
+     * thread that runs the benchmarks.
+     *
+     * \return
+     *      False if the kernel doesn't give access to the counters, in which
+     *      case the benchmarks run without them
+     */
+    bool enablePerfCounters() {
+        return perfCounters.open();
+    }
+
+    /**
+     * Prints the header of the rows output by runBatchSweep()
+     */
+    static void printBatchSweepHeader() {
+        for (const Output &output : outputs) {
+            if (output.format == FORMAT_CSV) {
+                fprintf(output.file, "Algorithm,Dataset,BatchSize,Batches,"
+                        "Input Bytes,Output Bytes,Ratio,Comp MB/s\r\n");
+            } else if (output.format == FORMAT_TABLE) {
+                fprintf(output.file, "#%-14s%20s%12s%10s%15s%15s%10s%15s\r\n",
+                        "Algorithm", "Dataset", "BatchSize", "Batches",
+                        "Input Bytes", "Output Bytes", "Ratio", "Comp MB/s");
+            }
+        }
     }
 
     /**
@@ -387,35 +1190,158 @@ public:
                   bool runNanoLog = true, bool runGzip = true,
                   bool runMemcpy = true, bool runSnappy = true)
     {
-        T args[MAX_ARGS];
-        uint32_t numLogStatements = 0;
-        unsigned char *writePtr = rawDataBuffer;
-        unsigned char *endOfRawBuffer = rawDataBuffer + rawBufferSize;
-
         if (numArgs > MAX_ARGS) {
             fprintf(stderr, "You can only run tests with a maximum of "
                     "%d args (%d specified)\r\n", MAX_ARGS, numArgs);
             exit(-1);
         }
 
+        if (!shouldGenerate(datasetName))
+            return {};
+
+        // The log entries are all the same size, so every full region holds
+        // the same number of them and the incrementing generators can start
+        // each region where the previous one will leave off.
+        uint64_t entriesPerRegion = GENERATION_REGION_SIZE/
+                (sizeof(NanoLogInternal::Log::UncompressedEntry) +
+                 numArgs*sizeof(T));
+
         // Generate the logs required
-        argumentGenerator.reset();
-        while (true) {
-            for (int i = 0; i < numArgs; ++i) {
-                args[i] = randFn(argumentGenerator);
-            }
+        unsigned long int rawDataLength;
+        uint32_t numLogStatements = generateDataset([&](Region *region) {
+            T args[MAX_ARGS];
+            ArgumentGenerator argumentGenerator;
+            argumentGenerator.reset(region->seed,
+                                    region->index*entriesPerRegion*numArgs);
 
-            if (!binaryLogWithArgs(&writePtr, endOfRawBuffer, numArgs, args))
-                break;
+            while (true) {
+                for (int i = 0; i < numArgs; ++i) {
+                    args[i] = randFn(argumentGenerator);
+                }
 
-            ++numLogStatements;
-        }
-        unsigned long int rawDataLength = writePtr - rawDataBuffer;
+                if (!recordLog(region, numArgs, args))
+                    break;
+
+                ++region->numLogStatements;
+            }
+        }, &rawDataLength);
+        printLatency(datasetName);
 
         return runCompressionAlgos(datasetName, rawDataLength, numLogStatements,
                                    runMemcpy, runSnappy, runGzip, runNanoLog);
     }
 
+    /**
+     * Generates NanoLog log entries for a log statement whose arguments are
+     * of mixed types and runs the various compression algorithms on them.
+     * The statement is registered with the FormatRegistry the first time its
+     * dataset is generated, and every argument is generated according to its
+     * type: small random ints/longs, small random doubles and words from the
+     * top 1000 words on the Internet.
+     *
+     * @param datasetName
+     *      Name of the dataset to generate (used for printing)
+     * @param format
+     *      printf-style format string of the log statement
+     */
+    void formatTest(const char *datasetName, const char *format)
+    {
+        if (!shouldGenerate(datasetName))
+            return;
+
+        auto it = formatIds.find(format);
+        if (it == formatIds.end()) {
+            it = formatIds.emplace(format,
+                            FormatRegistry::registerFormat(format)).first;
+        }
+
+        uint32_t fmtId = it->second;
+        const FormatSignature *signature = FormatRegistry::getSignature(fmtId);
+
+        unsigned long int rawDataLength;
+        uint32_t numLogStatements = generateDataset([&](Region *region) {
+            LogArgument args[LoggerInternals::LOG_ID_MAX_ARGS];
+            ArgumentGenerator argumentGenerator;
+            argumentGenerator.reset(region->seed);
+
+            WordData::RandomWordGenerator rwg(region->seed);
+            rwg.setWordLimit(1000);
+
+            while (true) {
+                generateFormatArgs(signature, &argumentGenerator, &rwg, args);
+                if (!recordFormatLog(region, fmtId, args))
+                    break;
+
+                ++region->numLogStatements;
+            }
+        }, &rawDataLength);
+        printLatency(datasetName);
+
+        runCompressionAlgos(datasetName, rawDataLength, numLogStatements);
+    }
+
+    /**
+     * Generates a stream of NanoLog log entries modeled after RAMCloud's
+     * logging and runs the various compression algorithms on it. Every log
+     * statement in RAMCloudLogs[] is a log site registered with the
+     * FormatRegistry, which derives its argument types from its format
+     * specifiers. Each log entry picks its site with a Zipfian distribution,
+     * so that a few sites dominate like they do in production, and generates
+     * the site's arguments the same way formatTest() does.
+     *
+     * @param theta
+     *      Zipfian parameter of the site popularity (see ZipfianGenerator)
+     */
+    void ramcloudTest(double theta = 0.99)
+    {
+        char testName[100];
+        snprintf(testName, sizeof(testName), "RAMCloud Zipf %.2f", theta);
+        if (!shouldGenerate(testName))
+            return;
+
+        if (ramcloudSites.empty()) {
+            for (int i = 0; i < numRAMCloudLogs; ++i) {
+                ramcloudSites.push_back(FormatRegistry::registerFormat(
+                                                RAMCloudLogs[i].c_str()));
+            }
+
+            // Decouple popularity from the alphabetical order of the logs
+            std::default_random_engine generator(0);
+            std::shuffle(ramcloudSites.begin(), ramcloudSites.end(),
+                         generator);
+        }
+
+        // Computing the Zipfian constants is the expensive part, so every
+        // region starts from a copy
+        const ZipfianGenerator siteGenerator(ramcloudSites.size(), theta);
+
+        unsigned long int rawDataLength;
+        uint32_t numLogStatements = generateDataset([&](Region *region) {
+            LogArgument args[LoggerInternals::LOG_ID_MAX_ARGS];
+            ArgumentGenerator argumentGenerator;
+            argumentGenerator.reset(region->seed);
+
+            WordData::RandomWordGenerator rwg(region->seed);
+            rwg.setWordLimit(1000);
+
+            ZipfianGenerator zf(siteGenerator);
+            zf.reset(region->seed);
+
+            while (true) {
+                uint32_t fmtId = ramcloudSites[zf.nextNumber()];
+                generateFormatArgs(FormatRegistry::getSignature(fmtId),
+                                   &argumentGenerator, &rwg, args);
+                if (!recordFormatLog(region, fmtId, args))
+                    break;
+
+                ++region->numLogStatements;
+            }
+        }, &rawDataLength);
+        printLatency(testName);
+
+        runCompressionAlgos(testName, rawDataLength, numLogStatements);
+    }
+
     /**
      * Generates NanoLog log entries using random/top1000words strings and runs
      * the various compression algorithms on them.
@@ -439,105 +1365,856 @@ public:
     {
         char testName[100];
         uint32_t numLogStatements;
-        uint64_t rawDataLength;
-        unsigned char *writePtr;
+        unsigned long int rawDataLength;
+
+        snprintf(testName, sizeof(testName), "Rand %d Chars", stringLength);
+        if (runRandomStrings && shouldGenerate(testName)) {
+            numLogStatements = generateDataset([&](Region *region) {
+                std::default_random_engine generator(region->seed);
+                std::uniform_int_distribution<char> charDist(' ', '~');
+                std::string myString(stringLength + 1, '\0');
+                while (true) {
+                    const char *args[1];
+                    for (int i = 0; i < stringLength; ++i) {
+                        myString[i] = charDist(generator);
+                    }
 
-        if (runRandomStrings) {
-            numLogStatements = 0;
-            writePtr = rawDataBuffer;
+                    args[0] = myString.c_str();
+                    if (!recordLog(region, 1, args))
+                        break;
 
-            std::default_random_engine generator;
-            std::uniform_int_distribution<char> charDist(' ', '~');
-            std::string myString(stringLength + 1, '\0');
-            while (true) {
-                const char *args[1];
-                for (int i = 0; i < stringLength; ++i) {
-                    myString[i] = charDist(generator);
+                    ++region->numLogStatements;
                 }
+            }, &rawDataLength);
 
-                args[0] = myString.c_str();
-                if (!binaryLogWithArgs(&writePtr, endOfRawDataBuffer, 1, args))
-                    break;
-
-                ++numLogStatements;
-            }
-
-            rawDataLength = writePtr - rawDataBuffer;
-            snprintf(testName, sizeof(testName), "Rand %d Chars", stringLength);
+            printLatency(testName);
             runCompressionAlgos(testName, rawDataLength, numLogStatements);
         }
 
-        if (runTopNWords) {
-            numLogStatements = 0;
-            writePtr = rawDataBuffer;
-
-            WordData::RandomWordGenerator rwg;
-            rwg.setWordLimit(topNWordsLimit);
-            while (true) {
-                std::string str;
-
-                while (str.size() <= stringLength) {
-                    str += rwg.getRandomWord();
-                    str += ' ';
-                }
+        snprintf(testName, sizeof(testName), "Top1000 %d Chars", stringLength);
+        if (runTopNWords && shouldGenerate(testName)) {
+            numLogStatements = generateDataset([&](Region *region) {
+                WordData::RandomWordGenerator rwg(region->seed);
+                rwg.setWordLimit(topNWordsLimit);
+                while (true) {
+                    std::string str;
+
+                    while (str.size() <= stringLength) {
+                        str += rwg.getRandomWord();
+                        str += ' ';
+                    }
 
-                str = str.substr(0, stringLength);
-                const char *args[1] = {str.c_str()};
+                    str = str.substr(0, stringLength);
+                    const char *args[1] = {str.c_str()};
 
-                if (!binaryLogWithArgs(&writePtr, endOfRawDataBuffer, 1, args))
-                    break;
+                    if (!recordLog(region, 1, args))
+                        break;
 
-                ++numLogStatements;
-            }
+                    ++region->numLogStatements;
+                }
+            }, &rawDataLength);
 
-            rawDataLength = writePtr - rawDataBuffer;
-            snprintf(testName, sizeof(testName), "Top1000 %d Chars",
-                     stringLength);
+            printLatency(testName);
             runCompressionAlgos(testName, rawDataLength, numLogStatements);
         }
 
-        if (runZipfian) {
-            numLogStatements = 0;
-            writePtr = rawDataBuffer;
-
+        snprintf(testName, sizeof(testName), "zipf100k %d Chars", stringLength);
+        if (runZipfian && shouldGenerate(testName)) {
             // Here, we generate a zipfian distributed number between [0, 100000)
             // and use it as a seed to a character generator. This would
             // effectively give us 100000 unique strings to work with that
             // have a zipfian distribution since the PRNG of the character
             // produces a deterministic string.
-            ZipfianGenerator zf(numUniqueCharacterStrings);
-            std::uniform_int_distribution<char> charDist(' ', '~');
+            const ZipfianGenerator stringGenerator(numUniqueCharacterStrings);
+
+            // Generate every rank's string once up front rather than for
+            // every log statement
+            std::vector<char> strings(numUniqueCharacterStrings*
+                                      (stringLength + 1), '\0');
+            parallelCompressor.runOnWorkers(parallelCompressor.getMaxThreads(),
+                                            [&](int workerId) {
+                std::uniform_int_distribution<char> charDist(' ', '~');
+                for (uint64_t rank = workerId; rank < numUniqueCharacterStrings;
+                        rank += parallelCompressor.getMaxThreads()) {
+                    std::default_random_engine generator(rank);
+                    char *str = &strings[rank*(stringLength + 1)];
+                    for (int i = 0; i < stringLength; ++i)
+                        str[i] = charDist(generator);
+                }
+            });
 
-            std::string myString(stringLength + 1, '\0');
-            while (true) {
-                std::default_random_engine generator(zf.nextNumber());
-                for (int i = 0; i < stringLength; ++i)
-                    myString[i] = charDist(generator);
+            numLogStatements = generateDataset([&](Region *region) {
+                ZipfianGenerator zf(stringGenerator);
+                zf.reset(region->seed);
 
-                const char *args[1] = { myString.c_str() };
-                if (!binaryLogWithArgs(&writePtr, endOfRawDataBuffer, 1, args))
-                    break;
+                while (true) {
+                    const char *args[1] = {
+                            &strings[zf.nextNumber()*(stringLength + 1)] };
+                    if (!recordLog(region, 1, args))
+                        break;
 
-                ++numLogStatements;
-            }
+                    ++region->numLogStatements;
+                }
+            }, &rawDataLength);
 
-            rawDataLength = writePtr - rawDataBuffer;
-            snprintf(testName, sizeof(testName), "zipf100k %d Chars",
-                     stringLength);
-            runCompressionAlgos(testName, rawDataLength, numLogStatements   );
+            printLatency(testName);
+            runCompressionAlgos(testName, rawDataLength, numLogStatements);
         }
     }
 private:
     /**
- * Runs the compression algorithms, prints out and returns the Result.
- *
- * @param datasetName
- *      Name of the uncompressed dataset
- *
- * @param rawDataLength
- *      Length of the data contained within the internal rawDataBuffer
- *
- * @param numLogStatements
+     * Wrapper around binaryLogWithArgs() used to generate the datasets that
+     * also times every LATENCY_SAMPLE_PERIOD-th invocation. Only a sample is
+     * timed to keep the Cycles::rdtsc() calls from dominating the cost being
+     * measured. Every other sample is recorded with the equivalent
+     * Specialized::recordLog() instantiation instead (which produces the same
+     * log entry), so the two are compared on the same arguments.
+     *
+     * \param region
+     *      Region to store the log entry in
+     * \param numArgs
+     *      Number of arguments to place in the log entry
+     * \param args
+     *      An array of arguments to place into the log entry
+     *
+     * \return
+     *      Same as binaryLogWithArgs()
+     */
+    template<typename ArgumentType>
+    bool
+    recordLog(Region *region, int numArgs, ArgumentType *args)
+    {
+        unsigned char **buffer = &region->writePos;
+        ++region->numLogsRecorded;
+        if (region->numLogsRecorded % LATENCY_SAMPLE_PERIOD != 0)
+            return binaryLogWithArgs(buffer, region->end, numArgs, args);
+
+        uint64_t start, stop;
+        bool success;
+        LatencyHistogram *histogram;
+        if (region->numLogsRecorded % (2*LATENCY_SAMPLE_PERIOD) != 0) {
+            histogram = region->latencyHistogram;
+            start = Cycles::rdtsc();
+            success = binaryLogWithArgs(buffer, region->end, numArgs, args);
+            stop = Cycles::rdtsc();
+        } else {
+            Specialized::RecordFn<ArgumentType> recordFn =
+                    Specialized::getRecordFn<ArgumentType>(numArgs);
+            histogram = region->specializedLatencyHistogram;
+            start = Cycles::rdtsc();
+            success = recordFn(buffer, region->end, args);
+            stop = Cycles::rdtsc();
+        }
+
+        // The invocation that runs out of space doesn't record anything
+        if (success)
+            histogram->record(stop - start);
+
+        return success;
+    }
+
+    /**
+     * Same as recordLog(), but for a log statement registered with the
+     * FormatRegistry. Specialized::recordLog() has no instantiations for
+     * mixed argument types, so every sampled invocation is a
+     * binaryLogWithFormat() one.
+     *
+     * \param region
+     *      Region to store the log entry in
+     * \param fmtId
+     *      fmtId the log statement was registered with
+     * \param args
+     *      Arguments of the log statement, in the order of its signature
+     *
+     * \return
+     *      Same as binaryLogWithFormat()
+     */
+    bool
+    recordFormatLog(Region *region, uint32_t fmtId, const LogArgument *args)
+    {
+        unsigned char **buffer = &region->writePos;
+        ++region->numLogsRecorded;
+        if (region->numLogsRecorded % LATENCY_SAMPLE_PERIOD != 0)
+            return binaryLogWithFormat(buffer, region->end, fmtId, args);
+
+        uint64_t start = Cycles::rdtsc();
+        bool success = binaryLogWithFormat(buffer, region->end, fmtId, args);
+        uint64_t stop = Cycles::rdtsc();
+
+        if (success)
+            region->latencyHistogram->record(stop - start);
+
+        return success;
+    }
+
+    /**
+     * Returns true if a dataset is selected and should be generated, or
+     * prints its name if the datasets are only being listed.
+     *
+     * \param datasetName
+     *      Name of the dataset
+     */
+    bool
+    shouldGenerate(const char *datasetName)
+    {
+        bool selected = datasetPatterns.empty();
+        for (const std::string &pattern : datasetPatterns)
+            selected |= (fnmatch(pattern.c_str(), datasetName, 0) == 0);
+
+        if (selected && listDatasetsOnly) {
+            printf("%s\r\n", datasetName);
+            return false;
+        }
+
+        return selected;
+    }
+
+    /**
+     * Returns true if the algorithm matches one of the algorithmPatterns.
+     *
+     * \param algorithm
+     *      Name of the algorithm, as printed in its Result
+     */
+    bool
+    isSelected(const std::string &algorithm) const
+    {
+        if (algorithmPatterns.empty())
+            return true;
+
+        for (const std::string &pattern : algorithmPatterns) {
+            if (fnmatch(pattern.c_str(), algorithm.c_str(), 0) == 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * Returns true if the algorithm or any of the ones runChainedAlgos()
+     * chains after it under the prefix are selected, i.e. whether the
+     * algorithm has to run.
+     *
+     * \param algorithm
+     *      Name of the algorithm
+     * \param prefix
+     *      Prefix of the chained algorithms' names (e.g. "NL")
+     */
+    bool
+    isSelectedWithChains(const std::string &algorithm,
+                         const std::string &prefix) const
+    {
+        if (isSelected(algorithm) || isSelected(prefix + "+s") ||
+                isSelected(prefix + "+snappy"))
+            return true;
+
+        for (int level : {1, 6, 9}) {
+            if (isSelected(prefix + "+gzip," + std::to_string(level)))
+                return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * Appends a Result to the results if its algorithm is selected; chained
+     * algorithms use this to run an unselected first stage silently.
+     *
+     * \param result
+     *      Result to report
+     * \param[out] results
+     *      Results of the dataset so far
+     */
+    void
+    report(Result &result, std::vector<Result> &results)
+    {
+        if (!isSelected(result.algorithm))
+            return;
+
+        results.push_back(result);
+    }
+
+    /**
+     * Returns the main algorithms, which the batch size sweep and the sink
+     * stage compress slices of the datasets with, by name.
+     */
+    std::vector<std::pair<std::string, CompressFn>>
+    getBatchAlgorithms()
+    {
+        std::vector<std::pair<std::string, CompressFn>> algorithms;
+        algorithms.emplace_back("memcpy", [](unsigned char *dest,
+                unsigned long *destLen, const unsigned char *source,
+                unsigned long sourceLen) {
+            memcpy(dest, source, sourceLen);
+            *destLen = sourceLen;
+            return Z_OK;
+        });
+        algorithms.emplace_back("snappy", [](unsigned char *dest,
+                unsigned long *destLen, const unsigned char *source,
+                unsigned long sourceLen) {
+            snappy::RawCompress(reinterpret_cast<const char*>(source),
+                                sourceLen, reinterpret_cast<char*>(dest),
+                                destLen);
+            return Z_OK;
+        });
+        for (int level : {1, 6, 9}) {
+            algorithms.emplace_back("gzip," + std::to_string(level),
+                    [level](unsigned char *dest, unsigned long *destLen,
+                            const unsigned char *source,
+                            unsigned long sourceLen) {
+                return compress2(dest, destLen, source, sourceLen, level);
+            });
+        }
+        algorithms.emplace_back("NanoLog", [](unsigned char *dest,
+                unsigned long *destLen, const unsigned char *source,
+                unsigned long sourceLen) {
+            return NanoLogCompress2(dest, destLen, source, sourceLen);
+        });
+        algorithms.emplace_back("NanoLog-col", [this](unsigned char *dest,
+                unsigned long *destLen, const unsigned char *source,
+                unsigned long sourceLen) {
+            return columnarCompressor.compress(dest, destLen, source,
+                                               sourceLen);
+        });
+        algorithms.emplace_back("NanoLog-simd", SimdPacker::compress);
+        return algorithms;
+    }
+
+    /**
+     * Cuts a slice of at most a batch size off the log entries of a
+     * dataset, on an entry boundary.
+     *
+     * \param slice
+     *      First entry of the slice
+     * \param batchSize
+     *      Largest size of the slice
+     * \param endOfData
+     *      End of the dataset's entries
+     *
+     * \return
+     *      End of the slice; the slice is empty if its first entry is larger
+     *      than the batch size
+     */
+    static const unsigned char *
+    cutSlice(const unsigned char *slice, uint64_t batchSize,
+             const unsigned char *endOfData)
+    {
+        const unsigned char *sliceEnd = slice;
+        while (sliceEnd < endOfData) {
+            uint32_t entrySize = reinterpret_cast<const
+                    NanoLogInternal::Log::UncompressedEntry*>(
+                            sliceEnd)->entrySize;
+            if (sliceEnd + entrySize > slice + batchSize)
+                break;
+            sliceEnd += entrySize;
+        }
+
+        return sliceEnd;
+    }
+
+    /**
+     * Compresses a dataset in batch-sized slices with the main algorithms
+     * for each of the batchSizes and prints the compression rate per size.
+     * Slices are cut on log entry boundaries from consecutive parts of the
+     * dataset. Each slice is compressed once untimed, leaving it in the cache
+     * the way a freshly filled staging buffer would be, and is then
+     * compressed enough times to amortize the timer. Batches that fit in a
+     * cache level thus run at that level's bandwidth while larger ones
+     * stream from memory. Every size runs for at least SWEEP_MIN_SECONDS.
+     *
+     * \param datasetName
+     *      Name of the dataset in rawDataBuffer
+     * \param rawDataLength
+     *      Length of the dataset
+     */
+    void
+    runBatchSweep(const char *datasetName, unsigned long rawDataLength)
+    {
+        std::vector<std::pair<std::string, CompressFn>> algorithms =
+                                                        getBatchAlgorithms();
+
+        const unsigned char *endOfData = rawDataBuffer + rawDataLength;
+        for (uint64_t batchSize : batchSizes) {
+            for (auto &algorithm : algorithms) {
+                if (!isSelected(algorithm.first))
+                    continue;
+
+                const CompressFn &compressFn = algorithm.second;
+                uint64_t reps = std::max<uint64_t>(1,
+                                        SWEEP_MIN_BYTES_TIMED/batchSize);
+                uint64_t numBatches = 0;
+                uint64_t inputBytes = 0, outputBytes = 0, cycles = 0;
+                const unsigned char *slice = rawDataBuffer;
+
+                while (numBatches == 0 ||
+                        Cycles::toSeconds(cycles) < SWEEP_MIN_SECONDS) {
+                    // Wrap around at the end of the dataset
+                    const unsigned char *sliceEnd = cutSlice(slice,
+                                                             batchSize,
+                                                             endOfData);
+
+                    unsigned long sliceLength = sliceEnd - slice;
+                    unsigned long compressedLength = compressedBufferSize;
+                    int retVal = compressFn(compressedOutputBuffer,
+                                            &compressedLength, slice,
+                                            sliceLength);
+
+                    uint64_t start = Cycles::rdtsc();
+                    for (uint64_t i = 0; i < reps; ++i) {
+                        compressedLength = compressedBufferSize;
+                        int status = compressFn(compressedOutputBuffer,
+                                                &compressedLength, slice,
+                                                sliceLength);
+                        if (status != Z_OK)
+                            retVal = status;
+                    }
+                    cycles += Cycles::rdtsc() - start;
+
+                    if (retVal != Z_OK) {
+                        fprintf(stderr, "Compression scheme %s with input "
+                                "\"%s\" failed with error code %d\r\n",
+                                algorithm.first.c_str(), datasetName, retVal);
+                    }
+
+                    numBatches += reps;
+                    inputBytes += reps*sliceLength;
+                    outputBytes += reps*compressedLength;
+
+                    slice = (sliceEnd < endOfData && sliceLength > 0)
+                                ? sliceEnd : rawDataBuffer;
+                }
+
+                double ratio = (1.0*outputBytes)/inputBytes;
+                double rate = inputBytes/(1024*1024*
+                                          Cycles::toSeconds(cycles));
+                for (const Output &output : outputs) {
+                    if (output.format == FORMAT_JSON) {
+                        fprintf(output.file, "%s\n", JsonObject()
+                                .addString("type", "sweep")
+                                .addString("algorithm", algorithm.first)
+                                .addString("dataset", datasetName)
+                                .addInteger("batch_size", batchSize)
+                                .addInteger("batches", numBatches)
+                                .addInteger("input_bytes", inputBytes)
+                                .addInteger("output_bytes", outputBytes)
+                                .addNumber("ratio", ratio)
+                                .addNumber("compress_mbps", rate)
+                                .str().c_str());
+                        continue;
+                    }
+
+                    bool csv = (output.format == FORMAT_CSV);
+                    fprintf(output.file, csv
+                            ? "%s,%s,%lu,%lu,%lu,%lu,%.4lf,%.3lf\r\n"
+                            : "%-15s%20s%12lu%10lu%15lu%15lu%10.4lf%15.3lf\r\n",
+                            csv ? csvField(algorithm.first).c_str()
+                                : algorithm.first.c_str(),
+                            csv ? csvField(datasetName).c_str() : datasetName,
+                            batchSize, numBatches, inputBytes, outputBytes,
+                            ratio, rate);
+                }
+            }
+        }
+    }
+
+    /**
+     * Compresses a dataset into the sink's buffer in SINK_SLICE_SIZE slices
+     * cut on log entry boundaries, each compressed independently the way a
+     * logger compresses each staging buffer it flushes.
+     *
+     * \param compressFn
+     *      Algorithm to compress the slices with
+     * \param rawDataLength
+     *      Length of the dataset in rawDataBuffer
+     * \param submitSlices
+     *      True hands the sink every slice's output as soon as it's
+     *      compressed, so the writes overlap the compression of the next
+     *      slices; false leaves writing all of it to the caller
+     * \param[out] outputLength
+     *      Length of the compressed slices in the sink's buffer
+     *
+     * \return
+     *      Z_OK, or the error of the algorithm or the sink
+     */
+    int
+    compressIntoSink(const CompressFn &compressFn, unsigned long rawDataLength,
+                     bool submitSlices, unsigned long *outputLength)
+    {
+        const unsigned char *endOfData = rawDataBuffer + rawDataLength;
+        const unsigned char *slice = rawDataBuffer;
+        *outputLength = 0;
+
+        while (slice < endOfData) {
+            const unsigned char *sliceEnd = cutSlice(slice, SINK_SLICE_SIZE,
+                                                     endOfData);
+            if (sliceEnd == slice)
+                sliceEnd = endOfData;
+
+            unsigned long compressedLength = sink.getCapacity() -
+                                             *outputLength;
+            int retVal = compressFn(sink.getBuffer() + *outputLength,
+                                    &compressedLength, slice,
+                                    sliceEnd - slice);
+            if (retVal != Z_OK)
+                return retVal;
+
+            *outputLength += compressedLength;
+            if (submitSlices && !sink.submit(*outputLength))
+                return Z_ERRNO;
+
+            slice = sliceEnd;
+        }
+
+        return Z_OK;
+    }
+
+    /**
+     * Measures writing the output of the main algorithms to the sink's file
+     * (see enableSink()) and prints the times. Each algorithm compresses the
+     * dataset in SINK_SLICE_SIZE slices twice. The first pass compresses
+     * everything and then writes it, which measures the compute and write
+     * times separately. The second submits each slice's output while the
+     * next slices compress, like a logger, which measures how much of the
+     * shorter of the two the overlap hides. The Result's "Max (s)" assumes
+     * it hides all of it. Both passes run for the warmups and trials; the
+     * median times are printed along with the median, min and max of each
+     * trial's overlap, or no overlap if the shorter phase is too short to
+     * measure it (see SINK_MIN_PHASE_SECONDS). Table and JSON outputs only,
+     * like the latencies.
+     *
+     * \param datasetName
+     *      Name of the dataset in rawDataBuffer
+     * \param rawDataLength
+     *      Length of the dataset
+     */
+    void
+    runSinkStage(const char *datasetName, unsigned long rawDataLength)
+    {
+        for (auto &algorithm : getBatchAlgorithms()) {
+            if (!isSelected(algorithm.first))
+                continue;
+
+            unsigned long outputLength = 0;
+            int retVal = Z_OK;
+            std::vector<double> computeTimes, writeTimes, pipelinedTimes;
+
+            for (int i = 0; i < warmups + trials && retVal == Z_OK; ++i) {
+                if (!sink.reset()) {
+                    retVal = Z_ERRNO;
+                    break;
+                }
+
+                uint64_t start = Cycles::rdtsc();
+                retVal = compressIntoSink(algorithm.second, rawDataLength,
+                                          false, &outputLength);
+                uint64_t compressed = Cycles::rdtsc();
+                if (retVal == Z_OK && !sink.finish(outputLength))
+                    retVal = Z_ERRNO;
+                uint64_t written = Cycles::rdtsc();
+
+                if (retVal != Z_OK || !sink.reset()) {
+                    retVal = (retVal != Z_OK) ? retVal : Z_ERRNO;
+                    break;
+                }
+
+                uint64_t pipelineStart = Cycles::rdtsc();
+                retVal = compressIntoSink(algorithm.second, rawDataLength,
+                                          true, &outputLength);
+                if (retVal == Z_OK && !sink.finish(outputLength))
+                    retVal = Z_ERRNO;
+                uint64_t pipelineStop = Cycles::rdtsc();
+
+                if (i >= warmups) {
+                    computeTimes.push_back(
+                            Cycles::toSeconds(compressed - start));
+                    writeTimes.push_back(
+                            Cycles::toSeconds(written - compressed));
+                    pipelinedTimes.push_back(
+                            Cycles::toSeconds(pipelineStop - pipelineStart));
+                }
+            }
+
+            if (retVal != Z_OK) {
+                fprintf(stderr, "Writing the output of compression scheme "
+                        "%s with input \"%s\" to the sink failed with error "
+                        "code %d\r\n", algorithm.first.c_str(), datasetName,
+                        retVal);
+                continue;
+            }
+
+            // Fraction of the shorter phase the pipeline hid behind the
+            // longer one, per trial: 1 if it took Max (s), 0 if it took
+            // their sum. Ratios of the medians would mix trials and divide
+            // their noise by the shorter phase.
+            std::vector<double> overlaps;
+            for (size_t i = 0; i < computeTimes.size(); ++i) {
+                double shorter = std::min(computeTimes[i], writeTimes[i]);
+                if (shorter > 0)
+                    overlaps.push_back((computeTimes[i] + writeTimes[i] -
+                                        pipelinedTimes[i])/shorter);
+            }
+
+            double computeTime = SampleStatistics(computeTimes).getMedian();
+            double writeTime = SampleStatistics(writeTimes).getMedian();
+            double pipelinedTime =
+                            SampleStatistics(pipelinedTimes).getMedian();
+            double writeRate = outputLength/(1024*1024*writeTime);
+            SampleStatistics overlapStats(overlaps);
+            double shorterPhase = std::min(computeTime, writeTime);
+            bool overlapReliable = overlapStats.getCount() > 0 &&
+                    shorterPhase >= SINK_MIN_PHASE_SECONDS &&
+                    shorterPhase >= SINK_MIN_PHASE_FRACTION*
+                                    std::max(computeTime, writeTime);
+
+            for (const Output &output : outputs) {
+                if (output.format == FORMAT_JSON) {
+                    JsonObject record;
+                    record.addString("type", "sink")
+                          .addString("algorithm", algorithm.first)
+                          .addString("dataset", datasetName)
+                          .addString("io", sink.getMode())
+                          .addInteger("slice_size", SINK_SLICE_SIZE)
+                          .addInteger("trials", trials)
+                          .addInteger("input_bytes", rawDataLength)
+                          .addInteger("output_bytes", outputLength)
+                          .addNumber("compute_s", computeTime)
+                          .addNumber("write_s", writeTime)
+                          .addNumber("write_mbps", writeRate)
+                          .addNumber("serial_s", computeTime + writeTime)
+                          .addNumber("max_s", std::max(computeTime,
+                                                       writeTime))
+                          .addNumber("pipelined_s", pipelinedTime);
+
+                    if (!overlapReliable) {
+                        record.addNull("overlap")
+                              .addNull("overlap_stats");
+                    } else {
+                        record.addNumber("overlap", overlapStats.getMedian())
+                              .addObject("overlap_stats", JsonObject()
+                                .addNumber("min", overlapStats.getMin())
+                                .addNumber("max", overlapStats.getMax())
+                                .addNumber("median", overlapStats.getMedian())
+                                .addNumber("mean", overlapStats.getMean())
+                                .addNumber("stddev", overlapStats.getStddev())
+                                .addNumber("ci95",
+                                           overlapStats.getConfidence95())
+                                .addInteger("outliers",
+                                            overlapStats.getNumOutliers()));
+                    }
+
+                    fprintf(output.file, "%s\n", record.str().c_str());
+                } else if (output.format == FORMAT_TABLE) {
+                    fprintf(output.file, "# Sink %-15s%-20s %12lu B  "
+                            "compute %9.6lf s  write %9.6lf s %9.1lf MB/s  "
+                            "serial %9.6lf s  max %9.6lf s  pipelined "
+                            "%9.6lf s  overlap ",
+                            algorithm.first.c_str(), datasetName,
+                            outputLength, computeTime, writeTime, writeRate,
+                            computeTime + writeTime,
+                            std::max(computeTime, writeTime), pipelinedTime);
+                    if (!overlapReliable) {
+                        fprintf(output.file, "    n/a (shorter phase under "
+                                "%.0lf ms or %.0lf%% of the longer)\r\n",
+                                1e3*SINK_MIN_PHASE_SECONDS,
+                                100*SINK_MIN_PHASE_FRACTION);
+                    } else {
+                        fprintf(output.file, "%6.1lf%% (min %6.1lf%%  max "
+                                "%6.1lf%%)\r\n",
+                                100*overlapStats.getMedian(),
+                                100*overlapStats.getMin(),
+                                100*overlapStats.getMax());
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * Derives the seed of a Region from its index with SplitMix64's
+     * finalizer, so that neighboring regions get uncorrelated PRNG streams.
+     *
+     * \param index
+     *      Index of the region
+     */
+    static uint64_t
+    getRegionSeed(uint64_t index)
+    {
+        uint64_t z = (index + 1)*0x9e3779b97f4a7c15UL;
+        z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9UL;
+        z = (z ^ (z >> 27))*0x94d049bb133111ebUL;
+        return z ^ (z >> 31);
+    }
+
+    /**
+     * Generates a dataset into rawDataBuffer in parallel. The buffer is split
+     * into GENERATION_REGION_SIZE regions that the thread pool fills
+     * independently, each seeded from its index alone, and the regions are
+     * then concatenated. The dataset is thus the same no matter how many
+     * threads generate it (apart from the log entries' timestamps).
+     *
+     * \param fillRegion
+     *      Fills a region with log entries, drawing all of its randomness
+     *      from the region's seed
+     * \param[out] rawDataLength
+     *      Length of the generated data at the start of rawDataBuffer
+     *
+     * \return
+     *      Number of log statements generated
+     */
+    uint32_t
+    generateDataset(const RegionFn &fillRegion, unsigned long *rawDataLength)
+    {
+        uint64_t numRegions = (rawBufferSize + GENERATION_REGION_SIZE - 1)/
+                                                    GENERATION_REGION_SIZE;
+        std::vector<Region> regions(numRegions);
+        for (uint64_t i = 0; i < numRegions; ++i) {
+            Region &region = regions[i];
+            region.index = i;
+            region.seed = getRegionSeed(i);
+            region.writePos = rawDataBuffer + i*GENERATION_REGION_SIZE;
+            region.end = std::min(region.writePos + GENERATION_REGION_SIZE,
+                                  endOfRawDataBuffer);
+            region.numLogStatements = 0;
+            region.numLogsRecorded = 0;
+        }
+
+        int numWorkers = static_cast<int>(std::min<uint64_t>(numRegions,
+                                          parallelCompressor.getMaxThreads()));
+        std::vector<LatencyHistogram> latencies(numWorkers);
+        std::vector<LatencyHistogram> specializedLatencies(numWorkers);
+        std::atomic<uint64_t> nextRegion(0);
+
+        parallelCompressor.runOnWorkers(numWorkers, [&](int workerId) {
+            uint64_t i;
+            while ((i = nextRegion.fetch_add(1)) < numRegions) {
+                regions[i].latencyHistogram = &latencies[workerId];
+                regions[i].specializedLatencyHistogram =
+                                            &specializedLatencies[workerId];
+                fillRegion(&regions[i]);
+            }
+        });
+
+        for (int i = 0; i < numWorkers; ++i) {
+            latencyHistogram.merge(latencies[i]);
+            specializedLatencyHistogram.merge(specializedLatencies[i]);
+        }
+
+        // Squeeze out the space left at the end of each region
+        uint32_t numLogStatements = 0;
+        unsigned char *writePos = rawDataBuffer;
+        for (Region &region : regions) {
+            unsigned char *start = rawDataBuffer +
+                                        region.index*GENERATION_REGION_SIZE;
+            uint64_t length = region.writePos - start;
+            memmove(writePos, start, length);
+            writePos += length;
+            numLogStatements += region.numLogStatements;
+        }
+
+        *rawDataLength = writePos - rawDataBuffer;
+        return numLogStatements;
+    }
+
+    /**
+     * Generates the arguments of a log statement registered with the
+     * FormatRegistry according to their types: small random ints/longs,
+     * small random doubles and words from a RandomWordGenerator.
+     *
+     * \param signature
+     *      Signature of the log statement
+     * \param argumentGenerator
+     *      Generates the numeric arguments
+     * \param rwg
+     *      Generates the string arguments
+     * \param[out] args
+     *      Array to store the signature->numArgs arguments in
+     */
+    static void
+    generateFormatArgs(const FormatSignature *signature,
+                       ArgumentGenerator *argumentGenerator,
+                       WordData::RandomWordGenerator *rwg, LogArgument *args)
+    {
+        for (int i = 0; i < signature->numArgs; ++i) {
+            switch (signature->argTypes[i]) {
+                case LOG_ARG_INT:
+                    args[i].intArg = ArgumentGenerator::randSmallInt<int>(
+                                                        *argumentGenerator);
+                    break;
+                case LOG_ARG_LONG:
+                    args[i].longArg = ArgumentGenerator::randSmallInt<long>(
+                                                        *argumentGenerator);
+                    break;
+                case LOG_ARG_DOUBLE:
+                    args[i].doubleArg = ArgumentGenerator::randSmallDouble(
+                                                        *argumentGenerator);
+                    break;
+                default:
+                    args[i].stringArg = rwg->getRandomWord();
+                    break;
+            }
+        }
+    }
+
+    /**
+     * Prints the percentiles of the log statement latencies sampled while
+     * generating a dataset and resets the histograms for the next one. CSV
+     * output only has room for the Results, so they're left out of it, and
+     * so are empty histograms (datasets of mixed argument types have no
+     * Specialized::recordLog() samples).
+     *
+     * \param datasetName
+     *      Name of the dataset that was generated
+     */
+    void
+    printLatency(const char *datasetName)
+    {
+        const char *labels[] = {"loop", "spec"};
+        LatencyHistogram *histograms[] = {&latencyHistogram,
+                                          &specializedLatencyHistogram};
+
+        for (int i = 0; i < 2; ++i) {
+            for (const Output &output : outputs) {
+                if (histograms[i]->getCount() == 0)
+                    break;
+
+                if (output.format == FORMAT_JSON) {
+                    fprintf(output.file, "%s\n", JsonObject()
+                            .addString("type", "latency")
+                            .addString("path", labels[i])
+                            .addString("dataset", datasetName)
+                            .addInteger("samples", histograms[i]->getCount())
+                            .addNumber("p50_ns",
+                                       histograms[i]->getPercentileNs(50))
+                            .addNumber("p99_ns",
+                                       histograms[i]->getPercentileNs(99))
+                            .addNumber("p999_ns",
+                                       histograms[i]->getPercentileNs(99.9))
+                            .addNumber("max_ns", histograms[i]->getMaxNs())
+                            .str().c_str());
+                } else if (output.format == FORMAT_TABLE) {
+                    fprintf(output.file, "# Log latency %s %-20s %10lu "
+                            "samples  p50 %8.1lf  p99 %8.1lf  p99.9 %8.1lf  "
+                            "max %10.1lf ns\r\n",
+                            labels[i], datasetName, histograms[i]->getCount(),
+                            histograms[i]->getPercentileNs(50),
+                            histograms[i]->getPercentileNs(99),
+                            histograms[i]->getPercentileNs(99.9),
+                            histograms[i]->getMaxNs());
+                }
+            }
+            histograms[i]->reset();
+        }
+    }
+
+    /**
+ * Runs the compression algorithms, prints out and returns the Result.
+ *
+ * @param datasetName
+ *      Name of the uncompressed dataset
+ *
+ * @param rawDataLength
+ *      Length of the data contained within the internal rawDataBuffer
+ *
+ * @param numLogStatements
  *      Number of log statements contained within the rawDataBuffer
  *
  * @param runMemcpy
@@ -561,17 +2238,126 @@ private:
                         bool runGzip = true,
                         bool runNanoLog = true)
     {
+        if (!batchSizes.empty()) {
+            runBatchSweep(datasetName, rawDataLength);
+            return {};
+        }
+
+        for (int i = 0; i < warmups; ++i) {
+            runCompressionAlgosOnce(datasetName, rawDataLength,
+                                    numLogStatements, runMemcpy, runSnappy,
+                                    runGzip, runNanoLog);
+        }
+
+        // Every trial runs the same algorithms in the same order
+        std::vector<std::vector<Result>> trialResults;
+        for (int i = 0; i < trials; ++i) {
+            trialResults.push_back(runCompressionAlgosOnce(datasetName,
+                    rawDataLength, numLogStatements, runMemcpy, runSnappy,
+                    runGzip, runNanoLog));
+        }
+
+        std::vector<Result> results;
+        for (size_t i = 0; i < trialResults.front().size(); ++i) {
+            std::vector<Result> algorithmTrials;
+            for (std::vector<Result> &trial : trialResults)
+                algorithmTrials.push_back(trial[i]);
+
+            results.push_back(combineTrials(algorithmTrials));
+            for (const Output &output : outputs)
+                results.back().print(output, perfCounters.isOpen());
+
+            const Result &result = results.back();
+            if (bandwidthModel != nullptr) {
+                bandwidthModel->addResult(result.algorithm, result.dataset,
+                        PerfUtils::Cycles::toSeconds(result.compressionCycles),
+                        result.outputBytes);
+            }
+        }
+
+        if (sink.isOpen())
+            runSinkStage(datasetName, rawDataLength);
+
+        for (const Output &output : outputs) {
+            if (output.format == FORMAT_TABLE)
+                fprintf(output.file, "\r\n");
+        }
+        return results;
+    }
+
+    /**
+     * Combines the Results of an algorithm's trials into one whose cycle
+     * counts are the medians of the trials' and which records every trial's
+     * times for their statistics. Its performance counts are those of the
+     * trial with the median compression time.
+     *
+     * \param algorithmTrials
+     *      Results of the trials of one algorithm on one dataset
+     */
+    static Result
+    combineTrials(const std::vector<Result> &algorithmTrials)
+    {
+        Result combined = algorithmTrials.front();
+        std::vector<double> compressionCycles, decompressionCycles;
+        for (const Result &trial : algorithmTrials) {
+            compressionCycles.push_back(trial.compressionCycles);
+            decompressionCycles.push_back(trial.decompressionCycles);
+            combined.compressionTrials.push_back(
+                    Cycles::toSeconds(trial.compressionCycles));
+            combined.decompressionTrials.push_back(
+                    Cycles::toSeconds(trial.decompressionCycles));
+        }
+
+        combined.compressionCycles = static_cast<uint64_t>(
+                SampleStatistics(compressionCycles).getMedian() + 0.5);
+
+        // Take the performance counts of the (lower) median trial as a whole
+        // so that the ratios between them stay meaningful
+        std::vector<const Result*> byCompressionCycles;
+        for (const Result &trial : algorithmTrials)
+            byCompressionCycles.push_back(&trial);
+        std::sort(byCompressionCycles.begin(), byCompressionCycles.end(),
+                  [](const Result *a, const Result *b) {
+                      return a->compressionCycles < b->compressionCycles;
+                  });
+        combined.counters =
+                byCompressionCycles[(algorithmTrials.size() - 1)/2]->counters;
+        combined.decompressionCycles = static_cast<uint64_t>(
+                SampleStatistics(decompressionCycles).getMedian() + 0.5);
+        return combined;
+    }
 
+    /**
+     * Runs every selected compression algorithm on the dataset once and
+     * returns their Results without printing them; the parameters are the
+     * same as runCompressionAlgos()'s.
+     */
+    std::vector<Result>
+    runCompressionAlgosOnce(const char *datasetName,
+                            unsigned long rawDataLength,
+                            uint32_t numLogStatements,
+                            bool runMemcpy,
+                            bool runSnappy,
+                            bool runGzip,
+                            bool runNanoLog)
+    {
         char testName[100];
         int gzipCompressionLevels[] = {1, 6, 9};
 
         std::vector<Result> results;
         uint64_t start, stop, firstCompressionCycles, secondCompressionCycles;
+        uint64_t decompressionCycles;
         uint64_t compressedLength;
+        PerfCounts perfStart, firstCounters, secondCounters;
 
         if (runGzip) {
             for (int level : gzipCompressionLevels) {
+                if (!isSelectedWithChains("gzip," + std::to_string(level),
+                                          "gzip," + std::to_string(level)))
+                    continue;
+
                 bzero(compressedOutputBuffer, compressedBufferSize);
+                perfStart = perfCounters.read();
                 start = Cycles::rdtsc();
                 compressedLength = compressedBufferSize;
 
@@ -580,6 +2366,7 @@ private:
                                        level);
                 stop = Cycles::rdtsc();
                 firstCompressionCycles = stop - start;
+                firstCounters = perfCounters.read() - perfStart;
 
                 snprintf(testName, sizeof(testName), "gzip,%d", level);
 
@@ -589,15 +2376,21 @@ private:
                             testName, datasetName, retVal);
                 }
 
+                decompressionCycles = decompressAndVerify(testName,
+                        datasetName, rawDataLength, compressedOutputBuffer,
+                        compressedLength, uncompress);
+
                 Result r(testName, datasetName, rawDataLength, compressedLength,
-                         numLogStatements, firstCompressionCycles);
-                r.print();
-                results.push_back(r);
+                         numLogStatements, firstCompressionCycles,
+                         decompressionCycles, firstCounters);
+                report(r, results);
 
-                if (runSnappy) {
+                snprintf(testName, sizeof(testName), "gzip,%d+s", level);
+                if (runSnappy && isSelected(testName)) {
                     unsigned long int snappyOutputBytes = compressedBufferSize;
                     bzero(doubleCompressedOutputBuffer, compressedBufferSize);
 
+                    perfStart = perfCounters.read();
                     start = Cycles::rdtsc();
                     snappy::RawCompress((char *) compressedOutputBuffer,
                                         compressedLength,
@@ -606,35 +2399,47 @@ private:
                     stop = Cycles::rdtsc();
                     secondCompressionCycles =
                             firstCompressionCycles + stop - start;
+                    secondCounters = firstCounters +
+                            (perfCounters.read() - perfStart);
 
-                    snprintf(testName, sizeof(testName), "gzip,%d+s", level);
+                    decompressionCycles = decompressAndVerify(testName,
+                            datasetName, rawDataLength,
+                            doubleCompressedOutputBuffer, snappyOutputBytes,
+                            snappyUncompress, uncompress);
 
                     Result r(testName, datasetName, rawDataLength,
                              snappyOutputBytes, numLogStatements,
-                             secondCompressionCycles);
-                    r.print();
-                    results.push_back(r);
+                             secondCompressionCycles, decompressionCycles,
+                             secondCounters);
+                    report(r, results);
                 }
             }
         }
 
         // Memcpy
-        if (runMemcpy) {
+        if (runMemcpy && isSelected("memcpy")) {
             bzero(compressedOutputBuffer, compressedBufferSize);
+            perfStart = perfCounters.read();
             start = Cycles::rdtsc();
             memcpy(compressedOutputBuffer, rawDataBuffer, rawDataLength);
             stop = Cycles::rdtsc();
             firstCompressionCycles = stop - start;
+            firstCounters = perfCounters.read() - perfStart;
+
+            decompressionCycles = decompressAndVerify("memcpy", datasetName,
+                    rawDataLength, compressedOutputBuffer, rawDataLength,
+                    memcpyUncompress);
 
             Result r("memcpy", datasetName, rawDataLength, rawDataLength,
-                     numLogStatements, firstCompressionCycles);
-            r.print();
-            results.push_back(r);
+                     numLogStatements, firstCompressionCycles,
+                     decompressionCycles, firstCounters);
+            report(r, results);
         }
 
         // Snappy
-        if (runSnappy) {
+        if (runSnappy && isSelectedWithChains("snappy", "s")) {
             bzero(compressedOutputBuffer, compressedBufferSize);
+            perfStart = perfCounters.read();
             start = Cycles::rdtsc();
             compressedLength = compressedBufferSize;
             snappy::RawCompress((char *) rawDataBuffer,
@@ -643,17 +2448,27 @@ private:
                                 &compressedLength);
             stop = Cycles::rdtsc();
             firstCompressionCycles = stop - start;
+            firstCounters = perfCounters.read() - perfStart;
+
+            decompressionCycles = decompressAndVerify("snappy", datasetName,
+                    rawDataLength, compressedOutputBuffer, compressedLength,
+                    snappyUncompress);
 
             Result r("snappy", datasetName, rawDataLength, compressedLength,
-                     numLogStatements, firstCompressionCycles);
-            r.print();
-            results.push_back(r);
+                     numLogStatements, firstCompressionCycles,
+                     decompressionCycles, firstCounters);
+            report(r, results);
 
             if (runGzip) {
                 for (int level : gzipCompressionLevels) {
+                    snprintf(testName, sizeof(testName), "s+gzip,%d", level);
+                    if (!isSelected(testName))
+                        continue;
+
                     unsigned long int gzipOutputBytes = compressedBufferSize;
                     bzero(doubleCompressedOutputBuffer, compressedBufferSize);
 
+                    perfStart = perfCounters.read();
                     start = Cycles::rdtsc();
                     int retVal = compress2(doubleCompressedOutputBuffer,
                                            &gzipOutputBytes,
@@ -663,8 +2478,8 @@ private:
                     stop = Cycles::rdtsc();
                     secondCompressionCycles =
                             firstCompressionCycles + stop - start;
-
-                    snprintf(testName, sizeof(testName), "s+gzip,%d", level);
+                    secondCounters = firstCounters +
+                            (perfCounters.read() - perfStart);
 
                     if (retVal != Z_OK) {
                         fprintf(stderr,
@@ -673,100 +2488,1638 @@ private:
                                 testName, datasetName, retVal);
                     }
 
+                    decompressionCycles = decompressAndVerify(testName,
+                            datasetName, rawDataLength,
+                            doubleCompressedOutputBuffer, gzipOutputBytes,
+                            uncompress, snappyUncompress);
+
                     Result r(testName, datasetName, rawDataLength,
                              gzipOutputBytes, numLogStatements,
-                             secondCompressionCycles);
-                    r.print();
-                    results.push_back(r);
+                             secondCompressionCycles, decompressionCycles,
+                             secondCounters);
+                    report(r, results);
                 }
             }
         }
 
 
         if (runNanoLog) {
-            bzero(compressedOutputBuffer, compressedBufferSize);
-            start = Cycles::rdtsc();
-            compressedLength = compressedBufferSize;
-            NanoLogCompress2(compressedOutputBuffer, &compressedLength,
-                             rawDataBuffer, rawDataLength);
-            stop = Cycles::rdtsc();
-            firstCompressionCycles = stop - start;
-
-            Result r("NanoLog", datasetName, rawDataLength, compressedLength,
-                     numLogStatements, firstCompressionCycles);
-            r.print();
-            results.push_back(r);
-
-            if (runSnappy) {
-                unsigned long int snappyOutputBytes = compressedBufferSize;
-                bzero(doubleCompressedOutputBuffer, compressedBufferSize);
-
+            // Plain NanoLog, its decoders and the algorithms chained after it
+            if (isSelectedWithChains("NanoLog", "NL") ||
+                    isSelected("NanoLog-decomp") ||
+                    isSelected("NanoLog-decsimd")) {
+                bzero(compressedOutputBuffer, compressedBufferSize);
+                perfStart = perfCounters.read();
                 start = Cycles::rdtsc();
-                snappy::RawCompress((char *) compressedOutputBuffer,
-                                    compressedLength,
-                                    (char *) doubleCompressedOutputBuffer,
-                                    &snappyOutputBytes);
+                compressedLength = compressedBufferSize;
+                NanoLogCompress2(compressedOutputBuffer, &compressedLength,
+                                 rawDataBuffer, rawDataLength);
                 stop = Cycles::rdtsc();
-                secondCompressionCycles = firstCompressionCycles + stop - start;
-
-                Result r("NL+snappy", datasetName, rawDataLength,
-                         snappyOutputBytes, numLogStatements,
-                         secondCompressionCycles);
-                r.print();
-                results.push_back(r);
-            }
-
-            if (runGzip) {
-                for (int level : gzipCompressionLevels) {
-                    unsigned long int gzipOutputBytes = compressedBufferSize;
-                    bzero(doubleCompressedOutputBuffer, compressedBufferSize);
-
+                firstCompressionCycles = stop - start;
+                firstCounters = perfCounters.read() - perfStart;
+
+                decompressionCycles = decompressAndVerify("NanoLog", datasetName,
+                        rawDataLength, compressedOutputBuffer, compressedLength,
+                        NanoLogUncompress);
+
+                Result r("NanoLog", datasetName, rawDataLength, compressedLength,
+                         numLogStatements, firstCompressionCycles,
+                         decompressionCycles, firstCounters);
+                report(r, results);
+
+                // Decoding the NanoLog output back into memory; the processing
+                // rate is reported relative to the uncompressed data size. The
+                // second pass unpacks the int/long arguments with the SimdPacker
+                // kernels.
+                for (bool vectorized : {false, true}) {
+                    const char *algorithm = vectorized ? "NanoLog-decsimd"
+                                                       : "NanoLog-decomp";
+                    if (!isSelected(algorithm))
+                        continue;
+
+                    NanoLogDecoder decoder((const char*)compressedOutputBuffer,
+                                           compressedLength, vectorized);
+                    DecodedEntry entry;
+                    uint32_t numDecoded = 0;
+
+                    perfStart = perfCounters.read();
                     start = Cycles::rdtsc();
-                    int retVal = compress2(doubleCompressedOutputBuffer,
-                                           &gzipOutputBytes,
-                                           compressedOutputBuffer,
-                                           compressedLength,
-                                           level);
+                    while (decoder.next(&entry))
+                        ++numDecoded;
                     stop = Cycles::rdtsc();
-                    secondCompressionCycles =
-                            firstCompressionCycles + stop - start;
-
-                    snprintf(testName, sizeof(testName), "NL+gzip,%d", level);
+                    PerfCounts decodeCounters = perfCounters.read() - perfStart;
 
-                    if (retVal != Z_OK) {
-                        fprintf(stderr,
-                                "Compression scheme %s with input \"%s\" "
-                                        "failed with error code %d\r\n",
-                                testName, datasetName, retVal);
+                    if (decoder.isMalformed() || numDecoded != numLogStatements) {
+                        fprintf(stderr, "%s decoding of input \"%s\" failed; "
+                                "decoded %u of %u entries\r\n", algorithm,
+                                datasetName, numDecoded, numLogStatements);
                     }
 
-                    Result r(testName, datasetName, rawDataLength,
-                             gzipOutputBytes, numLogStatements,
-                             secondCompressionCycles);
-                    r.print();
-                    results.push_back(r);
+                    Result r(algorithm, datasetName, rawDataLength,
+                             compressedLength, numLogStatements, stop - start,
+                             stop - start, decodeCounters);
+                    report(r, results);
                 }
+
+                runChainedAlgos("NL", datasetName, rawDataLength,
+                                numLogStatements, compressedLength,
+                                firstCompressionCycles, firstCounters,
+                                NanoLogUncompress, runSnappy, runGzip,
+                                results);
+            }
+
+            // Streaming NanoLog, which is fed the input in staging buffer
+            // sized pieces and only given a bounded output window at a time
+            if (isSelected("NanoLog-stream")) {
+                bzero(compressedOutputBuffer, compressedBufferSize);
+                perfStart = perfCounters.read();
+                start = Cycles::rdtsc();
+                int retVal = streamCompress(rawDataLength, &compressedLength);
+                stop = Cycles::rdtsc();
+                firstCompressionCycles = stop - start;
+                firstCounters = perfCounters.read() - perfStart;
+
+                if (retVal != Z_STREAM_END) {
+                    fprintf(stderr,
+                            "Compression scheme %s with input \"%s\" "
+                                    "failed with error code %d\r\n",
+                            "NanoLog-stream", datasetName, retVal);
+                }
+
+                decompressionCycles = decompressAndVerify("NanoLog-stream",
+                        datasetName, rawDataLength, compressedOutputBuffer,
+                        compressedLength, NanoLogUncompress);
+
+                Result r("NanoLog-stream", datasetName, rawDataLength,
+                         compressedLength, numLogStatements,
+                         firstCompressionCycles, decompressionCycles,
+                         firstCounters);
+                report(r, results);
+            }
+
+            // Column-oriented NanoLog
+            if (isSelectedWithChains("NanoLog-col", "NLcol")) {
+                bzero(compressedOutputBuffer, compressedBufferSize);
+                perfStart = perfCounters.read();
+                start = Cycles::rdtsc();
+                compressedLength = compressedBufferSize;
+                int retVal = columnarCompressor.compress(compressedOutputBuffer,
+                                                         &compressedLength,
+                                                         rawDataBuffer,
+                                                         rawDataLength);
+                stop = Cycles::rdtsc();
+                firstCompressionCycles = stop - start;
+                firstCounters = perfCounters.read() - perfStart;
+
+                if (retVal != Z_OK) {
+                    fprintf(stderr,
+                            "Compression scheme %s with input \"%s\" "
+                                    "failed with error code %d\r\n",
+                            "NanoLog-col", datasetName, retVal);
+                }
+
+                decompressionCycles = decompressAndVerify("NanoLog-col",
+                        datasetName, rawDataLength, compressedOutputBuffer,
+                        compressedLength, ColumnarCompressor::uncompress);
+
+                Result r("NanoLog-col", datasetName, rawDataLength,
+                         compressedLength, numLogStatements,
+                         firstCompressionCycles, decompressionCycles,
+                         firstCounters);
+                report(r, results);
+
+                runChainedAlgos("NLcol", datasetName, rawDataLength,
+                                numLogStatements, compressedLength,
+                                firstCompressionCycles, firstCounters,
+                                ColumnarCompressor::uncompress,
+                                runSnappy, runGzip, results);
+            }
+
+            // NanoLog with int/long arguments delta encoded per slot
+            {
+                HistoryCompressor::Options options;
+                options.deltaIntegers = true;
+                runHistoryCompressor("NanoLog-delta", options, datasetName,
+                                     rawDataLength, numLogStatements, results);
+            }
+
+            // NanoLog with double arguments XOR encoded per slot
+            {
+                HistoryCompressor::Options options;
+                options.xorDoubles = true;
+                runHistoryCompressor("NanoLog-xor", options, datasetName,
+                                     rawDataLength, numLogStatements, results);
+            }
+
+            // NanoLog with recently seen strings replaced by references
+            {
+                HistoryCompressor::Options options;
+                options.stringDictionary = true;
+                runHistoryCompressor("NanoLog-dict", options, datasetName,
+                                     rawDataLength, numLogStatements, results);
+            }
+
+            // NanoLog with the int/long arguments packed by vector kernels
+            if (isSelected("NanoLog-simd")) {
+                bzero(compressedOutputBuffer, compressedBufferSize);
+                perfStart = perfCounters.read();
+                start = Cycles::rdtsc();
+                compressedLength = compressedBufferSize;
+                int retVal = SimdPacker::compress(compressedOutputBuffer,
+                                                  &compressedLength,
+                                                  rawDataBuffer,
+                                                  rawDataLength);
+                stop = Cycles::rdtsc();
+                firstCompressionCycles = stop - start;
+                firstCounters = perfCounters.read() - perfStart;
+
+                if (retVal != Z_OK) {
+                    fprintf(stderr,
+                            "Compression scheme %s with input \"%s\" "
+                                    "failed with error code %d\r\n",
+                            "NanoLog-simd", datasetName, retVal);
+                }
+
+                decompressionCycles = decompressAndVerify("NanoLog-simd",
+                        datasetName, rawDataLength, compressedOutputBuffer,
+                        compressedLength, SimdPacker::uncompress);
+
+                Result r("NanoLog-simd", datasetName, rawDataLength,
+                         compressedLength, numLogStatements,
+                         firstCompressionCycles, decompressionCycles,
+                         firstCounters);
+                report(r, results);
+            }
+
+            // NanoLog with every entry compacted by the compressEntry()
+            // instantiation for its argument signature rather than the loops
+            // of NanoLogCompress2() (i.e. the "NanoLog" row)
+            if (isSelected("NanoLog-spec")) {
+                bzero(compressedOutputBuffer, compressedBufferSize);
+                perfStart = perfCounters.read();
+                start = Cycles::rdtsc();
+                compressedLength = compressedBufferSize;
+                int retVal = Specialized::compress(compressedOutputBuffer,
+                                                   &compressedLength,
+                                                   rawDataBuffer,
+                                                   rawDataLength);
+                stop = Cycles::rdtsc();
+                firstCompressionCycles = stop - start;
+                firstCounters = perfCounters.read() - perfStart;
+
+                if (retVal != Z_OK) {
+                    fprintf(stderr,
+                            "Compression scheme %s with input \"%s\" "
+                                    "failed with error code %d\r\n",
+                            "NanoLog-spec", datasetName, retVal);
+                }
+
+                decompressionCycles = decompressAndVerify("NanoLog-spec",
+                        datasetName, rawDataLength, compressedOutputBuffer,
+                        compressedLength, NanoLogUncompress);
+
+                Result r("NanoLog-spec", datasetName, rawDataLength,
+                         compressedLength, numLogStatements,
+                         firstCompressionCycles, decompressionCycles,
+                         firstCounters);
+                report(r, results);
+            }
+
+            // Multi-threaded NanoLog, scaling over the thread counts
+            for (int numThreads : threadCounts) {
+                snprintf(testName, sizeof(testName), "NanoLog-MT,%d",
+                         numThreads);
+                if (!isSelected(testName))
+                    continue;
+
+                // No performance counts are reported since the counters only
+                // follow this thread, not the workers doing the compression
+                bzero(compressedOutputBuffer, compressedBufferSize);
+                start = Cycles::rdtsc();
+                compressedLength = compressedBufferSize;
+                int retVal = parallelCompressor.compress(compressedOutputBuffer,
+                                                         &compressedLength,
+                                                         rawDataBuffer,
+                                                         rawDataLength,
+                                                         numThreads);
+                stop = Cycles::rdtsc();
+                firstCompressionCycles = stop - start;
+
+                if (retVal != Z_OK) {
+                    fprintf(stderr,
+                            "Compression scheme %s with input \"%s\" "
+                                    "failed with error code %d\r\n",
+                            testName, datasetName, retVal);
+                }
+
+                decompressionCycles = decompressAndVerify(testName,
+                        datasetName, rawDataLength, compressedOutputBuffer,
+                        compressedLength, ParallelCompressor::uncompress);
+
+                Result r(testName, datasetName, rawDataLength,
+                         compressedLength, numLogStatements,
+                         firstCompressionCycles, decompressionCycles);
+                report(r, results);
             }
         }
 
-        printf("\r\n");
         return results;
     }
 
+    /**
+     * Compresses the rawDataBuffer with a HistoryCompressor into the
+     * compressedOutputBuffer, verifies that it decompresses back to the
+     * rawDataBuffer and records the Result under the algorithm name.
+     *
+     * \param algorithm
+     *      Name to record the Result under
+     * \param options
+     *      Argument codecs the HistoryCompressor should use
+     * \param datasetName
+     *      Name of the uncompressed dataset
+     * \param rawDataLength
+     *      Length of the data contained within the internal rawDataBuffer
+     * \param numLogStatements
+     *      Number of log statements contained within the rawDataBuffer
+     * \param[out] results
+     *      Result is appended here
+     */
+    void
+    runHistoryCompressor(const char *algorithm,
+                         const HistoryCompressor::Options &options,
+                         const char *datasetName, unsigned long rawDataLength,
+                         int numLogStatements, std::vector<Result> &results)
+    {
+        if (!isSelected(algorithm))
+            return;
+
+        HistoryCompressor compressor(options);
+
+        bzero(compressedOutputBuffer, compressedBufferSize);
+        PerfCounts perfStart = perfCounters.read();
+        uint64_t start = Cycles::rdtsc();
+        uint64_t compressedLength = compressedBufferSize;
+        int retVal = compressor.compress(compressedOutputBuffer,
+                                         &compressedLength,
+                                         rawDataBuffer, rawDataLength);
+        uint64_t stop = Cycles::rdtsc();
+        PerfCounts counters = perfCounters.read() - perfStart;
+
+        if (retVal != Z_OK) {
+            fprintf(stderr,
+                    "Compression scheme %s with input \"%s\" "
+                            "failed with error code %d\r\n",
+                    algorithm, datasetName, retVal);
+        }
+
+        uint64_t decompressionCycles = decompressAndVerify(algorithm,
+                datasetName, rawDataLength, compressedOutputBuffer,
+                compressedLength,
+                [&compressor](unsigned char *dest, unsigned long *destLen,
+                              const unsigned char *source,
+                              unsigned long sourceLen) {
+                    return compressor.uncompress(dest, destLen,
+                                                 source, sourceLen);
+                });
+
+        Result r(algorithm, datasetName, rawDataLength, compressedLength,
+                 numLogStatements, stop - start, decompressionCycles, counters);
+        report(r, results);
+    }
+
+    /**
+     * Runs snappy and gzip 1,6,9 a second time over the output of a NanoLog
+     * variant stored in the compressedOutputBuffer and records the Result(s)
+     * under the names "<prefix>+snappy" and "<prefix>+gzip,<level>".
+     *
+     * \param prefix
+     *      Short name of the NanoLog variant (e.g. "NL")
+     * \param datasetName
+     *      Name of the uncompressed dataset
+     * \param rawDataLength
+     *      Length of the data contained within the internal rawDataBuffer
+     * \param numLogStatements
+     *      Number of log statements contained within the rawDataBuffer
+     * \param compressedLength
+     *      Length of the NanoLog variant's output in compressedOutputBuffer
+     * \param firstCompressionCycles
+     *      Cycles spent by the NanoLog variant
+     * \param firstCounters
+     *      Performance counts of the NanoLog variant
+     * \param firstStage
+     *      Decompression function for the NanoLog variant
+     * \param runSnappy
+     *      True runs the snappy algorithm as the second stage
+     * \param runGzip
+     *      True runs the gzip1,6,9 algorithms as the second stage
+     * \param[out] results
+     *      Result(s) are appended here
+     */
+    void
+    runChainedAlgos(const char *prefix, const char *datasetName,
+                    unsigned long rawDataLength, uint32_t numLogStatements,
+                    uint64_t compressedLength, uint64_t firstCompressionCycles,
+                    const PerfCounts &firstCounters, UncompressFn firstStage,
+                    bool runSnappy, bool runGzip, std::vector<Result> &results)
+    {
+        char testName[100];
+        int gzipCompressionLevels[] = {1, 6, 9};
+        uint64_t start, stop, secondCompressionCycles, decompressionCycles;
+        PerfCounts perfStart, secondCounters;
+
+        snprintf(testName, sizeof(testName), "%s+snappy", prefix);
+        if (runSnappy && isSelected(testName)) {
+            unsigned long int snappyOutputBytes = compressedBufferSize;
+            bzero(doubleCompressedOutputBuffer, compressedBufferSize);
+
+            perfStart = perfCounters.read();
+            start = Cycles::rdtsc();
+            snappy::RawCompress((char *) compressedOutputBuffer,
+                                compressedLength,
+                                (char *) doubleCompressedOutputBuffer,
+                                &snappyOutputBytes);
+            stop = Cycles::rdtsc();
+            secondCompressionCycles = firstCompressionCycles + stop - start;
+            secondCounters = firstCounters +
+                    (perfCounters.read() - perfStart);
+
+            decompressionCycles = decompressAndVerify(testName,
+                    datasetName, rawDataLength,
+                    doubleCompressedOutputBuffer, snappyOutputBytes,
+                    snappyUncompress, firstStage);
+
+            Result r(testName, datasetName, rawDataLength,
+                     snappyOutputBytes, numLogStatements,
+                     secondCompressionCycles, decompressionCycles,
+                     secondCounters);
+            report(r, results);
+        }
+
+        if (runGzip) {
+            for (int level : gzipCompressionLevels) {
+                snprintf(testName, sizeof(testName), "%s+gzip,%d",
+                         prefix, level);
+                if (!isSelected(testName))
+                    continue;
+
+                unsigned long int gzipOutputBytes = compressedBufferSize;
+                bzero(doubleCompressedOutputBuffer, compressedBufferSize);
+
+                perfStart = perfCounters.read();
+                start = Cycles::rdtsc();
+                int retVal = compress2(doubleCompressedOutputBuffer,
+                                       &gzipOutputBytes,
+                                       compressedOutputBuffer,
+                                       compressedLength,
+                                       level);
+                stop = Cycles::rdtsc();
+                secondCompressionCycles =
+                        firstCompressionCycles + stop - start;
+                secondCounters = firstCounters +
+                        (perfCounters.read() - perfStart);
+
+                if (retVal != Z_OK) {
+                    fprintf(stderr,
+                            "Compression scheme %s with input \"%s\" "
+                                    "failed with error code %d\r\n",
+                            testName, datasetName, retVal);
+                }
+
+                decompressionCycles = decompressAndVerify(testName,
+                        datasetName, rawDataLength,
+                        doubleCompressedOutputBuffer, gzipOutputBytes,
+                        uncompress, firstStage);
+
+                Result r(testName, datasetName, rawDataLength,
+                         gzipOutputBytes, numLogStatements,
+                         secondCompressionCycles, decompressionCycles,
+                         secondCounters);
+                report(r, results);
+            }
+        }
+    }
+
+    /**
+     * Decompresses the output of a compression algorithm (or a chain of two)
+     * back into the decompressedBuffer, times it, and verifies that the
+     * result is byte-for-byte identical to the data in the rawDataBuffer.
+     * Failures are reported to stderr.
+     *
+     * \param algorithm
+     *      Name of the compression algorithm (used for printing)
+     * \param datasetName
+     *      Name of the uncompressed dataset (used for printing)
+     * \param rawDataLength
+     *      Length of the data contained within the internal rawDataBuffer
+     * \param compressed
+     *      Buffer containing the compressed data
+     * \param compressedLength
+     *      Length of the compressed data
+     * \param lastStage
+     *      Decompression function for the compression applied last
+     * \param firstStage
+     *      Decompression function for the compression applied first when
+     *      two algorithms were chained, or nullptr otherwise
+     *
+     * \return
+     *      Number of Cycles::rdtsc() cycles required to decompress the data
+     */
+    uint64_t
+    decompressAndVerify(const char *algorithm, const char *datasetName,
+                        unsigned long rawDataLength,
+                        const unsigned char *compressed,
+                        unsigned long compressedLength,
+                        UncompressFn lastStage,
+                        UncompressFn firstStage = nullptr)
+    {
+        unsigned long intermediateLength = compressedBufferSize;
+        unsigned long decompressedLength = rawBufferSize;
+        int retVal = Z_OK;
+
+        uint64_t start = Cycles::rdtsc();
+        if (firstStage == nullptr) {
+            retVal = lastStage(decompressedBuffer, &decompressedLength,
+                               compressed, compressedLength);
+        } else {
+            retVal = lastStage(intermediateBuffer, &intermediateLength,
+                               compressed, compressedLength);
+            if (retVal == Z_OK)
+                retVal = firstStage(decompressedBuffer, &decompressedLength,
+                                    intermediateBuffer, intermediateLength);
+        }
+        uint64_t stop = Cycles::rdtsc();
+
+        if (retVal != Z_OK) {
+            fprintf(stderr, "Decompression scheme %s with input \"%s\" "
+                            "failed with error code %d\r\n",
+                    algorithm, datasetName, retVal);
+        } else if (decompressedLength != rawDataLength ||
+                   memcmp(decompressedBuffer, rawDataBuffer, rawDataLength)) {
+            fprintf(stderr, "Decompression scheme %s with input \"%s\" "
+                            "did not reproduce the original data\r\n",
+                    algorithm, datasetName);
+        }
+
+        return stop - start;
+    }
+
+    /**
+     * Compresses the rawDataBuffer with a NanoLogStream into the
+     * compressedOutputBuffer, feeding it STREAM_INPUT_CHUNK bytes of input at
+     * a time and giving it at most STREAM_OUTPUT_WINDOW bytes of output space
+     * per call to model draining log staging buffers into a fixed size
+     * output buffer.
+     *
+     * \param rawDataLength
+     *      Length of the data contained within the internal rawDataBuffer
+     * \param[out] compressedLength
+     *      Number of bytes output to the compressedOutputBuffer
+     *
+     * \return
+     *      Z_STREAM_END on success, otherwise the NanoLogStream error code
+     */
+    int streamCompress(unsigned long rawDataLength,
+                       uint64_t *compressedLength)
+    {
+        NanoLogStream stream;
+        const unsigned char *readPos = rawDataBuffer;
+        const unsigned char *endOfInput = rawDataBuffer + rawDataLength;
+        unsigned char *endOfOutput = compressedOutputBuffer +
+                                                        compressedBufferSize;
+        int retVal = Z_OK;
+
+        stream.nextOut = compressedOutputBuffer;
+        while (readPos < endOfInput) {
+            stream.nextIn = readPos;
+            stream.availIn = std::min<uint64_t>(STREAM_INPUT_CHUNK,
+                                                endOfInput - readPos);
+            readPos += stream.availIn;
+
+            while (stream.availIn > 0) {
+                stream.availOut = std::min<uint64_t>(STREAM_OUTPUT_WINDOW,
+                                                endOfOutput - stream.nextOut);
+                retVal = stream.compress();
+                if (retVal != Z_OK)
+                    return retVal;
+            }
+        }
+
+        do {
+            stream.availOut = std::min<uint64_t>(STREAM_OUTPUT_WINDOW,
+                                                endOfOutput - stream.nextOut);
+            retVal = stream.flush();
+        } while (retVal == Z_OK);
+
+        *compressedLength = stream.totalOut;
+        return retVal;
+    }
+
 public:
 
     // Maximum number of int/long/double arguments allowed in the log statements
-    static const unsigned int MAX_ARGS = 50;
+    static const int MAX_ARGS = 50;
+
+    // Only one in this many log statements has its latency measured
+    static const uint64_t LATENCY_SAMPLE_PERIOD = 16;
+
+    // Each batch size is measured for at least this long per algorithm
+    static constexpr double SWEEP_MIN_SECONDS = 0.1;
+
+    // Batches smaller than this are compressed repeatedly between timer
+    // reads so that reading the timer doesn't dominate
+    static const uint64_t SWEEP_MIN_BYTES_TIMED = 64*1024;
+
+    // Bytes of log entries the sink stage compresses at a time (see
+    // runSinkStage())
+    static const uint64_t SINK_SLICE_SIZE = 1024*1024;
+
+    // The sink stage reports no overlap when the shorter of the median
+    // compute and write phases is under this long, or under this fraction
+    // of the longer one, since timer noise or the longer phase's jitter
+    // would dominate its ratio
+    static constexpr double SINK_MIN_PHASE_SECONDS = 0.005;
+    static constexpr double SINK_MIN_PHASE_FRACTION = 0.1;
+
+    // Size of the regions of rawDataBuffer that datasets are generated into
+    // in parallel. It's fixed so that the generated datasets don't depend on
+    // the number of threads.
+    static const uint64_t GENERATION_REGION_SIZE = 4*1024*1024;
+
+    // Number of bytes of input the NanoLogStream is fed at a time
+    static const unsigned long int STREAM_INPUT_CHUNK = 64*1024;
+
+    // Maximum number of bytes the NanoLogStream may output in one call
+    static const unsigned long int STREAM_OUTPUT_WINDOW = 64*1024;
 };
 
+// Number of log statements each producer records in the staging benchmark
+static const uint64_t STAGING_LOGS_PER_PRODUCER = 8*1024*1024;
+
+/**
+ * Models NanoLog's production setup: numProducers threads record log entries
+ * into their own StagingBuffers while a BackgroundCompressor thread drains
+ * and compacts them. Prints the end-to-end logging rate (from the first log
+ * recorded until the last one is compacted), the average time the
+ * producers spent per log statement and the percentiles of a sample of the
+ * individual log statements' latencies.
+ *
+ * \param numProducers
+ *      Number of producer threads to spawn
+ * \param logsPerProducer
+ *      Number of log statements each producer records
+ */
+static void
+runStagingBenchmark(int numProducers, uint64_t logsPerProducer)
+{
+    using PerfUtils::Cycles;
+
+    const uint64_t stagingBufferSize = 1024*1024;
+    BackgroundCompressor compressor(stagingBufferSize, 4*stagingBufferSize);
+
+    std::vector<StagingBuffer*> stagingBuffers;
+    for (int i = 0; i < numProducers; ++i)
+        stagingBuffers.push_back(compressor.registerProducer());
+
+    std::atomic<bool> go(false);
+    std::vector<uint64_t> producerCycles(numProducers, 0);
+    std::vector<LatencyHistogram> producerLatencies(numProducers);
+    std::vector<std::thread> producers;
+
+    for (int i = 0; i < numProducers; ++i) {
+        producers.emplace_back([&, i]() {
+            StagingBuffer *stagingBuffer = stagingBuffers[i];
+            LatencyHistogram &latencies = producerLatencies[i];
+            while (!go)
+                std::this_thread::yield();
+
+            // Two incrementing ints, like the "Incr Small 2 Int" dataset
+            uint64_t start = Cycles::rdtsc();
+            for (uint64_t n = 0; n < logsPerProducer; ++n) {
+                int args[2] = {static_cast<int>(n), static_cast<int>(n + i)};
+                if (n % BenchmarkRunner::LATENCY_SAMPLE_PERIOD != 0) {
+                    stagingBuffer->log(2, args);
+                    continue;
+                }
+
+                uint64_t logStart = Cycles::rdtsc();
+                stagingBuffer->log(2, args);
+                latencies.record(Cycles::rdtsc() - logStart);
+            }
+            producerCycles[i] = Cycles::rdtsc() - start;
+        });
+    }
+
+    uint64_t start = Cycles::rdtsc();
+    go = true;
+    for (std::thread &producer : producers)
+        producer.join();
+    compressor.sync();
+    uint64_t stop = Cycles::rdtsc();
+
+    uint64_t totalLogs = numProducers*logsPerProducer;
+    double elapsedTime = Cycles::toSeconds(stop - start);
+    double producerNs = 0;
+    for (uint64_t cycles : producerCycles)
+        producerNs += Cycles::toSeconds(cycles)*1e9/logsPerProducer;
+    producerNs /= numProducers;
+
+    LatencyHistogram latencies;
+    for (LatencyHistogram &producerLatency : producerLatencies)
+        latencies.merge(producerLatency);
+
+    uint64_t inputBytes = compressor.getBytesConsumed();
+    uint64_t outputBytes = compressor.getBytesOutput();
+    printf("%10d %12lu %12.6lf %12.3lf %15.2lf %10.1lf %10.1lf %10.1lf "
+           "%12.1lf %12lu %15lu %15lu %10.4lf\r\n",
+           numProducers, totalLogs, elapsedTime, totalLogs/(1e6*elapsedTime),
+           producerNs, latencies.getPercentileNs(50),
+           latencies.getPercentileNs(99), latencies.getPercentileNs(99.9),
+           latencies.getMaxNs(), compressor.getNumTimesProducerBlocked(),
+           inputBytes, outputBytes, (1.0*outputBytes)/inputBytes);
+}
+
+// Number of words/numbers drawn per configuration in the generator benchmark
+static const uint64_t GENERATOR_WORDS = 16*1024*1024;
+
+/**
+ * Measures how fast the RandomWordGenerator that the string datasets are
+ * built from produces words when limited to the top wordLimit words, which
+ * bounds how quickly those datasets can be generated.
+ *
+ * \param wordLimit
+ *      Number of most common words to draw from
+ * \param numWords
+ *      Number of words to draw
+ */
+static void
+runWordGeneratorBenchmark(long int wordLimit, uint64_t numWords)
+{
+    using PerfUtils::Cycles;
+
+    WordData::RandomWordGenerator rwg;
+    wordLimit = rwg.setWordLimit(wordLimit);
+
+    // Time building the alias table separately from drawing words
+    uint64_t start = Cycles::rdtsc();
+    uint64_t totalLength = strlen(rwg.getRandomWord());
+    uint64_t setupCycles = Cycles::rdtsc() - start;
+
+    start = Cycles::rdtsc();
+    for (uint64_t i = 1; i < numWords; ++i)
+        totalLength += strlen(rwg.getRandomWord());
+    uint64_t stop = Cycles::rdtsc();
+
+    double elapsedTime = Cycles::toSeconds(stop - start);
+    printf("%10ld %12lu %12.3lf %12.6lf %12.3lf %12.2lf %15.2lf\r\n",
+           wordLimit, numWords, Cycles::toSeconds(setupCycles)*1e3,
+           elapsedTime, (numWords - 1)/(1e6*elapsedTime),
+           elapsedTime*1e9/(numWords - 1), (1.0*totalLength)/numWords);
+}
+
+/**
+ * Measures how fast a ZipfianGenerator over n numbers produces them, which
+ * bounds how quickly the Zipfian datasets can be generated. The setup time
+ * is that of the first generator constructed for n, which computes the
+ * constants (and the alias table) that later ones reuse.
+ *
+ * \param n
+ *      Range of the numbers to draw
+ * \param numSamples
+ *      Number of numbers to draw
+ */
+static void
+runZipfianBenchmark(uint64_t n, uint64_t numSamples)
+{
+    using PerfUtils::Cycles;
+
+    uint64_t start = Cycles::rdtsc();
+    ZipfianGenerator zf(n);
+    uint64_t setupCycles = Cycles::rdtsc() - start;
+
+    // Summed so the samples can't be optimized away
+    uint64_t sum = 0;
+    start = Cycles::rdtsc();
+    for (uint64_t i = 0; i < numSamples; ++i)
+        sum += zf.nextNumber();
+    uint64_t stop = Cycles::rdtsc();
+
+    double elapsedTime = Cycles::toSeconds(stop - start);
+    printf("%10lu %12lu %12.3lf %12.6lf %12.3lf %12.2lf %15.2lf %8s\r\n",
+           n, numSamples, Cycles::toSeconds(setupCycles)*1e3, elapsedTime,
+           numSamples/(1e6*elapsedTime), elapsedTime*1e9/numSamples,
+           (1.0*sum)/numSamples,
+           (n <= ZipfianGenerator::ALIAS_TABLE_MAX_N) ? "alias" : "ycsb");
+}
+
+// Default largest batch size of the sweep, i.e. the default -b. Its datasets
+// are always generated into a buffer at least this large, so that they're
+// the main benchmark's datasets however small a largest batch -b picks.
+static const uint64_t SWEEP_DEFAULT_MAX_BATCH_SIZE = 64*1024*1024;
+
+// Batch size the sweep starts doubling from
+static const uint64_t SWEEP_MIN_BATCH_SIZE = 4*1024;
+
+/**
+ * Parses a size in bytes with an optional K, M or G (binary) suffix.
+ *
+ * \param str
+ *      String to parse
+ *
+ * \return
+ *      The size, or 0 if the string isn't a valid size
+ */
+static uint64_t
+parseSize(const char *str)
+{
+    char *suffix;
+    uint64_t size = strtoull(str, &suffix, 10);
+    if (suffix == str)
+        return 0;
+
+    switch (*suffix) {
+        case 'k': case 'K': size <<= 10; ++suffix; break;
+        case 'm': case 'M': size <<= 20; ++suffix; break;
+        case 'g': case 'G': size <<= 30; ++suffix; break;
+        default: break;
+    }
+
+    return (*suffix == '\0') ? size : 0;
+}
+
+/**
+ * Splits a comma separated list.
+ *
+ * \param str
+ *      List to split
+ */
+static std::vector<std::string>
+splitList(const char *str)
+{
+    std::vector<std::string> items;
+    std::string item;
+    for (const char *c = str; ; ++c) {
+        if (*c == ',' || *c == '\0') {
+            if (!item.empty())
+                items.push_back(item);
+            item.clear();
+            if (*c == '\0')
+                break;
+        } else {
+            item += *c;
+        }
+    }
+
+    return items;
+}
+
+/**
+ * Splits a comma separated list of algorithm globs. Since the names of some
+ * algorithms contain a comma themselves (e.g. "gzip,6" or "NanoLog-MT,4"),
+ * an item starting with a digit or wildcard is joined back onto the item
+ * before it.
+ *
+ * \param str
+ *      List to split
+ */
+static std::vector<std::string>
+splitAlgorithmList(const char *str)
+{
+    std::vector<std::string> patterns;
+    for (const std::string &item : splitList(str)) {
+        bool isSuffix = !patterns.empty() &&
+                (isdigit(item[0]) || item[0] == '*' || item[0] == '?');
+        if (isSuffix)
+            patterns.back() += "," + item;
+        else
+            patterns.push_back(item);
+    }
+
+    return patterns;
+}
+
+/**
+ * Parses a comma separated list of positive integers.
+ *
+ * \param str
+ *      List to parse
+ * \param[out] values
+ *      Parsed integers
+ *
+ * \return
+ *      False if the list is empty or contains anything but positive integers
+ */
+static bool
+parseIntList(const char *str, std::vector<int> *values)
+{
+    values->clear();
+    for (const std::string &item : splitList(str)) {
+        char *end;
+        long value = strtol(item.c_str(), &end, 10);
+        if (*end != '\0' || value <= 0 || value > INT32_MAX)
+            return false;
+        values->push_back(static_cast<int>(value));
+    }
+
+    return !values->empty();
+}
+
+/**
+ * Returns the model name of the CPU from /proc/cpuinfo, or "unknown".
+ */
+static std::string
+getCpuModel()
+{
+    FILE *cpuinfo = fopen("/proc/cpuinfo", "r");
+    if (cpuinfo == nullptr)
+        return "unknown";
+
+    std::string model = "unknown";
+    char line[512];
+    while (fgets(line, sizeof(line), cpuinfo) != nullptr) {
+        const char *colon = strchr(line, ':');
+        if (strncmp(line, "model name", 10) != 0 || colon == nullptr)
+            continue;
+
+        model = colon + 1;
+        model.erase(0, model.find_first_not_of(" \t"));
+        model.erase(model.find_last_not_of(" \t\r\n") + 1);
+        break;
+    }
+
+    fclose(cpuinfo);
+    return model;
+}
+
+/**
+ * Prints the metadata of the run to every output, so that archived results
+ * can be compared across hosts and releases: the host, its CPU and kernel,
+ * the compiler and flags the benchmark was built with, its git revision,
+ * and the settings it was run with. The table and CSV get them as '#'
+ * comment lines, and JSON as a "run" record.
+ *
+ * \param argc
+ *      Number of command line arguments
+ * \param argv
+ *      Command line arguments
+ * \param bufferSize
+ *      Size of the datasets
+ * \param warmups
+ *      Number of untimed runs of each algorithm
+ * \param trials
+ *      Number of timed runs of each algorithm
+ */
+static void
+printRunMetadata(int argc, char **argv, uint64_t bufferSize, int warmups,
+                 int trials)
+{
+    char hostname[256] = "unknown";
+    gethostname(hostname, sizeof(hostname) - 1);
+
+    struct utsname kernel;
+    std::string kernelName = "unknown";
+    if (uname(&kernel) == 0)
+        kernelName = std::string(kernel.sysname) + " " + kernel.release;
+
+    char date[32];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    std::string command = argv[0];
+    for (int i = 1; i < argc; ++i)
+        command += std::string(" ") + argv[i];
+
+#ifdef __clang__
+    std::string compiler = "clang " __clang_version__;
+#else
+    std::string compiler = "gcc " __VERSION__;
+#endif
+
+    std::vector<std::pair<std::string, std::string>> metadata = {
+        {"date", date},
+        {"host", hostname},
+        {"cpu", getCpuModel()},
+        {"cores", std::to_string(std::thread::hardware_concurrency())},
+        {"kernel", kernelName},
+        {"compiler", compiler},
+        {"cxxflags", BuildInfo::CXXFLAGS},
+        {"git_hash", BuildInfo::GIT_HASH},
+        {"buffer_size", std::to_string(bufferSize)},
+        {"warmups", std::to_string(warmups)},
+        {"trials", std::to_string(trials)},
+        {"command", command},
+    };
+
+    for (const Output &output : outputs) {
+        if (output.format != FORMAT_JSON) {
+            for (auto &item : metadata) {
+                fprintf(output.file, "# %-12s %s\r\n", item.first.c_str(),
+                        item.second.c_str());
+            }
+            continue;
+        }
+
+        JsonObject record;
+        record.addString("type", "run");
+        for (auto &item : metadata)
+            record.addString(item.first.c_str(), item.second);
+        fprintf(output.file, "%s\n", record.str().c_str());
+    }
+}
+
+/**
+ * Flushes stdout and closes the other outputs.
+ */
+static void
+closeOutputs()
+{
+    for (const Output &output : outputs) {
+        if (output.file == stdout)
+            fflush(stdout);
+        else
+            fclose(output.file);
+    }
+}
+
+/**
+ * A subset of the datasets the bandwidth analysis reports on separately
+ */
+struct DatasetCategory {
+    // Name of the category, and of its files in the details directory
+    const char *name;
+
+    // fnmatch() pattern of the names of the category's datasets
+    const char *pattern;
+};
+
+static const DatasetCategory DATASET_CATEGORIES[] = {
+    {"all",         "*"},
+    {"e_rand",      "Rand*"},
+    {"e_incr",      "Incr*"},
+    {"s_small",     "*Small*"},
+    {"s_reg",       "*Reg*"},
+    {"s_big",       "*Big*"},
+    {"t_double",    "*Double*"},
+    {"t_int",       "*Int*"},
+    {"t_long",      "*Long*"},
+    {"t_string",    "*Chars*"},
+    {"w_ramcloud",  "RAMCloud*"},
+};
+
+// Algorithms the bandwidth analysis leaves out unless --algorithms selects
+// them (see BandwidthModel::selectAlgorithms()): compressing with gzip and
+// snappy both only shows what compressing twice costs, and the NanoLog
+// decoders are timed decompressing
+static const std::vector<std::string> UNANALYZED_ALGORITHMS = {
+    "!gzip,?+s", "!s+gzip,?", "!NanoLog-dec*"
+};
+
+// Directory the analyze mode writes the files gnuplot.gnuplot plots to
+static const char *DETAILS_DIRECTORY = "details";
+
+// Range of bandwidths in MB/s the details files cover
+static const double DETAILS_MIN_BANDWIDTH = 1;
+static const double DETAILS_MAX_BANDWIDTH = 100000;
+
+/**
+ * Prints which algorithms log the datasets of each DATASET_CATEGORIES
+ * fastest: the bandwidths from which a different algorithm wins the most
+ * datasets of the category, and how many datasets each algorithm wins at
+ * the device bandwidths along with the algorithm taking the least time to
+ * log all of them. The table gets these as lines of text, and JSON as
+ * "crossover" and "bandwidth" records.
+ *
+ * \param model
+ *      Results of the algorithms on the datasets
+ * \param bandwidths
+ *      Bandwidths in MB/s of the devices the logs could be written to
+ */
+static void
+printBandwidthAnalysis(const BandwidthModel &model,
+                       const std::vector<int> &bandwidths)
+{
+    std::vector<std::string> algorithms = model.getAlgorithms();
+    for (const DatasetCategory &category : DATASET_CATEGORIES) {
+        std::vector<std::string> datasets = model.getDatasets(category.pattern);
+        if (datasets.empty())
+            continue;
+
+        std::vector<BandwidthModel::Step> steps = model.getSteps(datasets);
+
+        // Wins and total times of every algorithm at each device bandwidth,
+        // and the algorithms winning the most and logging all the fastest
+        std::vector<std::vector<int>> wins;
+        std::vector<std::vector<double>> totals;
+        std::vector<int> leaders, fastest;
+        for (int bandwidth : bandwidths) {
+            wins.emplace_back(algorithms.size(), 0);
+            for (const std::string &dataset : datasets)
+                ++wins.back()[model.getWinner(dataset, bandwidth)];
+
+            totals.emplace_back();
+            for (const std::string &algorithm : algorithms) {
+                totals.back().push_back(model.getTotalTime(algorithm,
+                                                           datasets,
+                                                           bandwidth));
+            }
+
+            leaders.push_back(std::max_element(wins.back().begin(),
+                                               wins.back().end()) -
+                              wins.back().begin());
+            fastest.push_back(std::min_element(totals.back().begin(),
+                                               totals.back().end()) -
+                              totals.back().begin());
+        }
+
+        for (const Output &output : outputs) {
+            FILE *out = output.file;
+            if (output.format == FORMAT_CSV)
+                continue;
+
+            if (output.format == FORMAT_TABLE) {
+                fprintf(out, "# Bandwidth analysis of %s (%lu datasets)\r\n",
+                        category.name, datasets.size());
+            }
+
+            int leader = -1;
+            for (const BandwidthModel::Step &step : steps) {
+                if (step.leader == leader)
+                    continue;
+
+                leader = step.leader;
+                double winRate = 100.0*step.wins[leader]/datasets.size();
+                if (output.format == FORMAT_TABLE) {
+                    fprintf(out, "Best algorithm from %12.3lf MB/s with "
+                            "%6.2lf%% win rate is %s\r\n", step.bandwidth,
+                            winRate, algorithms[leader].c_str());
+                    continue;
+                }
+
+                JsonObject record;
+                record.addString("type", "crossover")
+                      .addString("category", category.name)
+                      .addNumber("bandwidth_mbps", step.bandwidth)
+                      .addString("algorithm", algorithms[leader])
+                      .addNumber("win_rate", winRate/100);
+                fprintf(out, "%s\n", record.str().c_str());
+            }
+
+            if (output.format == FORMAT_JSON) {
+                for (size_t i = 0; i < bandwidths.size(); ++i) {
+                    JsonObject winCounts, totalTimes;
+                    for (size_t j = 0; j < algorithms.size(); ++j) {
+                        winCounts.addInteger(algorithms[j].c_str(),
+                                             wins[i][j]);
+                        totalTimes.addNumber(algorithms[j].c_str(),
+                                             totals[i][j]);
+                    }
+
+                    JsonObject record;
+                    record.addString("type", "bandwidth")
+                          .addString("category", category.name)
+                          .addInteger("bandwidth_mbps", bandwidths[i])
+                          .addInteger("datasets", datasets.size())
+                          .addString("best", algorithms[leaders[i]])
+                          .addString("fastest_total", algorithms[fastest[i]])
+                          .addObject("wins", winCounts)
+                          .addObject("total_s", totalTimes);
+                    fprintf(out, "%s\n", record.str().c_str());
+                }
+                continue;
+            }
+
+            fprintf(out, "#%-14s", "Wins at MB/s");
+            for (int bandwidth : bandwidths)
+                fprintf(out, "%16d", bandwidth);
+            fprintf(out, "\r\n");
+
+            for (size_t j = 0; j < algorithms.size(); ++j) {
+                bool won = false;
+                for (size_t i = 0; i < bandwidths.size(); ++i)
+                    won |= wins[i][j] > 0;
+                if (!won)
+                    continue;
+
+                fprintf(out, "%-15s", algorithms[j].c_str());
+                for (size_t i = 0; i < bandwidths.size(); ++i)
+                    fprintf(out, "%16d", wins[i][j]);
+                fprintf(out, "\r\n");
+            }
+
+            fprintf(out, "%-15s", "Fastest total");
+            for (size_t i = 0; i < bandwidths.size(); ++i)
+                fprintf(out, "%16s", algorithms[fastest[i]].c_str());
+            fprintf(out, "\r\n\r\n");
+        }
+    }
+}
+
+/**
+ * Writes the files gnuplot.gnuplot plots for each DATASET_CATEGORIES into a
+ * directory: <category>.txt with the number of datasets each algorithm wins
+ * from every bandwidth where that changes (to plot as steps), and
+ * <category>-absolute.txt with the time each algorithm takes to log all of
+ * the datasets, at bandwidths spaced evenly on a log scale.
+ *
+ * \param model
+ *      Results of the algorithms on the datasets
+ * \param directory
+ *      Directory to write the files to; created if it doesn't exist
+ *
+ * \return
+ *      False if the files couldn't be written
+ */
+static bool
+writeBandwidthDetails(const BandwidthModel &model, const char *directory)
+{
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Could not create %s: %s\r\n", directory,
+                strerror(errno));
+        return false;
+    }
+
+    std::vector<std::string> algorithms = model.getAlgorithms();
+    for (const DatasetCategory &category : DATASET_CATEGORIES) {
+        std::vector<std::string> datasets = model.getDatasets(category.pattern);
+        if (datasets.empty())
+            continue;
+
+        std::string path = std::string(directory) + "/" + category.name;
+        FILE *winsFile = fopen((path + ".txt").c_str(), "w");
+        FILE *absoluteFile = fopen((path + "-absolute.txt").c_str(), "w");
+        if (winsFile == nullptr || absoluteFile == nullptr) {
+            fprintf(stderr, "Could not open %s for writing: %s\r\n",
+                    path.c_str(), strerror(errno));
+            if (winsFile != nullptr)
+                fclose(winsFile);
+            if (absoluteFile != nullptr)
+                fclose(absoluteFile);
+            return false;
+        }
+
+        for (FILE *file : {winsFile, absoluteFile}) {
+            fprintf(file, "%-12s", "MB/s");
+            for (const std::string &algorithm : algorithms)
+                fprintf(file, "%15s", algorithm.c_str());
+            fprintf(file, "\r\n");
+        }
+
+        // The first step starts at 0, which a log scale can't plot, and the
+        // last is repeated at the end of the range so that it's drawn
+        std::vector<BandwidthModel::Step> steps = model.getSteps(datasets);
+        steps.push_back(steps.back());
+        steps.back().bandwidth = std::max(DETAILS_MAX_BANDWIDTH,
+                                          2*steps.back().bandwidth);
+        steps.front().bandwidth = std::min(DETAILS_MIN_BANDWIDTH,
+                                           steps[1].bandwidth/2);
+        for (const BandwidthModel::Step &step : steps) {
+            fprintf(winsFile, "%-12.6g", step.bandwidth);
+            for (int wins : step.wins)
+                fprintf(winsFile, "%15d", wins);
+            fprintf(winsFile, "\r\n");
+        }
+
+        fprintf(winsFile, "# Data sets included in this calculation:");
+        for (const std::string &dataset : datasets)
+            fprintf(winsFile, " '%s'", dataset.c_str());
+        fprintf(winsFile, "\r\n");
+
+        for (int i = 0; i <= 100; ++i) {
+            double bandwidth = DETAILS_MIN_BANDWIDTH*pow(DETAILS_MAX_BANDWIDTH/
+                                        DETAILS_MIN_BANDWIDTH, i/100.0);
+            fprintf(absoluteFile, "%-12.6g", bandwidth);
+            for (const std::string &algorithm : algorithms) {
+                fprintf(absoluteFile, "%15.6lf",
+                        model.getTotalTime(algorithm, datasets, bandwidth));
+            }
+            fprintf(absoluteFile, "\r\n");
+        }
+
+        fclose(winsFile);
+        fclose(absoluteFile);
+    }
+
+    return true;
+}
+
+/**
+ * Records the results in a JSON-lines file written by the benchmark (with
+ * -o) in a BandwidthModel, printing the metadata of the runs that produced
+ * them to the table outputs.
+ *
+ * \param fileName
+ *      File to read
+ * \param model
+ *      Model to record the results in
+ *
+ * \return
+ *      Number of results read, or -1 if the file couldn't be read
+ */
+static int
+readResults(const char *fileName, BandwidthModel *model)
+{
+    FILE *file = fopen(fileName, "r");
+    if (file == nullptr) {
+        fprintf(stderr, "Could not open %s for reading: %s\r\n", fileName,
+                strerror(errno));
+        return -1;
+    }
+
+    int numResults = 0;
+    char *line = nullptr;
+    size_t lineCapacity = 0;
+    while (getline(&line, &lineCapacity, file) != -1) {
+        std::string record = line;
+        std::string type, algorithm, dataset, computeTime, outputBytes;
+        if (!JsonObject::findMember(record, "type", &type))
+            continue;
+
+        if (type == "run") {
+            std::string date, host, cpu, gitHash;
+            JsonObject::findMember(record, "date", &date);
+            JsonObject::findMember(record, "host", &host);
+            JsonObject::findMember(record, "cpu", &cpu);
+            JsonObject::findMember(record, "git_hash", &gitHash);
+            for (const Output &output : outputs) {
+                if (output.format == FORMAT_TABLE) {
+                    fprintf(output.file, "# Results of %s on %s (%s) at %s"
+                            "\r\n", gitHash.c_str(), host.c_str(),
+                            cpu.c_str(), date.c_str());
+                }
+            }
+        }
+
+        if (type != "result" ||
+                !JsonObject::findMember(record, "algorithm", &algorithm) ||
+                !JsonObject::findMember(record, "dataset", &dataset) ||
+                !JsonObject::findMember(record, "compute_s", &computeTime) ||
+                !JsonObject::findMember(record, "output_bytes", &outputBytes)
+                || computeTime == "null")
+            continue;
+
+        model->addResult(algorithm, dataset, atof(computeTime.c_str()),
+                         strtoull(outputBytes.c_str(), nullptr, 10));
+        ++numResults;
+    }
+
+    free(line);
+    fclose(file);
+    return numResults;
+}
+
+/**
+ * Prints the command line usage of the benchmark.
+ *
+ * \param program
+ *      Name the benchmark was invoked with
+ */
+static void
+printUsage(const char *program)
+{
+    printf("Measures the performance of compression algorithms on NanoLog "
+           "log data.\r\n"
+           "Usage:\r\n"
+           "\t%s [options]\r\n"
+           "\t%s [options] staging\r\n"
+           "\t%s generator\r\n"
+           "\t%s [options] sweep\r\n"
+           "\t%s [options] analyze [FILE]\r\n\r\n"
+           "The first form compresses every dataset with every algorithm. The "
+           "second\r\nmeasures logging through per-thread staging buffers "
+           "drained by a background\r\ncompaction thread, for each of the "
+           "thread counts. The third measures how fast\r\nthe random words "
+           "and Zipfian numbers of the string datasets are generated. The"
+           "\r\nfourth compresses representative datasets in batches of 4KB "
+           "doubling up to the\r\nbuffer size. The last analyzes the results "
+           "a run wrote to FILE (default\r\nresults.jsonl) with -o: which "
+           "algorithms log each category of datasets the\r\nfastest at which "
+           "device bandwidths, which the first form also prints when it's"
+           "\r\ndone; it writes the tables gnuplot.gnuplot plots to %s/."
+           "\r\n\r\n"
+           "Options:\r\n"
+           "  -a, --algorithms=GLOBS     Only run the algorithms matching one "
+           "of the comma\r\n"
+           "                             separated globs (e.g. "
+           "'gzip,6,NanoLog*')\r\n"
+           "  -d, --datasets=GLOBS       Only generate the datasets matching "
+           "one of the\r\n"
+           "                             globs (e.g. 'Rand Small*,RAMCloud*')"
+           "\r\n"
+           "  -n, --num-args=LIST        Argument counts of the binary "
+           "datasets\r\n"
+           "                             (default 1,2,3,4,6,10)\r\n"
+           "  -l, --string-lengths=LIST  Lengths of the string datasets\r\n"
+           "                             (default 10,15,20,30,45,60,100)\r\n"
+           "  -b, --buffer-size=SIZE     Size of the datasets, or largest "
+           "batch of the\r\n"
+           "                             sweep, with an optional K/M/G "
+           "suffix (default 64M)\r\n"
+           "  -w, --warmup=W             Untimed runs of each algorithm on "
+           "each dataset\r\n"
+           "                             before the trials (default 0)\r\n"
+           "  -k, --trials=K             Timed runs of each algorithm on each "
+           "dataset; the\r\n"
+           "                             median is reported along with "
+           "statistics (default 1)\r\n"
+           "  -t, --threads=LIST         Thread counts of NanoLog-MT and the "
+           "staging\r\n"
+           "                             benchmark (default 1 to the number "
+           "of cores)\r\n"
+           "  -c, --counters             Measure each compression with "
+           "hardware performance\r\n"
+           "                             counters via perf_event_open(2)\r\n"
+           "  -f, --format=FORMAT        Output format: table (default), csv "
+           "or jsonl\r\n"
+           "  -o, --output=FILE          Also write the results to FILE as "
+           "JSON lines, or as\r\n"
+           "                             CSV if FILE ends in .csv\r\n"
+           "  -B, --bandwidths=LIST      Device bandwidths in MB/s to analyze "
+           "the results at;\r\n"
+           "                             the first is the Output (s) metric's "
+           "(default 250)\r\n"
+           "  -S, --sink=FILE            Also write the output of the main "
+           "algorithms to FILE\r\n"
+           "                             with O_DIRECT and io_uring, "
+           "measuring the write time\r\n"
+           "                             and its overlap with compression\r\n"
+           "  -L, --list                 Only list the names of the selected "
+           "datasets\r\n"
+           "  -h, --help                 Print this message\r\n\r\n",
+           program, program, program, program, program, DETAILS_DIRECTORY);
+}
+
 int main(int argc, char **argv) {
-    if (argc > 1) {
-        printf("This application measures the performance of different "
-               "compression algorithms on NanoLog log data.\r\n"
-               "Usage:\r\n"
-               "\t%s\r\n\r\n", argv[0]);
+    static const struct option longOptions[] = {
+        {"algorithms",      required_argument,  nullptr, 'a'},
+        {"datasets",        required_argument,  nullptr, 'd'},
+        {"num-args",        required_argument,  nullptr, 'n'},
+        {"string-lengths",  required_argument,  nullptr, 'l'},
+        {"buffer-size",     required_argument,  nullptr, 'b'},
+        {"warmup",          required_argument,  nullptr, 'w'},
+        {"trials",          required_argument,  nullptr, 'k'},
+        {"threads",         required_argument,  nullptr, 't'},
+        {"counters",        no_argument,        nullptr, 'c'},
+        {"format",          required_argument,  nullptr, 'f'},
+        {"output",          required_argument,  nullptr, 'o'},
+        {"bandwidths",      required_argument,  nullptr, 'B'},
+        {"sink",            required_argument,  nullptr, 'S'},
+        {"list",            no_argument,        nullptr, 'L'},
+        {"help",            no_argument,        nullptr, 'h'},
+        {nullptr,           0,                  nullptr, 0}
+    };
+
+    std::vector<std::string> algorithms, datasets;
+    std::vector<int> numberOfArguments = {1, 2, 3, 4, 6, 10};
+    std::vector<int> stringLengths = {10, 15, 20, 30, 45, 60, 100};
+    std::vector<int> threadCounts;
+    uint64_t bufferSize = 64*1024*1024; // 64MB
+    int warmups = 0;
+    int trials = 1;
+    bool listDatasets = false;
+    bool countersEnabled = false;
+    const char *outputFile = nullptr;
+    std::vector<int> bandwidths = {static_cast<int>(deviceBandwidth)};
+    const char *sinkFile = nullptr;
+
+    int option;
+    while ((option = getopt_long(argc, argv, "a:d:n:l:b:w:k:t:cf:o:B:S:Lh",
+                                 longOptions, nullptr)) != -1) {
+        bool valid = true;
+        switch (option) {
+            case 'a':
+                algorithms = splitAlgorithmList(optarg);
+                break;
+            case 'd':
+                datasets = splitList(optarg);
+                break;
+            case 'n':
+                valid = parseIntList(optarg, &numberOfArguments) &&
+                        *std::max_element(numberOfArguments.begin(),
+                                          numberOfArguments.end()) <=
+                                BenchmarkRunner::MAX_ARGS;
+                break;
+            case 'l':
+                valid = parseIntList(optarg, &stringLengths);
+                break;
+            case 'b':
+                bufferSize = parseSize(optarg);
+                valid = bufferSize > 0;
+                break;
+            case 'w':
+                warmups = atoi(optarg);
+                valid = warmups >= 0 && isdigit(optarg[0]);
+                break;
+            case 'k':
+                trials = atoi(optarg);
+                valid = trials > 0;
+                break;
+            case 't':
+                valid = parseIntList(optarg, &threadCounts);
+                break;
+            case 'c':
+                countersEnabled = true;
+                break;
+            case 'f':
+                if (strcmp(optarg, "table") == 0)
+                    outputs[0].format = FORMAT_TABLE;
+                else if (strcmp(optarg, "csv") == 0)
+                    outputs[0].format = FORMAT_CSV;
+                else if (strcmp(optarg, "jsonl") == 0)
+                    outputs[0].format = FORMAT_JSON;
+                else
+                    valid = false;
+                break;
+            case 'o':
+                outputFile = optarg;
+                break;
+            case 'B':
+                valid = parseIntList(optarg, &bandwidths);
+                break;
+            case 'S':
+                sinkFile = optarg;
+                break;
+            case 'L':
+                listDatasets = true;
+                break;
+            case 'h':
+                printUsage(argv[0]);
+                return 0;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+
+        if (!valid) {
+            fprintf(stderr, "Invalid argument \"%s\" for option -%c\r\n",
+                    optarg, option);
+            return 1;
+        }
+    }
+
+    const char *mode = (optind < argc) ? argv[optind] : "";
+    bool analyze = strcmp(mode, "analyze") == 0;
+    if (optind + (analyze ? 2 : 1) < argc || (optind < argc && !analyze &&
+            strcmp(mode, "staging") != 0 && strcmp(mode, "generator") != 0 &&
+            strcmp(mode, "sweep") != 0)) {
+        printUsage(argv[0]);
         return 1;
     }
+    deviceBandwidth = bandwidths.front();
+
+    int maxThreads = std::max(1U, std::thread::hardware_concurrency());
+    if (threadCounts.empty()) {
+        for (int i = 1; i <= maxThreads; ++i)
+            threadCounts.push_back(i);
+    }
+    maxThreads = *std::max_element(threadCounts.begin(), threadCounts.end());
+
+    if (strcmp(mode, "staging") == 0) {
+        printf("#%9s %12s %12s %12s %15s %10s %10s %10s %12s %12s %15s "
+               "%15s %10s\r\n",
+               "Producers", "NumLogs", "Time (s)", "Mlogs/s",
+               "Producer ns/log", "p50 (ns)", "p99 (ns)", "p99.9 (ns)",
+               "Max (ns)", "Blocked", "Input Bytes", "Output Bytes",
+               "Ratio");
+        for (int numProducers : threadCounts)
+            runStagingBenchmark(numProducers, STAGING_LOGS_PER_PRODUCER);
+
+        fflush(stdout);
+        return 0;
+    }
+
+    if (strcmp(mode, "generator") == 0) {
+        printf("#%9s %12s %12s %12s %12s %12s %15s\r\n",
+               "WordLimit", "NumWords", "Setup (ms)", "Time (s)",
+               "Mwords/s", "ns/word", "Avg Word Len");
+        long int wordLimits[] = {10, 100, 1000, 10000,
+                                 WordData::RandomWordGenerator::
+                                         getMaxWordLimit()};
+        for (long int wordLimit : wordLimits)
+            runWordGeneratorBenchmark(wordLimit, GENERATOR_WORDS);
+
+        printf("\r\n#%9s %12s %12s %12s %12s %12s %15s %8s\r\n",
+               "N", "NumSamples", "Setup (ms)", "Time (s)", "Msamples/s",
+               "ns/sample", "Mean Sample", "Method");
+        for (uint64_t n = 1000; n <= 100000000; n *= 10)
+            runZipfianBenchmark(n, GENERATOR_WORDS);
+
+        fflush(stdout);
+        return 0;
+    }
+
+    // The remaining modes print their results through the outputs
+    if (outputFile != nullptr && !listDatasets) {
+        FILE *file = fopen(outputFile, "w");
+        if (file == nullptr) {
+            fprintf(stderr, "Could not open %s for writing: %s\r\n",
+                    outputFile, strerror(errno));
+            return 1;
+        }
+
+        size_t length = strlen(outputFile);
+        bool csv = length >= 4 && strcmp(outputFile + length - 4, ".csv") == 0;
+        outputs.push_back({file, csv ? FORMAT_CSV : FORMAT_JSON});
+    }
+
+    // Only the algorithms selected, or all but the UNANALYZED_ALGORITHMS
+    BandwidthModel bandwidthModel;
+    bandwidthModel.selectAlgorithms(algorithms.empty() ? UNANALYZED_ALGORITHMS
+                                                       : algorithms);
+
+    if (analyze) {
+        const char *resultsFile = (optind + 1 < argc) ? argv[optind + 1]
+                                                      : "results.jsonl";
+        int numResults = readResults(resultsFile, &bandwidthModel);
+        if (numResults < 0)
+            return 1;
+        if (numResults == 0) {
+            fprintf(stderr, "%s has no results\r\n", resultsFile);
+            return 1;
+        }
+
+        printBandwidthAnalysis(bandwidthModel, bandwidths);
+        bool written = writeBandwidthDetails(bandwidthModel,
+                                             DETAILS_DIRECTORY);
+        closeOutputs();
+        return written ? 0 : 1;
+    }
+
+    if (!listDatasets)
+        printRunMetadata(argc, argv, bufferSize, warmups, trials);
+
+    if (strcmp(mode, "sweep") == 0) {
+        if (bufferSize < SWEEP_MIN_BATCH_SIZE) {
+            fprintf(stderr, "The largest batch size must be at least "
+                    "%lu bytes\r\n", SWEEP_MIN_BATCH_SIZE);
+            return 1;
+        }
+
+        std::vector<uint64_t> batchSizes;
+        for (uint64_t size = SWEEP_MIN_BATCH_SIZE; size <= bufferSize;
+                size *= 2)
+            batchSizes.push_back(size);
+
+        BenchmarkRunner runner(std::max(bufferSize,
+                                        SWEEP_DEFAULT_MAX_BATCH_SIZE),
+                               maxThreads);
+        runner.setAlgorithms(algorithms);
+        runner.setDatasets(datasets, listDatasets);
+        runner.setBatchSizes(batchSizes);
+        if (!listDatasets)
+            runner.printBatchSweepHeader();
+
+        // A representative of each kind of dataset
+        runner.runBinaryTest("Incr Small 2 Int", 2,
+                             &ArgumentGenerator::incSmallInt<int>);
+        runner.runBinaryTest("Rand Small 4 Long", 4,
+                             &ArgumentGenerator::randSmallInt<long>);
+        runner.runBinaryTest("Rand Small 2 Double", 2,
+                             &ArgumentGenerator::randSmallDouble);
+        runner.ramcloudTest();
+        runner.stringTest(20, true, 1000, false, false);
+
+        closeOutputs();
+        return 0;
+    }
 
     /**
      * In this benchmark we need to vary the following variables:
@@ -775,13 +4128,30 @@ int main(int argc, char **argv) {
      * 2) Type: small/big int/longs, doubles, strings
      * 3) Entropy of data (random, increment, hot)
      */
-    const int rawInputDataSize = 1024*1024*64; // 64MB
-    BenchmarkRunner runner(rawInputDataSize);
-    runner.printHeader();
+    BenchmarkRunner runner(bufferSize, maxThreads);
+    runner.setAlgorithms(algorithms);
+    runner.setDatasets(datasets, listDatasets);
+    runner.setThreadCounts(threadCounts);
+    runner.setTrials(warmups, trials);
+    runner.setBandwidthModel(&bandwidthModel);
+    if (countersEnabled && !listDatasets)
+        runner.enablePerfCounters();
+    if (sinkFile != nullptr && !listDatasets &&
+            runner.enableSink(sinkFile)) {
+        for (const Output &output : outputs) {
+            if (output.format == FORMAT_TABLE) {
+                fprintf(output.file, "# Sink writes to %s via %s in %luKB "
+                        "writes, at most %u in flight\r\n", sinkFile,
+                        runner.getSinkMode(), DirectSink::CHUNK_SIZE/1024,
+                        DirectSink::QUEUE_DEPTH);
+            }
+        }
+    }
+    if (!listDatasets)
+        runner.printHeader();
 
     // First, run all the binary data types (int/long/doubles)
     char datasetName[100];
-    int numberOfArguments[] = {1, 2, 3, 4, 6, 10};
      for (int numArgs : numberOfArguments) {
         // Random Arguments
         snprintf(datasetName, 100, "Rand Small %d Int", numArgs);
@@ -834,15 +4204,27 @@ int main(int argc, char **argv) {
                              &ArgumentGenerator::incBigDouble);
      }
 
+    // Then log statements that mix argument types, like most real ones
+    runner.formatTest("Mixed 3 Args",
+                      "%d inserts took %.2f seconds (%.2f Mobjects/sec)\n");
+    runner.formatTest("Mixed 8 Args",
+                      "@%7lu: Replica <%s,%lu,%lu> write -> %7u+%7u %u rpcs "
+                      "out %s\n");
+
+    // And a stream of all of RAMCloud's log statements, which is the closest
+    // to production traffic
+    runner.ramcloudTest();
+
     // Run the ASCII tests, varying...
     // 1) string length (say 10, 20, 40)
     // 2) entropy (psuedo-random words by top 1000)
-    int stringLengths[] = {10, 15, 20, 30, 45, 60, 100};
     for (int length : stringLengths) {
         runner.stringTest(length, true, 1000);
     }
 
-    fflush(stdout);
+    if (!listDatasets)
+        printBandwidthAnalysis(bandwidthModel, bandwidths);
+    closeOutputs();
 
     return 0;
 }
\ No newline at end of file
@@ -2,6 +2,6 @@
 
 git submodule update --init --recursive && make -j10; make -j10
 clear
-stdbuf -oL ./benchmark | tee results.txt
-python ./pivot.py
+stdbuf -oL ./benchmark -o results.jsonl | tee results.txt
+./benchmark analyze results.jsonl | tee analysis.txt
 gnuplot gnuplot.gnuplot
\ No newline at end of file
@@ -39,6 +39,7 @@ with open("count_1w100k.txt", 'r') as iFile, open("CommonWords.cc", 'w') as oFil
 #include <cstdint>
 
 #include <random>
+#include <vector>
 
 #include "CommonWords.h"
 
@@ -89,23 +90,69 @@ unsigned long int maxEndIndex = %d;
 // Maximum index in our physical array
 unsigned long int numUniqueWords = %d;
 
+/**
+ * Builds a Walker/Vose alias table over the top wordLimit words so that
+ * getRandomWord() can pick a word with two random draws instead of searching
+ * OccuranceMap. Every word gets a slot covering totalCount occurrence indexes;
+ * the word owns the first count*wordLimit of them and lends the rest to a word
+ * with more than its share. The arithmetic is done in integers, so the words
+ * are drawn at exactly their relative frequencies.
+ */
+void
+RandomWordGenerator::buildAliasTable() {
+    uint64_t totalCount = OccuranceMap[wordLimit - 1].endIndex;
+
+    aliasThreshold.resize(wordLimit);
+    aliasIndex.resize(wordLimit);
+
+    std::vector<uint32_t> small, large;
+    uint64_t previousEndIndex = 0;
+    for (uint32_t i = 0; i < wordLimit; ++i) {
+      uint64_t count = OccuranceMap[i].endIndex - previousEndIndex;
+      previousEndIndex = OccuranceMap[i].endIndex;
+
+      aliasThreshold[i] = count*wordLimit;
+      aliasIndex[i] = i;
+      if (aliasThreshold[i] < totalCount)
+        small.push_back(i);
+      else
+        large.push_back(i);
+    }
+
+    while (!small.empty() && !large.empty()) {
+      uint32_t lender = large.back();
+      uint32_t borrower = small.back();
+      small.pop_back();
+
+      aliasIndex[borrower] = lender;
+      aliasThreshold[lender] -= totalCount - aliasThreshold[borrower];
+      if (aliasThreshold[lender] < totalCount) {
+        large.pop_back();
+        small.push_back(lender);
+      }
+    }
+
+    // Whatever is left fills its slot exactly
+    for (uint32_t i : large)
+      aliasThreshold[i] = totalCount;
+    for (uint32_t i : small)
+      aliasThreshold[i] = totalCount;
+}
+
 const char*
 RandomWordGenerator::getRandomWord() {
-    uint64_t indexLimit = OccuranceMap[wordLimit - 1].endIndex;
-    std::uniform_int_distribution<uint64_t> indexDist(0, indexLimit);
-    uint64_t randomIndex = indexDist(generator);
-
-    // Linear search through our list to find the word at the appropriate occurrence index
-    // Note: we could do binary search, but the indexes are exponentially distributed,
-    // which means a large number of them will appear at the front of the list. So let's just
-    // do the simple thing until we need something faster.
-
-    for (int i = 0; i < numUniqueWords; ++i) {
-      if (randomIndex < OccuranceMap[i].endIndex)
-        return OccuranceMap[i].word;
-    }
+    if (aliasThreshold.size() != wordLimit)
+      buildAliasTable();
+
+    uint64_t totalCount = OccuranceMap[wordLimit - 1].endIndex;
+    std::uniform_int_distribution<uint32_t> slotDist(0, wordLimit - 1);
+    std::uniform_int_distribution<uint64_t> indexDist(0, totalCount - 1);
+
+    uint32_t slot = slotDist(generator);
+    if (indexDist(generator) < aliasThreshold[slot])
+      return OccuranceMap[slot].word;
 
-    return OccuranceMap[0].word;
+    return OccuranceMap[aliasIndex[slot]].word;
   }
 
 }; // namesace WordData